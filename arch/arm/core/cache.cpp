@@ -0,0 +1,171 @@
+#include "cache.h"
+
+namespace Arch {
+namespace Arm {
+
+static inline kstd::uint64_t read_ctr_el0() {
+    kstd::uint64_t ctr;
+    asm volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    return ctr;
+}
+
+kstd::size_t Cache::dcache_line_size() {
+    // DminLine (bits 19:16): log2 of the number of 4-byte words in the smallest D-cache line
+    return static_cast<kstd::size_t>(4) << ((read_ctr_el0() >> 16) & 0xF);
+}
+
+kstd::size_t Cache::icache_line_size() {
+    // IminLine (bits 3:0): log2 of the number of 4-byte words in the smallest I-cache line
+    return static_cast<kstd::size_t>(4) << (read_ctr_el0() & 0xF);
+}
+
+void Cache::clean_dcache_range(const void* start, kstd::size_t size) {
+    kstd::uintptr_t line = dcache_line_size();
+    kstd::uintptr_t addr = reinterpret_cast<kstd::uintptr_t>(start) & ~(line - 1);
+    kstd::uintptr_t end = reinterpret_cast<kstd::uintptr_t>(start) + size;
+    for (; addr < end; addr += line) {
+        asm volatile("dc cvac, %0" : : "r"(addr) : "memory");
+    }
+    asm volatile("dsb sy" ::: "memory");
+}
+
+void Cache::clean_invalidate_dcache_range(const void* start, kstd::size_t size) {
+    kstd::uintptr_t line = dcache_line_size();
+    kstd::uintptr_t addr = reinterpret_cast<kstd::uintptr_t>(start) & ~(line - 1);
+    kstd::uintptr_t end = reinterpret_cast<kstd::uintptr_t>(start) + size;
+    for (; addr < end; addr += line) {
+        asm volatile("dc civac, %0" : : "r"(addr) : "memory");
+    }
+    asm volatile("dsb sy" ::: "memory");
+}
+
+void Cache::invalidate_dcache_range(const void* start, kstd::size_t size) {
+    if (size == 0) return;
+    kstd::uintptr_t line = dcache_line_size();
+    kstd::uintptr_t begin = reinterpret_cast<kstd::uintptr_t>(start);
+    kstd::uintptr_t end = begin + size;
+    kstd::uintptr_t addr = begin & ~(line - 1);
+
+    // Lines only partly inside the range may hold someone else's dirty data
+    if (addr != begin) {
+        asm volatile("dc civac, %0" : : "r"(addr) : "memory");
+        addr += line;
+    }
+    kstd::uintptr_t last = end & ~(line - 1);
+    if (last != end && last >= addr) {
+        asm volatile("dc civac, %0" : : "r"(last) : "memory");
+    }
+    for (; addr < last; addr += line) {
+        asm volatile("dc ivac, %0" : : "r"(addr) : "memory");
+    }
+    asm volatile("dsb sy" ::: "memory");
+}
+
+void Cache::sync_icache_range(const void* start, kstd::size_t size) {
+    kstd::uintptr_t dline = dcache_line_size();
+    kstd::uintptr_t iline = icache_line_size();
+    kstd::uintptr_t begin = reinterpret_cast<kstd::uintptr_t>(start);
+    kstd::uintptr_t end = begin + size;
+
+    // 1. Push the new instructions to the point of unification
+    for (kstd::uintptr_t addr = begin & ~(dline - 1); addr < end; addr += dline) {
+        asm volatile("dc cvau, %0" : : "r"(addr) : "memory");
+    }
+    asm volatile("dsb ish" ::: "memory");
+
+    // 2. Drop stale instructions
+    for (kstd::uintptr_t addr = begin & ~(iline - 1); addr < end; addr += iline) {
+        asm volatile("ic ivau, %0" : : "r"(addr) : "memory");
+    }
+    asm volatile("dsb ish" ::: "memory");
+    asm volatile("isb" ::: "memory");
+}
+
+void Cache::zero_range(void* start, kstd::size_t size) {
+    kstd::uintptr_t addr = reinterpret_cast<kstd::uintptr_t>(start);
+    kstd::uintptr_t end = addr + size;
+
+    while (addr < end && (addr & 7)) {
+        *reinterpret_cast<volatile kstd::uint8_t*>(addr++) = 0;
+    }
+    kstd::uint64_t dczid, sctlr;
+    asm volatile("mrs %0, dczid_el0" : "=r"(dczid));
+    asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    if (!(dczid & (1 << 4)) && (sctlr & 1)) { // DZP clear: DC ZVA permitted; MMU on: memory is Normal
+        kstd::uintptr_t block = static_cast<kstd::uintptr_t>(4) << (dczid & 0xF); // BS: log2 words
+        while (addr + 8 <= end && (addr & (block - 1))) {
+            *reinterpret_cast<volatile kstd::uint64_t*>(addr) = 0;
+            addr += 8;
+        }
+        for (; addr + block <= end; addr += block) {
+            asm volatile("dc zva, %0" : : "r"(addr) : "memory");
+        }
+    }
+    for (; addr + 8 <= end; addr += 8) {
+        *reinterpret_cast<volatile kstd::uint64_t*>(addr) = 0;
+    }
+    while (addr < end) {
+        *reinterpret_cast<volatile kstd::uint8_t*>(addr++) = 0;
+    }
+}
+
+void Cache::invalidate_icache_all() {
+    asm volatile("ic iallu" ::: "memory");
+    asm volatile("dsb nsh" ::: "memory");
+    asm volatile("isb" ::: "memory");
+}
+
+void Cache::dcache_all_by_set_way(SetWayOp op) {
+    kstd::uint64_t clidr;
+    asm volatile("mrs %0, clidr_el1" : "=r"(clidr));
+    unsigned int loc = (clidr >> 24) & 0x7; // Level of Coherency
+
+    asm volatile("dsb sy" ::: "memory");
+    for (unsigned int level = 0; level < loc; ++level) {
+        unsigned int ctype = (clidr >> (level * 3)) & 0x7;
+        if (ctype < 2) continue; // No cache or I-cache only at this level
+
+        // Select the data/unified cache at this level and read its geometry
+        kstd::uint64_t csselr = static_cast<kstd::uint64_t>(level) << 1;
+        asm volatile("msr csselr_el1, %0" : : "r"(csselr));
+        asm volatile("isb");
+        kstd::uint64_t ccsidr;
+        asm volatile("mrs %0, ccsidr_el1" : "=r"(ccsidr));
+
+        unsigned int line_shift = (ccsidr & 0x7) + 4;             // log2(line size in bytes)
+        unsigned int max_way = (ccsidr >> 3) & 0x3FF;             // Associativity - 1
+        unsigned int max_set = (ccsidr >> 13) & 0x7FFF;           // Number of sets - 1
+        unsigned int way_shift = max_way ? __builtin_clz(max_way) : 0; // Way index sits in the top bits
+
+        for (unsigned int way = 0; way <= max_way; ++way) {
+            for (unsigned int set = 0; set <= max_set; ++set) {
+                kstd::uint64_t sw = (static_cast<kstd::uint64_t>(way) << way_shift) |
+                                    (static_cast<kstd::uint64_t>(set) << line_shift) |
+                                    (static_cast<kstd::uint64_t>(level) << 1);
+                switch (op) {
+                    case SetWayOp::CLEAN:            asm volatile("dc csw, %0" : : "r"(sw) : "memory"); break;
+                    case SetWayOp::CLEAN_INVALIDATE: asm volatile("dc cisw, %0" : : "r"(sw) : "memory"); break;
+                    case SetWayOp::INVALIDATE:       asm volatile("dc isw, %0" : : "r"(sw) : "memory"); break;
+                }
+            }
+        }
+    }
+    asm volatile("msr csselr_el1, xzr");
+    asm volatile("dsb sy" ::: "memory");
+    asm volatile("isb" ::: "memory");
+}
+
+void Cache::clean_dcache_all() {
+    dcache_all_by_set_way(SetWayOp::CLEAN);
+}
+
+void Cache::clean_invalidate_dcache_all() {
+    dcache_all_by_set_way(SetWayOp::CLEAN_INVALIDATE);
+}
+
+void Cache::invalidate_dcache_all() {
+    dcache_all_by_set_way(SetWayOp::INVALIDATE);
+}
+
+} // namespace Arm
+} // namespace Arch
@@ -0,0 +1,57 @@
+#ifndef ARCH_ARM_CORE_CACHE_H
+#define ARCH_ARM_CORE_CACHE_H
+
+#include <kstd/cstdint.h>
+#include <kstd/cstddef.h> // For kstd::size_t
+
+namespace Arch {
+namespace Arm {
+
+// Cache maintenance for AArch64.
+// Range operations work on virtual addresses and use the line sizes reported by CTR_EL0.
+// They are needed whenever something other than this CPU reads or writes cacheable memory
+// (DMA engines, the VideoCore) and after writing instructions to memory.
+// All operations end with the barriers needed for their effect to be visible.
+class Cache {
+public:
+    // Smallest D-cache / I-cache line in bytes (CTR_EL0.DminLine / IminLine)
+    static kstd::size_t dcache_line_size();
+    static kstd::size_t icache_line_size();
+
+    // DC CVAC: write dirty lines back to memory (point of coherency). Before a device reads a buffer.
+    static void clean_dcache_range(const void* start, kstd::size_t size);
+
+    // DC CIVAC: write back and invalidate. Around a buffer a device writes.
+    static void clean_invalidate_dcache_range(const void* start, kstd::size_t size);
+
+    // DC IVAC: discard lines without writing them back. Partial lines at either end of the range
+    // are cleaned and invalidated instead, so neighbouring data is not lost.
+    static void invalidate_dcache_range(const void* start, kstd::size_t size);
+
+    // Make freshly written instructions executable: DC CVAU over the range, then IC IVAU.
+    static void sync_icache_range(const void* start, kstd::size_t size);
+
+    // Zero memory with DC ZVA a block at a time (8-byte stores for unaligned edges, or everywhere
+    // if DCZID_EL0 prohibits DC ZVA or the MMU is off: then all memory is Device and DC ZVA faults).
+    // Plain integer stores: safe in exception handlers that do not preserve FP/SIMD registers.
+    static void zero_range(void* start, kstd::size_t size);
+
+    // IC IALLU: invalidate the whole instruction cache of this core.
+    static void invalidate_icache_all();
+
+    // Whole-cache operations by set/way, for every level up to the point of coherency.
+    // Only meaningful on this core and with no other master sharing the data, e.g. before
+    // turning caches on or off, or before handing memory to a new kernel image.
+    static void clean_dcache_all();
+    static void clean_invalidate_dcache_all();
+    static void invalidate_dcache_all(); // Discards dirty data; only safe while the D-cache is off
+
+private:
+    enum class SetWayOp { CLEAN, CLEAN_INVALIDATE, INVALIDATE };
+    static void dcache_all_by_set_way(SetWayOp op);
+};
+
+} // namespace Arm
+} // namespace Arch
+
+#endif // ARCH_ARM_CORE_CACHE_H
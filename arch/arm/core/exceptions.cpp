@@ -1,39 +1,61 @@
 #include <kernel/interrupt.h>
 #include <kernel/console.h> // For Kernel::kprintf
 #include <kstd/cstdint.h>
+#include <arch/arm/core/mmu.h> // For MMU::is_guard_page
+#include <kernel/mm/vmalloc.h>   // For Mem::vmalloc_handle_fault (lazy commit)
+#include <kernel/irq/softirq.h>  // For SoftIrq::run_pending on IRQ exit
+#include <kernel/trace/latency.h> // For Trace::SVC_LATENCY_PROBE
+#include <kernel/trace/irqsoff.h> // For Trace::irqsoff_begin_at (handlers run with IRQs masked)
+#include <kernel/irqflags.h>      // For DAIF_I, current_pc
+#include <kernel/smp.h>           // For MAX_CPUS, cpu_id
 // #include "gic.h" // Will be created next (GICDriver)
 
-// Trap frame structure - matches what is saved by exception_stub in exceptions.S
-// This needs to be kept in sync with the assembly.
-// Order: SPSR_EL1, ELR_EL1, LR (x30), XZR (padding for x30 pair), x28-x29, ..., x0-x1.
-// Stack grows downwards. So, [sp] points to SPSR_EL1, ELR_EL1.
-// [sp, #16] points to LR, XZR.
-// [sp, #32] points to x28, x29 etc.
-// The `mov x0, sp` passes this base address.
+// Frames built by the stubs in exceptions.S (TRAP_FRAME_* / IRQ_FRAME_* there).
+// Keep both in sync with the assembly.
+
+// Synchronous exceptions, FIQ, SError: every general purpose register. For synchronous
+// exceptions the FP/SIMD registers are saved below it as well (exception_stub fpsimd=1).
 struct TrapFrame {
-    // Saved by stp x0, x1, [sp, #-16]! sequences, then LR, then SPSR/ELR
-    // This order is if we pushed SPSR/ELR *last* onto the stack pointed by SP.
-    // If SPSR/ELR pushed first, then GPRs, order is different.
-    // The current exceptions.S pushes GPRs first, then SPSR/ELR.
-    // So SPSR/ELR are at the lowest address (pointed to by final SP).
     kstd::uint64_t spsr_el1;
     kstd::uint64_t elr_el1;
-    kstd::uint64_t x30_lr; // x30 (Link Register)
-    kstd::uint64_t xzr_pad;  // Padding for x30 pair store
-    kstd::uint64_t gpr[31]; // x0-x29 (x28 was used to hold sp_base)
-                            // More accurately, this should reflect the actual save order.
-                            // Current stub saves x0-x29, x30.
-                            // Let's define it based on the order they are on stack, from low to high address:
-                            // SPSR_EL1, ELR_EL1 (at sp)
-                            // LR, XZR_PAD (at sp+16)
-                            // X28, X29 (at sp+32)
-                            // ...
-                            // X0, X1 (at sp+32 + 14*16)
+    kstd::uint64_t x[31];   // x0-x30
+    kstd::uint64_t entry_ticks; // CNTPCT_EL0 at the vector; also keeps sp 16-byte aligned
 };
-// A simpler definition if we just pass SP as a uint64_t array pointer:
-// struct TrapFrame {
-//    kstd::uint64_t registers[33]; // 31 GPRs + SPSR + ELR
-// };
+static_assert(sizeof(TrapFrame) == 272, "TrapFrame must match TRAP_FRAME_SIZE in exceptions.S");
+
+// IRQs: only the registers a C function may clobber. FP/SIMD state is saved lazily.
+struct IrqFrame {
+    kstd::uint64_t spsr_el1;
+    kstd::uint64_t elr_el1;
+    kstd::uint64_t x[19];   // x0-x18
+    kstd::uint64_t x30;
+    kstd::uint64_t cpacr_el1; // At entry; restored on exit
+    kstd::uint64_t entry_ticks; // CNTPCT_EL0 at the vector
+};
+static_assert(sizeof(IrqFrame) == 192, "IrqFrame must match IRQ_FRAME_SIZE in exceptions.S");
+
+// IRQ entries that may be on one CPU's stack at once; exceptions.S has one FP/SIMD save area
+// per level (IRQ_MAX_NESTING there). A handler only gets preempted by a more urgent priority
+// group, so three priority levels nest at most three deep.
+constexpr kstd::uint64_t IRQ_MAX_NESTING = 4;
+constexpr kstd::size_t FPSIMD_SIZE = 32 + 32 * 16;
+
+// Per-CPU IRQ state (CPU_IRQ_* in exceptions.S), found through TPIDR_EL1
+struct CpuIrqState {
+    kstd::uint64_t nesting;     // Incremented by handle_irq_spx before c_irq_handler
+    kstd::uint64_t entry_ticks; // Vector entry time of the innermost IRQ (Kernel::irq_entry_ticks)
+    kstd::uint8_t fpsimd[IRQ_MAX_NESTING][FPSIMD_SIZE]; // Owned by the assembly
+    const IrqFrame* frame;      // Of the innermost IRQ (Kernel::irq_interrupted_context)
+    kstd::uint64_t frame_fp;    // x29 where it arrived
+};
+static_assert(sizeof(CpuIrqState) == 2208, "CpuIrqState must match CPU_IRQ_STATE_SIZE in exceptions.S");
+extern "C" CpuIrqState cpu_irq_state[Kernel::MAX_CPUS];
+
+static inline CpuIrqState* this_cpu_irq_state() {
+    CpuIrqState* state;
+    asm volatile("mrs %0, tpidr_el1" : "=r"(state));
+    return state;
+}
 
 
 extern "C" {
@@ -41,12 +63,21 @@ extern "C" {
 // These are defined in exceptions.S
 void _enable_cpu_interrupts();
 void _disable_cpu_interrupts();
+extern char _exception_vectors[];
+
+void init_exceptions_this_cpu();
 
 // Function to initialize exception handling (e.g., set VBAR_EL1)
 void init_exceptions() {
-    extern char _exception_vectors[]; // Symbol from exceptions.S
+    init_exceptions_this_cpu();
+    Kernel::kprintf("VBAR_EL1 set to 0x%p\n", static_cast<void*>(_exception_vectors));
+}
+
+// Vectors and per-CPU IRQ state for the calling core; secondary cores call this directly
+void init_exceptions_this_cpu() {
+    asm volatile("msr tpidr_el1, %0" : : "r"(&cpu_irq_state[Kernel::cpu_id()]) : "memory");
     asm volatile("msr vbar_el1, %0" : : "r" (_exception_vectors) : "memory");
-    Kernel::kprintf("VBAR_EL1 set to 0x%p\n", _exception_vectors);
+    asm volatile("isb" ::: "memory");
 }
 
 // Generic C handlers called from assembly stubs
@@ -56,6 +87,27 @@ void c_sync_handler(TrapFrame* frame) {
     asm volatile("mrs %0, esr_el1" : "=r"(esr_el1)); // Exception Syndrome Register
     asm volatile("mrs %0, far_el1" : "=r"(far_el1)); // Fault Address Register
 
+    // Masked since the vector, unless the exception hit an IRQs-off section already
+    bool traced = Kernel::Trace::irqsoff_tracing && !(frame->spsr_el1 & Kernel::DAIF_I);
+    if (traced) {
+        Kernel::Trace::irqsoff_begin_at(frame->entry_ticks, reinterpret_cast<kstd::uintptr_t>(&c_sync_handler));
+    }
+
+    // SVC from the latency benchmark: hand back the vector entry time and return
+    if (((esr_el1 >> 26) & 0x3F) == 0b010101 && (esr_el1 & 0xFFFF) == Kernel::Trace::SVC_LATENCY_PROBE) {
+        frame->x[0] = frame->entry_ticks;
+        if (traced) Kernel::Trace::irqsoff_end(Kernel::current_pc());
+        return; // ELR_EL1 already points past the SVC
+    }
+
+    // Data abort at EL1 with a translation fault (DFSC 0b0001xx, any level): first touch of a
+    // vreserve() page. Commit it and return to retry the access.
+    if (((esr_el1 >> 26) & 0x3F) == 0b100101 && (esr_el1 & 0x3C) == 0x04 &&
+        Kernel::Mem::vmalloc_handle_fault(far_el1)) {
+        if (traced) Kernel::Trace::irqsoff_end(Kernel::current_pc());
+        return;
+    }
+
     Kernel::kprintf("\n--- Synchronous Exception ---\n");
     Kernel::kprintf("SPSR_EL1: 0x%016llx  ELR_EL1: 0x%016llx\n", frame->spsr_el1, frame->elr_el1);
     Kernel::kprintf("ESR_EL1:  0x%016llx  FAR_EL1: 0x%016llx\n", esr_el1, far_el1);
@@ -65,7 +117,7 @@ void c_sync_handler(TrapFrame* frame) {
     const char* ec_desc = "Unknown";
     switch(ec) {
         case 0b000000: ec_desc = "Unknown reason"; break;
-        case 0b000111: ec_desc = "Trapped SVE, SIMD or floating-point instruction"; break;
+        case 0b000111: ec_desc = "Trapped SVE, SIMD or floating-point instruction (FP/SIMD off outside an IRQ)"; break;
         // case 0b001100: ec_desc = "Trapped MSR, MRS or System instruction"; break; // EL0/EL1
         case 0b010001: ec_desc = "Instruction Abort from lower EL"; break;
         case 0b010010: ec_desc = "Instruction Abort from same EL"; break;
@@ -85,6 +137,10 @@ void c_sync_handler(TrapFrame* frame) {
     }
     Kernel::kprintf("EC: 0x%02x (%s)\n", ec, ec_desc);
 
+    if ((ec == 0b100101 || ec == 0b100100) && Arch::Arm::MMU::is_guard_page(far_el1)) {
+        Kernel::kprintf("Fault address is a stack guard page: stack overflow.\n");
+    }
+
     // For critical ones like Data Abort, print more details
     // if (ec == 0b100100 || ec == 0b100101) {
         // ISS field contains details
@@ -93,21 +149,42 @@ void c_sync_handler(TrapFrame* frame) {
     Kernel::panic("Unhandled Synchronous Exception.");
 }
 
-void c_irq_handler(TrapFrame* frame) {
-    (void)frame; // Trap frame might be useful for context switching later
+void c_irq_handler(IrqFrame* frame) {
     // Kernel::kprintf("IRQ received! ELR=0x%llx\n", frame->elr_el1); // Debug
+    CpuIrqState* cpu = this_cpu_irq_state();
+    kstd::uint64_t outer_entry = cpu->entry_ticks; // Of the IRQ this one preempted, if any
+    const IrqFrame* outer_frame = cpu->frame;
+    kstd::uint64_t outer_fp = cpu->frame_fp;
+    cpu->entry_ticks = frame->entry_ticks;
+    // The vector leaves x29 alone, so this function's frame record links to the interrupted one
+    cpu->frame = frame;
+    cpu->frame_fp = *static_cast<kstd::uint64_t*>(__builtin_frame_address(0));
+    // IRQs were unmasked where this one arrived, so the masked section starts at the vector
+    if (Kernel::Trace::irqsoff_tracing) {
+        Kernel::Trace::irqsoff_begin_at(frame->entry_ticks, reinterpret_cast<kstd::uintptr_t>(&c_irq_handler));
+    }
 
     // Get the interrupt controller and dispatch the IRQ
     Kernel::InterruptController* ic = Kernel::get_interrupt_controller();
     if (ic) {
         // The GIC driver's dispatch_interrupt will read the GICC_IAR
-        // to get the IRQ number and call the registered handler.
-        ic->dispatch_interrupt(0); // Pass a dummy IRQ number for now, GIC will find the real one.
+        // to get the IRQ number and call the registered handler. At the deepest level the
+        // handlers run with IRQs masked: there is no save area for another one.
+        ic->dispatch_interrupt(cpu->nesting < IRQ_MAX_NESTING);
+        // Second halves once, on the way out of the outermost IRQ: every EOI is sent, so any
+        // hardware IRQ can preempt them (and nests at most IRQ_MAX_NESTING - 1 deep)
+        if (cpu->nesting == 1) {
+            Kernel::SoftIrq::run_pending();
+        }
     } else {
         Kernel::kprintf("IRQ: No interrupt controller available!\n");
         // Optionally, could try a default EOI to GIC if its address is known,
         // but without a driver, it's risky.
     }
+    cpu->entry_ticks = outer_entry;
+    cpu->frame = outer_frame;
+    cpu->frame_fp = outer_fp;
+    if (Kernel::Trace::irqsoff_tracing) Kernel::Trace::irqsoff_end(Kernel::current_pc()); // ERET unmasks
 }
 
 void c_fiq_handler(TrapFrame* frame) {
@@ -136,6 +213,23 @@ void c_default_handler(TrapFrame* frame) {
 
 // Implementation for enabling/disabling CPU interrupts (wrappers around assembly)
 namespace Kernel {
+    kstd::uint64_t irq_entry_ticks() {
+        return this_cpu_irq_state()->entry_ticks;
+    }
+
+    bool in_irq() {
+        return this_cpu_irq_state()->nesting != 0;
+    }
+
+    bool irq_interrupted_context(InterruptedContext& context) {
+        const CpuIrqState* cpu = this_cpu_irq_state();
+        if (!cpu->nesting || !cpu->frame) return false;
+        context.pc = cpu->frame->elr_el1;
+        context.spsr = cpu->frame->spsr_el1;
+        context.fp = cpu->frame_fp;
+        return true;
+    }
+
     void enable_cpu_interrupts_platform() {
         _enable_cpu_interrupts();
     }
@@ -144,71 +238,3 @@ namespace Kernel {
         _disable_cpu_interrupts();
     }
 } // namespace Kernel
-
-// The Makefile needs to include exceptions.cpp in CPP_SOURCES
-// It's currently commented out or missing from the initial Makefile.
-// $(ARCH_CORE_DIR)/exceptions.cpp should be added.
-// (Actually, it's not in the initial Makefile's CPP_SOURCES, this needs to be added)
-//
-// The TrapFrame struct also needs to be accurate.
-// The order in exceptions.S is:
-// PUSH x0-x29, x30 (LR)
-// PUSH SPSR_EL1, ELR_EL1
-// So on stack (low address to high):
-// SPSR_EL1, ELR_EL1  <- sp points here when c_handler is called
-// x30 (LR), XZR_PAD
-// x28, x29
-// ...
-// x0, x1
-// So, the TrapFrame struct should be:
-// struct TrapFrame {
-//   kstd::uint64_t spsr_el1;
-//   kstd::uint64_t elr_el1;
-//   kstd::uint64_t x30_lr;
-//   kstd::uint64_t xzr_pad; // For the x30 pair store
-//   kstd::uint64_t x28_x29[2]; // Or individual x28, x29
-//   // ... down to x0, x1
-//   // This is complex to define perfectly without seeing the full stack layout.
-//   // A simpler way is to pass 'sp' as `void*` or `kstd::uint64_t*`
-//   // and then cast and access offsets carefully in the C handler.
-//   // For example:
-//   // void c_irq_handler(kstd::uint64_t* stack_ptr) {
-//   //    kstd::uint64_t spsr = stack_ptr[0];
-//   //    kstd::uint64_t elr  = stack_ptr[1];
-//   //    kstd::uint64_t lr   = stack_ptr[2];
-//   //    ...
-//   // }
-//   // The current TrapFrame* frame assumes frame points to the base of where SPSR/ELR are.
-// }
-// The current TrapFrame definition will be used, assuming 'sp' passed to C handler correctly points to SPSR_EL1.
-// The GPRs part of TrapFrame is simplified; a full definition would list all saved GPRs.
-// For now, only SPSR_EL1 and ELR_EL1 are explicitly used from the frame in these handlers.
-// If other registers are needed, the TrapFrame struct and assembly must be perfectly synced.
-// Let's refine TrapFrame to match the save order more explicitly for clarity.
-// The current definition `kstd::uint64_t gpr[31];` is problematic for indexing.
-//
-// The `exception_stub` macro saves:
-// SPSR_EL1, ELR_EL1 (at sp)
-// x30, XZR (at sp+16)
-// x28, x29 (at sp+32) ... x0, x1 (at sp+32 + 14*16 = sp+256)
-// Total size: 16 (SPSR/ELR) + 16 (LR/XZR) + 15*16 (x0-x29) = 16+16+240 = 272 bytes.
-// So, TrapFrame should reflect this.
-// struct TrapFrame {
-//    kstd::uint64_t spsr_el1;
-//    kstd::uint64_t elr_el1;
-//    kstd::uint64_t x30; // LR
-//    kstd::uint64_t xzr_padding_for_x30;
-//    kstd::uint64_t x29; kstd::uint64_t x28;
-//    // ... and so on for x27 down to x0.
-//    // This is error prone. A union or direct array access from base `sp` is safer.
-//    // For now, we only use spsr_el1 and elr_el1 from it, which are at the base.
-// }
-// The simple TrapFrame with just spsr_el1 and elr_el1 used for now is fine as only those are accessed.
-// If GPRs from frame are needed later, this must be revisited.
-//
-// The Makefile needs to be updated to include this file.
-// Add `$(ARCH_CORE_DIR)/exceptions.cpp` to `CPP_SOURCES`.
-//
-// Also, the linker script change mentioned in exceptions.S:
-// Add `.vectors : ALIGN(2K) { KEEP(*(.vectors)) }`
-// I will do this after the GIC driver.
@@ -1,10 +1,9 @@
 #include "gic.h"
 #include <kernel/console.h> // For kprintf
-#include <kstd/cstring.h>   // For kmemset for handlers array
+#include <kernel/init/initcall.h> // For KERNEL_INITCALL
 
-// External assembly functions for CPU interrupt enable/disable
-extern "C" void _enable_cpu_interrupts();
-extern "C" void _disable_cpu_interrupts();
+#include <kernel/irqflags.h> // For irq_enable/irq_disable (traced)
+#include <kernel/smp.h>      // For cpu_id, online_cpus
 
 
 namespace Arch {
@@ -24,11 +23,18 @@ void gic_init_global() {
     g_gic_driver.enable_cpu_interrupts();
     Kernel::kprintf("GIC initialized and CPU IRQs enabled.\n");
 }
+KERNEL_INITCALL(INITCALL_LEVEL_ARCH, "gic", gic_init_global);
 
 
 GICDriver::GICDriver(kstd::uintptr_t dist_base, kstd::uintptr_t cpu_if_base)
     : gicd_base_addr(dist_base), gicc_base_addr(cpu_if_base) {
-    kstd::kmemset(handlers, 0, sizeof(handlers));
+    for (unsigned int i = 0; i < Kernel::MAX_IRQS; ++i) {
+        handlers[i].handler = unhandled_irq;
+        handlers[i].context = this;
+        for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) handlers[i].count[cpu] = 0;
+        handlers[i].last_eoi = 0;
+        handlers[i].priority = Kernel::IRQ_PRIORITY_DEFAULT;
+    }
 }
 
 void GICDriver::init() {
@@ -47,13 +53,15 @@ void GICDriver::init() {
         Kernel::kprintf("Warning: GIC reports %u lines, clamping or check MAX_IRQS.\n", num_irq_lines);
         // num_irq_lines = Kernel::MAX_IRQS; // Or handle error
     }
+    identify_cpu_interface();
+    kstd::uint8_t boot_cpu_interface = cpu_interface[Kernel::cpu_id()];
 
 
     // 3. Configure all SPIs (Shared Peripheral Interrupts, IRQID 32 upwards)
     //    - Set to Group 1 (for Non-Secure EL1 handling, if applicable, or just default group)
     //    - Set to be level-triggered by default (can be changed per IRQ)
     //    - Set default priority (e.g., 0xA0 - lower value is higher priority)
-    //    - Set target to CPU 0
+    //    - Set target to the boot CPU (set_affinity moves them later)
     //    - Disable all SPIs initially
     for (unsigned int i = 32; i < num_irq_lines && i < Kernel::MAX_IRQS; ++i) {
         // Set to Group 1 (non-secure, if GICD_CTLR.DS (Disable Security) is 0)
@@ -63,22 +71,19 @@ void GICDriver::init() {
         // gicd_write(GICD_IGROUPR0 + (i / 32) * 4, group_reg_val);
         // For simplicity, let's assume Group 0 or that security extensions aren't primary focus here.
 
-        // Default priority (0xA0 is a common default, lower value = higher prio)
-        gicd_write(GICD_IPRIORITYR0 + (i / 4) * 4 + (i % 4), 0xA0);
+        // Default priority (lower value = higher prio); register_handler sets the real one
+        set_irq_priority(i, Kernel::IRQ_PRIORITY_DEFAULT);
 
         // Default trigger: level-sensitive for SPIs
         configure_irq_trigger(i, false); // false for level-sensitive
 
-        // Target SPIs to CPU 0
-        set_irq_target_cpu0(i);
+        // Target SPIs to the boot CPU (one byte per SPI)
+        gicd_write8(GICD_ITARGETSR0 + i, boot_cpu_interface);
 
         // Disable interrupt
         gicd_write(GICD_ICENABLER0 + (i / 32) * 4, (1 << (i % 32)));
     }
 
-    // PPIs (16-31) and SGIs (0-15) are per-CPU and have fixed configurations for trigger type.
-    // Priorities for PPIs/SGIs can be set if needed.
-
     // 4. Enable distributor (Group 0 and Group 1, if applicable)
     // GICD_CTLR: Bit 0 enables Group 0, Bit 1 enables Group 1 (non-secure)
     // For simple single EL1 setup, just enabling Group 0 might be enough if not using security extensions.
@@ -88,15 +93,46 @@ void GICDriver::init() {
 
 
     // --- Initialize CPU Interface (GICC) ---
+    init_cpu_interface();
+
+    Kernel::kprintf("GIC Driver Initialized.\n");
+}
+
+
+void GICDriver::init_cpu() {
+    identify_cpu_interface();
+    init_cpu_interface();
+}
+
+void GICDriver::identify_cpu_interface() {
+    // GICD_ITARGETSR0-7 (SGIs/PPIs) are banked and read as the calling CPU's own interface bit.
+    // A uniprocessor GIC reads them as zero and ignores the targets anyway.
+    unsigned int cpu = Kernel::cpu_id();
+    kstd::uint8_t interface = gicd_read8(GICD_ITARGETSR0);
+    cpu_interface[cpu] = interface ? interface : static_cast<kstd::uint8_t>(1u << cpu);
+}
+
+void GICDriver::init_cpu_interface() {
+    // PPIs (16-31) and SGIs (0-15) are per-CPU and have fixed configurations for trigger type.
+    // Their priorities are banked per CPU: each CPU sets its own copy, from the handler table
+    // (the default for IRQs without a handler). A per-CPU IRQ registered later only gets its
+    // priority on the registering CPU and on cores initialized after that.
+    for (unsigned int i = 0; i < 32; ++i) {
+        set_irq_priority(i, handlers[i].priority);
+    }
+    // SGI enables are banked as well. Registered SGIs (IPIs) are meant for every core.
+    for (unsigned int i = 0; i < 16; ++i) {
+        if (has_handler(i)) gicd_write(GICD_ISENABLER0, 1u << i);
+    }
+
     // 1. Set Interrupt Priority Mask Register (GICC_PMR)
     //    Allows all priorities (lowest priority value 0xFF)
     gicc_write(GICC_PMR, 0xFF);
 
     // 2. Set Binary Point Register (GICC_BPR)
-    //    Controls preemption. Group priority field split.
-    //    e.g., 0x03 for no preemption group, full subpriority. Or 0x07 for no subpriorities.
-    //    For simplicity, let's use a value that allows all priorities to be distinct.
-    gicc_write(GICC_BPR, 0x03); // Allows for priority grouping if needed.
+    //    Controls preemption: only a higher group priority (bits above the binary point)
+    //    preempts a running handler. See GIC_BINARY_POINT.
+    gicc_write(GICC_BPR, GIC_BINARY_POINT);
 
     // 3. Enable CPU interface (and EOI mode if GICv2)
     //    GICC_CTLR: Bit 0 enables signaling of Group 0 interrupts to CPU.
@@ -106,11 +142,8 @@ void GICDriver::init() {
     kstd::uint32_t cpu_ctlr = 0x00000001; // Enable Group 0 interrupt signaling
     // if (is_gicv2_and_security_extensions_active) cpu_ctlr |= (1<<9); // EOImodeNS for separate EOI/priority drop
     gicc_write(GICC_CTLR, cpu_ctlr);
-
-    Kernel::kprintf("GIC Driver Initialized.\n");
 }
 
-
 void GICDriver::enable_irq(unsigned int irq_num) {
     if (irq_num >= num_irq_lines || irq_num >= Kernel::MAX_IRQS) {
         Kernel::kprintf("GIC: enable_irq: Invalid IRQ %u\n", irq_num);
@@ -129,122 +162,156 @@ void GICDriver::disable_irq(unsigned int irq_num) {
     gicd_write(GICD_ICENABLER0 + (irq_num / 32) * 4, (1 << (irq_num % 32)));
 }
 
-void GICDriver::end_of_interrupt(unsigned int irq_num) {
-    // This function signals completion of handling for the specified IRQ.
-    // For GICv2, this involves writing to GICC_EOIR.
-    // The value written should be the IRQ number that was read from GICC_IAR.
-    // Kernel::kprintf("GIC: EOI for IRQ %u\n", irq_num);
-    gicc_write(GICC_EOIR, irq_num);
-}
-
-bool GICDriver::register_handler(unsigned int irq_num, Kernel::InterruptHandler handler, void* context) {
-    if (irq_num >= Kernel::MAX_IRQS) { // Check against our handler array size
-        Kernel::kprintf("GIC: register_handler: IRQ %u out of bounds for handler array (max %u)\n", irq_num, Kernel::MAX_IRQS-1);
+bool GICDriver::register_handler(unsigned int irq_num, Kernel::InterruptHandler handler, void* context,
+                                 kstd::uint8_t priority) {
+    if (irq_num >= Kernel::MAX_IRQS || !handler) {
+        Kernel::kprintf("GIC: register_handler: Invalid IRQ %u or null handler\n", irq_num);
         return false;
     }
-    if (handlers[irq_num].is_registered) {
+    if (has_handler(irq_num)) {
         Kernel::kprintf("GIC: register_handler: IRQ %u already has a handler.\n", irq_num);
         return false; // Or allow overriding
     }
-    handlers[irq_num].handler = handler;
+    // Context first: the IRQ may already be enabled and must never see a half-written slot
+    set_irq_priority(irq_num, priority);
+    handlers[irq_num].priority = priority;
     handlers[irq_num].context = context;
-    handlers[irq_num].is_registered = true;
-    // Kernel::kprintf("GIC: Registered handler for IRQ %u at 0x%p\n", irq_num, (void*)handler);
+    for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) handlers[irq_num].count[cpu] = 0;
+    handlers[irq_num].handler = handler;
     return true;
 }
 
 bool GICDriver::unregister_handler(unsigned int irq_num) {
-    if (irq_num >= Kernel::MAX_IRQS) return false;
-    if (!handlers[irq_num].is_registered) return false; // No handler to unregister
+    if (!has_handler(irq_num)) return false; // No handler to unregister
 
-    handlers[irq_num].is_registered = false;
-    handlers[irq_num].handler = nullptr;
-    handlers[irq_num].context = nullptr;
+    handlers[irq_num].handler = unhandled_irq;
+    handlers[irq_num].context = this;
+    handlers[irq_num].priority = Kernel::IRQ_PRIORITY_DEFAULT;
+    set_irq_priority(irq_num, Kernel::IRQ_PRIORITY_DEFAULT);
     return true;
 }
 
-void GICDriver::dispatch_interrupt(unsigned int dummy_irq_num) {
-    (void)dummy_irq_num; // Not used, we read IAR
-
-    // 1. Acknowledge interrupt and get IRQ ID by reading GICC_IAR
-    //    Bits 9:0 give IRQ ID. Bits 12:10 give CPUID (for SGIs from other cores).
-    kstd::uint32_t iar_val = gicc_read(GICC_IAR);
-    unsigned int irq_id = iar_val & 0x3FF; // Mask for IRQ ID (10 bits for GICv2)
+bool GICDriver::has_handler(unsigned int irq_num) const {
+    return irq_num < Kernel::MAX_IRQS && handlers[irq_num].handler != unhandled_irq;
+}
 
-    // Kernel::kprintf("GIC: Dispatching IRQ. IAR=0x%x, IRQ_ID=%u\n", iar_val, irq_id);
+kstd::uint64_t GICDriver::irq_count(unsigned int irq_num) const {
+    kstd::uint64_t total = 0;
+    for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) total += irq_count_cpu(irq_num, cpu);
+    return total;
+}
 
+kstd::uint64_t GICDriver::irq_count_cpu(unsigned int irq_num, unsigned int cpu) const {
+    return has_handler(irq_num) && cpu < Kernel::MAX_CPUS ? handlers[irq_num].count[cpu] : 0;
+}
 
-    if (irq_id >= 1020 && irq_id <= 1023) { // Spurious interrupt or special ID
-        Kernel::kprintf("GIC: Spurious interrupt or special ID %u. Ignoring.\n", irq_id);
-        // For spurious interrupts, no EOI is typically needed, but check GIC spec.
-        // If it's a real IRQ ID that's special, might need handling.
-        // For now, we just print and don't EOI if it's clearly spurious (e.g. 1023).
-        if (irq_id != 1023) { // Don't EOI spurious IRQ 1023
-             gicc_write(GICC_EOIR, irq_id); // Still EOI other "valid" special IDs if any
-        }
-        return;
+bool GICDriver::set_affinity(unsigned int irq_num, kstd::uint32_t cpu_mask) {
+    if (irq_num < 32 || irq_num >= num_irq_lines || irq_num >= Kernel::MAX_IRQS) return false;
+    if (!cpu_mask || (cpu_mask & ~Kernel::online_cpus())) return false;
+    kstd::uint8_t targets = 0;
+    for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) {
+        if (cpu_mask & (1u << cpu)) targets |= cpu_interface[cpu];
     }
+    // One byte per SPI: no read-modify-write that could race with another IRQ's update.
+    // Takes effect the next time the IRQ becomes pending; an active one finishes where it is.
+    gicd_write8(GICD_ITARGETSR0 + irq_num, targets);
+    return true;
+}
 
-    if (irq_id >= num_irq_lines && irq_id < 1020) { // Check against GIC reported lines, but allow up to GIC max for safety
-        Kernel::kprintf("GIC: IRQ ID %u out of expected range (max %u from TYPER).\n", irq_id, num_irq_lines);
-        gicc_write(GICC_EOIR, irq_id); // EOI it to be safe
-        return;
+kstd::uint32_t GICDriver::affinity(unsigned int irq_num) const {
+    if (irq_num < 32 || irq_num >= num_irq_lines || irq_num >= Kernel::MAX_IRQS) return 0;
+    kstd::uint8_t targets = gicd_read8(GICD_ITARGETSR0 + irq_num);
+    kstd::uint32_t cpu_mask = 0;
+    for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) {
+        if (targets & cpu_interface[cpu]) cpu_mask |= 1u << cpu;
     }
-    if (irq_id >= Kernel::MAX_IRQS) { // Check against our handler array size
-         Kernel::kprintf("GIC: IRQ ID %u out of bounds for handler array (max %u).\n", irq_id, Kernel::MAX_IRQS-1);
-         gicc_write(GICC_EOIR, irq_id); // EOI it
-         return;
+    return cpu_mask;
+}
+
+void GICDriver::send_sgi(unsigned int sgi_num, kstd::uint32_t cpu_mask) {
+    if (sgi_num >= 16) return;
+    kstd::uint8_t targets = 0;
+    for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) {
+        if (cpu_mask & (1u << cpu)) targets |= cpu_interface[cpu];
     }
+    if (!targets) return;
+    // The SGIR write is a Device access: order the caller's Normal memory writes before it.
+    // TargetListFilter 0 (use the list), CPUTargetList in bits 23:16.
+    asm volatile("dsb ishst" ::: "memory");
+    gicd_write(GICD_SGIR, (static_cast<kstd::uint32_t>(targets) << 16) | sgi_num);
+}
+
+kstd::uint64_t GICDriver::irq_eoi_ticks(unsigned int irq_num) const {
+    return irq_num < Kernel::MAX_IRQS ? handlers[irq_num].last_eoi : 0;
+}
 
+kstd::uint8_t GICDriver::irq_priority(unsigned int irq_num) const {
+    return irq_num < Kernel::MAX_IRQS ? handlers[irq_num].priority : Kernel::IRQ_PRIORITY_DEFAULT;
+}
 
-    // 2. Call registered handler
-    if (handlers[irq_id].is_registered && handlers[irq_id].handler) {
-        handlers[irq_id].handler(irq_id, handlers[irq_id].context);
-    } else {
-        Kernel::kprintf("GIC: Unhandled IRQ %u\n", irq_id);
-        // Optionally disable it to prevent interrupt storms
-        // disable_irq(irq_id);
+Kernel::InterruptStats GICDriver::stats() const {
+    Kernel::InterruptStats total = {0, 0};
+    for (unsigned int cpu = 0; cpu < Kernel::MAX_CPUS; ++cpu) {
+        total.spurious += irq_stats[cpu].spurious;
+        total.unhandled += irq_stats[cpu].unhandled;
     }
+    return total;
+}
+
+void GICDriver::unhandled_irq(unsigned int irq_num, void* context) {
+    GICDriver* gic = static_cast<GICDriver*>(context);
+    gic->irq_stats[Kernel::cpu_id()].unhandled++;
+    gic->disable_irq(irq_num);
+}
 
-    // 3. Signal End of Interrupt (EOI) by writing IRQ ID to GICC_EOIR
-    //    This is done by the handler calling end_of_interrupt(irq_id)
-    //    OR, if handlers don't call it, it must be done here.
-    //    It's generally better if the handler (or a common wrapper) calls EOI.
-    //    For now, let's assume handlers will call end_of_interrupt().
-    //    If a handler panics or doesn't EOI, the system might hang on that IRQ.
-    //    The current InterruptController interface has end_of_interrupt(), so handlers should use it.
-    //    If we EOI here, then handlers calling it too would be an error.
-    //    Let's assume for now the handler is responsible for EOI.
-    //    If no handler, we should EOI here.
-    if (!handlers[irq_id].is_registered || !handlers[irq_id].handler) {
-        gicc_write(GICC_EOIR, irq_id); // EOI for unhandled IRQs
+void GICDriver::dispatch_interrupt(bool allow_preemption) {
+    // Acknowledge, handle and end IRQs until the GIC has nothing pending for this CPU, so a burst
+    // costs one exception entry. IAR bits 9:0 are the interrupt ID (bits 12:10 the source CPU of
+    // an SGI); EOIR takes the whole IAR value back. IDs 1020-1023 are never acknowledged, so
+    // they get no EOI; 1023 on the first read means the IRQ went away before we got here.
+    //
+    // Acknowledging raises the CPU interface's running priority to the IRQ's group priority
+    // until its EOI, so with IRQs unmasked the GIC only signals more urgent groups: a nested
+    // entry never picks up an IRQ this loop would have handled. IAR is read with IRQs masked.
+    // Counters are per CPU, so cores dispatching at the same time never share one.
+    unsigned int cpu = Kernel::cpu_id();
+    kstd::uint32_t iar = gicc_read(GICC_IAR);
+    unsigned int irq_id = iar & 0x3FF;
+    if (irq_id >= 1020) {
+        irq_stats[cpu].spurious++;
+        return;
     }
-    // Note: The logic for EOI (here vs. in handler) needs to be consistent.
-    // The current model of `InterruptController::end_of_interrupt` implies the handler or
-    // a common C IRQ dispatcher (that calls the handler) would call it.
-    // Our `c_irq_handler` calls `ic->dispatch_interrupt`, and `dispatch_interrupt` calls the handler.
-    // So, if the registered handler is expected to call `ic->end_of_interrupt(irq_id)`, then
-    // this `dispatch_interrupt` function should NOT EOI itself, UNLESS there's no handler.
+    do {
+        Kernel::InterruptRegistration& entry = handlers[irq_id];
+        entry.count[cpu]++;
+        if (allow_preemption) {
+            Kernel::irq_enable();
+            entry.handler(irq_id, entry.context);
+            Kernel::irq_disable();
+        } else {
+            entry.handler(irq_id, entry.context);
+        }
+        gicc_write(GICC_EOIR, iar);
+        asm volatile("mrs %0, cntpct_el0" : "=r"(entry.last_eoi) : : "memory");
+
+        iar = gicc_read(GICC_IAR);
+        irq_id = iar & 0x3FF;
+    } while (irq_id < 1020);
 }
 
 
 void GICDriver::enable_cpu_interrupts() {
-    _enable_cpu_interrupts();
+    Kernel::irq_enable();
 }
 
 void GICDriver::disable_cpu_interrupts() {
-    _disable_cpu_interrupts();
+    Kernel::irq_disable();
 }
 
-void GICDriver::set_irq_target_cpu0(unsigned int spi_num) {
-    if (spi_num < 32) return; // Only for SPIs (Shared Peripheral Interrupts)
-    kstd::uintptr_t reg_offset = GICD_ITARGETSR0 + (spi_num / 4) * 4; // Each reg holds 4 targets (8 bits each)
-    unsigned int shift = (spi_num % 4) * 8;
-
-    kstd::uint32_t val = gicd_read(reg_offset);
-    val &= ~(0xFF << shift); // Clear current target for this SPI
-    val |= (0x01 << shift);  // Target CPU interface 0 (bitmask, 0x01 for CPU0, 0x02 for CPU1 etc.)
-    gicd_write(reg_offset, val);
+void GICDriver::set_irq_priority(unsigned int irq_num, kstd::uint8_t priority) {
+    if (irq_num >= Kernel::MAX_IRQS) return;
+    // One byte per interrupt; the GIC ignores the low bits it does not implement
+    gicd_write8(GICD_IPRIORITYR0 + irq_num, priority);
 }
 
 void GICDriver::configure_irq_trigger(unsigned int irq_num, bool edge_triggered) {
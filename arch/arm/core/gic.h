@@ -30,7 +30,7 @@ constexpr kstd::uintptr_t GICD_ICACTIVER0= 0x380; // Interrupt Clear-Active Regi
 constexpr kstd::uintptr_t GICD_IPRIORITYR0=0x400; // Interrupt Priority Registers (n=0-254 for 1020 IRQs)
 constexpr kstd::uintptr_t GICD_ITARGETSR0= 0x800; // Interrupt Processor Targets Registers (n=0-254) (SPIs only)
 constexpr kstd::uintptr_t GICD_ICFGR0    = 0xC00; // Interrupt Configuration Registers (n=0-63 for 1024 IRQs)
-// constexpr kstd::uintptr_t GICD_SGIR      = 0xF00; // Software Generated Interrupt Register (GICv1, v2)
+constexpr kstd::uintptr_t GICD_SGIR      = 0xF00; // Software Generated Interrupt Register (GICv1, v2)
 
 // GIC CPU Interface (GICC) register offsets
 constexpr kstd::uintptr_t GICC_CTLR      = 0x00;  // CPU Interface Control Register
@@ -40,6 +40,11 @@ constexpr kstd::uintptr_t GICC_IAR       = 0x0C;  // Interrupt Acknowledge Regis
 constexpr kstd::uintptr_t GICC_EOIR      = 0x10;  // End of Interrupt Register
 constexpr kstd::uintptr_t GICC_RPR       = 0x14;  // Running Priority Register
 constexpr kstd::uintptr_t GICC_HPPIR     = 0x18;  // Highest Priority Pending Interrupt Register
+
+// GICC_BPR: priority bits above the binary point form the group priority that decides
+// preemption; 3 splits at bit 4 (bit 3 for the Non-secure copy), so the IRQ_PRIORITY_*
+// levels are distinct groups and the bits below only order pending IRQs within a group.
+constexpr kstd::uint32_t GIC_BINARY_POINT = 3;
 // constexpr kstd::uintptr_t GICC_IIDR      = 0xFC;  // CPU Interface Identification Register
 
 
@@ -49,12 +54,23 @@ public:
     ~GICDriver() override = default;
 
     void init() override;
+    void init_cpu() override;
     void enable_irq(unsigned int irq_num) override;
     void disable_irq(unsigned int irq_num) override;
-    void end_of_interrupt(unsigned int irq_num) override; // Also acknowledges the IRQ
-    bool register_handler(unsigned int irq_num, Kernel::InterruptHandler handler, void* context) override;
+    bool register_handler(unsigned int irq_num, Kernel::InterruptHandler handler, void* context,
+                          kstd::uint8_t priority) override;
     bool unregister_handler(unsigned int irq_num) override;
-    void dispatch_interrupt(unsigned int dummy_irq_num) override; // Reads IAR to get actual IRQ
+    // Acknowledges (GICC_IAR) and ends (GICC_EOIR) every pending IRQ in one exception entry
+    void dispatch_interrupt(bool allow_preemption) override;
+    Kernel::InterruptStats stats() const override;
+    bool set_affinity(unsigned int irq_num, kstd::uint32_t cpu_mask) override;
+    kstd::uint32_t affinity(unsigned int irq_num) const override;
+    void send_sgi(unsigned int sgi_num, kstd::uint32_t cpu_mask) override;
+    kstd::uint64_t irq_count(unsigned int irq_num) const override;
+    kstd::uint64_t irq_count_cpu(unsigned int irq_num, unsigned int cpu) const override;
+    kstd::uint8_t irq_priority(unsigned int irq_num) const override;
+    kstd::uint64_t irq_eoi_ticks(unsigned int irq_num) const override;
+    bool has_handler(unsigned int irq_num) const override;
 
     void enable_cpu_interrupts() override;
     void disable_cpu_interrupts() override;
@@ -63,15 +79,31 @@ private:
     kstd::uintptr_t gicd_base_addr; // Distributor base
     kstd::uintptr_t gicc_base_addr; // CPU interface base
 
+    // Indexed by the interrupt ID from GICC_IAR, no range checks on the dispatch path
     Kernel::InterruptRegistration handlers[Kernel::MAX_IRQS];
+    Kernel::InterruptStats irq_stats[Kernel::MAX_CPUS] = {}; // Per CPU, summed by stats()
+
+    // GICD_ITARGETSR bit of each CPU's interface, read by that CPU in init()/init_cpu().
+    // Indexed by Kernel::cpu_id(); 0 until the CPU has initialized its interface.
+    kstd::uint8_t cpu_interface[Kernel::MAX_CPUS] = {};
+
+    // Fallback in every free slot: counts the IRQ and disables it, so a level-triggered
+    // source without a driver cannot storm
+    static void unhandled_irq(unsigned int irq_num, void* context);
 
     // MMIO helpers
     inline void gicd_write(kstd::uintptr_t offset, kstd::uint32_t value) {
         *(volatile kstd::uint32_t*)(gicd_base_addr + offset) = value;
     }
+    inline void gicd_write8(kstd::uintptr_t offset, kstd::uint8_t value) { // Byte-accessible registers
+        *(volatile kstd::uint8_t*)(gicd_base_addr + offset) = value;
+    }
     inline kstd::uint32_t gicd_read(kstd::uintptr_t offset) {
         return *(volatile kstd::uint32_t*)(gicd_base_addr + offset);
     }
+    inline kstd::uint8_t gicd_read8(kstd::uintptr_t offset) const {
+        return *(volatile kstd::uint8_t*)(gicd_base_addr + offset);
+    }
     inline void gicc_write(kstd::uintptr_t offset, kstd::uint32_t value) {
         *(volatile kstd::uint32_t*)(gicc_base_addr + offset) = value;
     }
@@ -79,8 +111,13 @@ private:
         return *(volatile kstd::uint32_t*)(gicc_base_addr + offset);
     }
 
-    // Helper to set interrupt target to current CPU (core 0) for SPIs
-    void set_irq_target_cpu0(unsigned int spi_num);
+    void set_irq_priority(unsigned int irq_num, kstd::uint8_t priority);
+
+    // Record the calling CPU's interface bit in cpu_interface
+    void identify_cpu_interface();
+    // Enable the calling CPU's interface, set its banked SGI/PPI priorities and enable the
+    // SGIs that have a handler
+    void init_cpu_interface();
 
     // Helper to configure IRQ as level-sensitive or edge-triggered
     // GICD_ICFGRn: 2 bits per interrupt. 00=level-sensitive, 10=edge-triggered.
@@ -3,21 +3,19 @@
 #include <kstd/cstring.h>   // For kmemset
 #include <arch/arm/peripherals/gpio.h> // For GPIO_BASE (example peripheral region)
 #include <arch/arm/core/gic.h> // For GICD_BASE, GICC_BASE (example peripheral region)
-
-// Define physical memory map constants for RPi4
-// These are approximate and for example purposes.
-// A more robust solution would get memory map from Device Tree Blob (DTB) if available.
-// RPi4 has RAM starting at 0x0.
-// Peripherals are typically in the 0xFE000000 - 0xFEFFFFFF range (BCM2711 ARM physical addresses)
-// Or more broadly, 0xFC000000 to 0xFFFFFFFF might be considered peripheral space.
-// For simplicity, we'll define a peripheral window.
-constexpr kstd::uintptr_t RPI4_PERIPHERAL_BASE_PHYS = 0xFE000000;
-constexpr kstd::uintptr_t RPI4_PERIPHERAL_END_PHYS  = 0xFFFFFFFF; // End of 32-bit mapped area for common peripherals
+#include <arch/arm/core/cache.h> // For Cache::invalidate_dcache_all before turning caches on
+#include <kernel/irqflags.h>       // For irq_save/irq_restore around the translation switch
 
 // Kernel region (example, assumes kernel is loaded low, e.g., at 0x80000)
 // Linker script defines KERNEL_START and KERNEL_END.
 extern "C" char KERNEL_START[];
 extern "C" char KERNEL_END[];
+// Section boundaries for W^X (page aligned by the linker script)
+extern "C" char RODATA_START[];
+extern "C" char DATA_START[];
+// Boot stack, set up in boot.S
+extern "C" char BOOT_STACK_TOP[];
+extern "C" char BOOT_STACK_SIZE[];
 
 
 namespace Arch {
@@ -25,97 +23,389 @@ namespace Arm {
 
 // Static page table allocations
 kstd::uint64_t MMU::l1_page_table[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
-kstd::uint64_t MMU::l2_page_table_0[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
-kstd::uint64_t MMU::l2_page_table_1[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
-
-
-void MMU::setup_page_tables() {
+kstd::uint64_t MMU::l1_kernel_table[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
+kstd::uint64_t MMU::early_l1_table[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB), section(".noinit.early_l1_table")));
+kstd::uint64_t MMU::table_pool[MMU_TABLE_POOL_SIZE][PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
+kstd::size_t MMU::tables_used = 0;
+MMU::TableAllocator MMU::table_allocator = nullptr;
+kstd::uintptr_t MMU::guard_pages[MMU::MAX_GUARD_PAGES];
+kstd::size_t MMU::guard_page_count = 0;
+Kernel::FDT::MemoryRegion MMU::ram_regions[MMU_MAX_RAM_REGIONS];
+kstd::size_t MMU::ram_region_count = 0;
+
+
+void MMU::setup_page_tables(kstd::uintptr_t dtb_address) {
     Kernel::kprintf("MMU: Setting up page tables...\n");
 
-    // Clear page tables initially
     kstd::kmemset(l1_page_table, 0, sizeof(l1_page_table));
-    kstd::kmemset(l2_page_table_0, 0, sizeof(l2_page_table_0));
-    kstd::kmemset(l2_page_table_1, 0, sizeof(l2_page_table_1));
-
-    // --- Populate L1 Table ---
-    // L1 entry for the first 1GB (VA 0x00000000 - 0x3FFFFFFF), pointing to L2_TABLE_0
-    kstd::uintptr_t l2_pt0_phys = get_physical_address(l2_page_table_0);
-    l1_page_table[0] = l2_pt0_phys | PTE_VALID | PTE_TABLE_OR_PAGE; // Table descriptor
-
-    // L1 entry for the second 1GB (VA 0x40000000 - 0x7FFFFFFF), pointing to L2_TABLE_1
-    kstd::uintptr_t l2_pt1_phys = get_physical_address(l2_page_table_1);
-    l1_page_table[1] = l2_pt1_phys | PTE_VALID | PTE_TABLE_OR_PAGE; // Table descriptor
-
-    // Other L1 entries (2 to 511) remain invalid, covering up to 512GB if populated.
-
-    Kernel::kprintf("MMU: L1 table populated (0: -> L2_0@0x%llx, 1: -> L2_1@0x%llx)\n", l2_pt0_phys, l2_pt1_phys);
-
-
-    // --- Populate L2 Tables for 2MB Blocks ---
-    // Each L2 entry covers 2MB. 512 entries cover 1GB.
-
-    // L2_TABLE_0: Identity map for VA 0x00000000 - 0x3FFFFFFF (first 1GB)
-    for (unsigned int i = 0; i < PAGE_TABLE_ENTRIES; ++i) {
-        kstd::uintptr_t current_pa = static_cast<kstd::uintptr_t>(i) * PAGE_SIZE_2MB; // Physical address = Virtual address
-        kstd::uint64_t flags = PTE_VALID | PTE_AF | PTE_SH_INNER_SHAREABLE; // Valid, Access Flag, Inner Shareable
-                                                                        // PTE_TABLE_OR_PAGE is 0 for Block entry (default)
-
-        // Determine memory type and permissions
-        if (current_pa >= RPI4_PERIPHERAL_BASE_PHYS && (current_pa + PAGE_SIZE_2MB -1) <= RPI4_PERIPHERAL_END_PHYS) {
-            // This 2MB block is within the main peripheral region
-            flags |= PTE_ATTR_INDX(MAIR_IDX_DEVICE_NGNRNE);
-            flags |= PTE_AP_EL1_RW_EL0_NONE; // EL1 R/W, EL0 No access
-            flags |= PTE_PXN | PTE_UXN;      // Execute Never for peripherals
-        } else if ( (current_pa >= (kstd::uintptr_t)KERNEL_START && current_pa < (kstd::uintptr_t)KERNEL_END) ||
-                    ((current_pa + PAGE_SIZE_2MB -1) >= (kstd::uintptr_t)KERNEL_START && (current_pa + PAGE_SIZE_2MB -1) < (kstd::uintptr_t)KERNEL_END) ) {
-            // This 2MB block overlaps with kernel image region
-            flags |= PTE_ATTR_INDX(MAIR_IDX_NORMAL_C); // Normal Cacheable for Kernel
-            flags |= PTE_AP_EL1_RW_EL0_NONE;          // EL1 R/W, EL0 No access
-            // Allow kernel execution (PXN=0, UXN=1)
-            flags &= ~PTE_PXN; // Privileged Execute
-            flags |= PTE_UXN;  // Unprivileged Execute Never
-        } else {
-            // General RAM
-            flags |= PTE_ATTR_INDX(MAIR_IDX_NORMAL_C); // Normal Cacheable for RAM
-            flags |= PTE_AP_EL1_RW_EL0_NONE;          // EL1 R/W for now, can be EL0_RW if user space planned
-            flags |= PTE_PXN | PTE_UXN;               // Execute Never for general RAM
+    kstd::kmemset(l1_kernel_table, 0, sizeof(l1_kernel_table));
+    tables_used = 0;
+    guard_page_count = 0;
+
+    // --- RAM ranges from the device tree ---
+    const void* dtb = reinterpret_cast<const void*>(dtb_address);
+    ram_region_count = Kernel::FDT::memory_regions(dtb, ram_regions, MMU_MAX_RAM_REGIONS);
+    if (ram_region_count == 0) {
+        Kernel::kprintf("MMU: No usable device tree at 0x%llx, assuming %llu MB of RAM.\n",
+                        dtb_address, RPI4_FALLBACK_RAM_SIZE >> 20);
+        ram_regions[0].base = 0;
+        ram_regions[0].size = RPI4_FALLBACK_RAM_SIZE;
+        ram_region_count = 1;
+    }
+
+    // --- Normal cacheable RAM, RW, XN ---
+    // Ranges are widened to 2MB so no L3 tables are needed; map_range picks 1GB blocks for
+    // every whole aligned gigabyte and 2MB blocks (with contiguous hints) for the rest.
+    for (kstd::size_t i = 0; i < ram_region_count; ++i) {
+        kstd::uintptr_t start = ram_regions[i].base & ~(PAGE_SIZE_2MB - 1);
+        kstd::uintptr_t end = (ram_regions[i].base + ram_regions[i].size + PAGE_SIZE_2MB - 1) & ~(PAGE_SIZE_2MB - 1);
+        // Never let RAM attributes cover the peripheral window
+        if (start < RPI4_PERIPHERAL_WINDOW_END && end > RPI4_PERIPHERAL_WINDOW_BASE) {
+            end = start < RPI4_PERIPHERAL_WINDOW_BASE ? RPI4_PERIPHERAL_WINDOW_BASE : start;
+        }
+        if (end <= start) continue;
+        if (!map_range(start, start, end - start, MAP_KERNEL_RW)) {
+            Kernel::panic("MMU: Failed to map RAM.");
         }
-        l2_page_table_0[i] = current_pa | flags;
+        Kernel::kprintf("MMU: RAM 0x%llx-0x%llx (%llu MB)\n", start, end, (end - start) >> 20);
+    }
+
+    // --- Peripheral window: Device-nGnRnE, RW, XN ---
+    // GICD_BASE (0xFF841000), GICC_BASE and the ARM local block sit in the top 8MB of this window.
+    if (!map_range(RPI4_PERIPHERAL_WINDOW_BASE, RPI4_PERIPHERAL_WINDOW_BASE,
+                   RPI4_PERIPHERAL_WINDOW_END - RPI4_PERIPHERAL_WINDOW_BASE, MAP_DEVICE_RW)) {
+        Kernel::panic("MMU: Failed to map the peripheral window.");
+    }
+    Kernel::kprintf("MMU: Peripherals 0x%llx-0x%llx (device)\n", RPI4_PERIPHERAL_WINDOW_BASE, RPI4_PERIPHERAL_WINDOW_END);
+
+    apply_kernel_layout();
+    Kernel::kprintf("MMU: %u page tables in use.\n", static_cast<unsigned int>(tables_used + 1));
+}
+
+kstd::size_t MMU::get_ram_regions(const Kernel::FDT::MemoryRegion** regions) {
+    if (regions) *regions = ram_regions;
+    return ram_region_count;
+}
+
+void MMU::apply_kernel_layout() {
+    kstd::uintptr_t text_start = reinterpret_cast<kstd::uintptr_t>(KERNEL_START);
+    kstd::uintptr_t rodata_start = reinterpret_cast<kstd::uintptr_t>(RODATA_START);
+    kstd::uintptr_t data_start = reinterpret_cast<kstd::uintptr_t>(DATA_START);
+
+    // .vectors + .text: read/execute. .rodata: read-only. .data/.bss keep the RW, XN default.
+    bool ok = protect_range(text_start, rodata_start - text_start, MAP_KERNEL_RX) &&
+              protect_range(rodata_start, data_start - rodata_start, MAP_KERNEL_RO);
+    if (!ok) {
+        Kernel::panic("MMU: Failed to apply kernel W^X layout.");
+    }
+    Kernel::kprintf("MMU: Kernel text 0x%llx-0x%llx RX, rodata -0x%llx RO, data/bss RW.\n",
+                    text_start, rodata_start, data_start);
+
+    // Unmapped page right below the boot stack: an overflow faults instead of corrupting memory
+    kstd::uintptr_t stack_bottom = reinterpret_cast<kstd::uintptr_t>(BOOT_STACK_TOP) -
+                                   reinterpret_cast<kstd::uintptr_t>(BOOT_STACK_SIZE);
+    if (set_guard_page(stack_bottom - PAGE_SIZE_4KB)) {
+        Kernel::kprintf("MMU: Boot stack 0x%llx-0x%llx, guard page at 0x%llx.\n",
+                        stack_bottom, reinterpret_cast<kstd::uintptr_t>(BOOT_STACK_TOP), stack_bottom - PAGE_SIZE_4KB);
+    }
+}
+
+
+// --- Mapping API ---
+
+// True if the MMU is on and translates through root right now. The identity map is built
+// while the early boot map is live, so the MMU being on alone says nothing about l1_page_table.
+bool MMU::table_live(const kstd::uint64_t* root) {
+    kstd::uint64_t sctlr, ttbr;
+    asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    if (!(sctlr & 1)) return false;
+    if (root == l1_page_table) {
+        asm volatile("mrs %0, ttbr0_el1" : "=r"(ttbr));
+    } else {
+        asm volatile("mrs %0, ttbr1_el1" : "=r"(ttbr));
+    }
+    return (ttbr & PTE_ADDR_MASK) == reinterpret_cast<kstd::uintptr_t>(root);
+}
+
+void MMU::flush_tlb_page(kstd::uintptr_t va) {
+    asm volatile("dsb ishst" ::: "memory");
+    asm volatile("tlbi vaae1is, %0" : : "r"((va >> 12) & 0xFFFFFFFFFFFULL) : "memory"); // VA[55:12]
+    asm volatile("dsb ish" ::: "memory");
+    asm volatile("isb" ::: "memory");
+}
+
+void MMU::flush_tlb_all() {
+    asm volatile("dsb ishst" ::: "memory");
+    asm volatile("tlbi vmalle1is" ::: "memory");
+    asm volatile("dsb ish" ::: "memory");
+    asm volatile("isb" ::: "memory");
+}
+
+kstd::uint64_t MMU::attributes_for(kstd::uint32_t flags) {
+    kstd::uint64_t attrs = PTE_VALID | PTE_AF | PTE_SH_INNER_SHAREABLE | PTE_UXN;
+    if (flags & MAP_DEVICE) {
+        attrs |= PTE_ATTR_INDX(MAIR_IDX_DEVICE_NGNRNE);
+    } else if (flags & MAP_NOCACHE) {
+        attrs |= PTE_ATTR_INDX(MAIR_IDX_NORMAL_NC);
+    } else {
+        attrs |= PTE_ATTR_INDX(MAIR_IDX_NORMAL_C);
+    }
+    attrs |= (flags & MAP_WRITE) ? PTE_AP_EL1_RW_EL0_NONE : PTE_AP_EL1_RO_EL0_NONE;
+    if (!(flags & MAP_EXEC)) {
+        attrs |= PTE_PXN;
     }
-    Kernel::kprintf("MMU: L2_TABLE_0 (0GB-1GB) populated.\n");
-
-    // L2_TABLE_1: Identity map for VA 0x40000000 - 0x7FFFFFFF (second 1GB)
-    for (unsigned int i = 0; i < PAGE_TABLE_ENTRIES; ++i) {
-        kstd::uintptr_t va_base_for_this_table = PAGE_SIZE_1GB; // Start of 2nd GB
-        kstd::uintptr_t current_pa = va_base_for_this_table + (static_cast<kstd::uintptr_t>(i) * PAGE_SIZE_2MB);
-        kstd::uint64_t flags = PTE_VALID | PTE_AF | PTE_SH_INNER_SHAREABLE;
-
-        if (current_pa >= RPI4_PERIPHERAL_BASE_PHYS && (current_pa + PAGE_SIZE_2MB -1) <= RPI4_PERIPHERAL_END_PHYS) {
-            flags |= PTE_ATTR_INDX(MAIR_IDX_DEVICE_NGNRNE);
-            flags |= PTE_AP_EL1_RW_EL0_NONE;
-            flags |= PTE_PXN | PTE_UXN;
-        } else {
-            // General RAM in the second GB
-            flags |= PTE_ATTR_INDX(MAIR_IDX_NORMAL_C);
-            flags |= PTE_AP_EL1_RW_EL0_NONE;
-            flags |= PTE_PXN | PTE_UXN;
+    return attrs;
+}
+
+kstd::uint64_t* MMU::root_table_for(kstd::uintptr_t va, kstd::uintptr_t end) {
+    if (end <= IDENTITY_VA_LIMIT) return l1_page_table;
+    if (va >= KERNEL_VA_BASE) return l1_kernel_table;
+    return nullptr; // Outside both halves, or straddling the hole between them
+}
+
+kstd::uint64_t* MMU::allocate_table() {
+    if (tables_used >= MMU_TABLE_POOL_SIZE) {
+        kstd::uint64_t* table = table_allocator ? static_cast<kstd::uint64_t*>(table_allocator()) : nullptr;
+        if (!table) {
+            Kernel::kprintf("MMU: Out of page tables (pool of %u used).\n", static_cast<unsigned int>(MMU_TABLE_POOL_SIZE));
         }
-        l2_page_table_1[i] = current_pa | flags;
+        return table;
     }
-    Kernel::kprintf("MMU: L2_TABLE_1 (1GB-2GB) populated.\n");
-
-    // Special handling for specific peripheral base addresses if they fall on 2MB boundaries
-    // and need different attributes than the general sweep.
-    // Example: Ensure GICD_BASE and GPIO_BASE are device memory.
-    // The current loop should handle them if RPI4_PERIPHERAL_BASE_PHYS is set correctly.
-    // For instance, GICD_BASE (0xFF841000) is within 0xFE000000 - 0xFFFFFFFF.
-    // The 2MB block containing 0xFF800000 to 0xFF9FFFFF would be marked as device.
+    kstd::uint64_t* table = table_pool[tables_used++];
+    Cache::zero_range(table, PAGE_TABLE_ENTRIES * sizeof(kstd::uint64_t));
+    return table;
 }
 
+// True if [va, va + size) holds the kernel image or the stack in use. Break-before-make over
+// such a range would unmap the code doing it, or the stack under it.
+bool MMU::holds_running_code(kstd::uintptr_t va, kstd::size_t size) {
+    kstd::uintptr_t sp;
+    asm volatile("mov %0, sp" : "=r"(sp));
+    kstd::uintptr_t end = va + size;
+    return (va < reinterpret_cast<kstd::uintptr_t>(KERNEL_END) && end > reinterpret_cast<kstd::uintptr_t>(KERNEL_START)) ||
+           (sp - PAGE_SIZE_4KB < end && sp + PAGE_SIZE_4KB > va);
+}
 
-void MMU::configure_translation_control() {
-    Kernel::kprintf("MMU: Configuring TCR_EL1 and MAIR_EL1...\n");
+// Replace a block at va with a next-level table that translates exactly the same way.
+// The block size changes, so a live entry goes through break-before-make: the whole block is
+// unmapped for a moment, which is refused when it holds the running code or stack.
+kstd::uint64_t* MMU::split_block(kstd::uint64_t* entry, kstd::size_t entry_size, kstd::uintptr_t va, bool live) {
+    if (live && holds_running_code(va, entry_size)) {
+        Kernel::kprintf("MMU: Not splitting the live block at 0x%llx: it holds the running code or stack.\n", va);
+        return nullptr;
+    }
+    kstd::uint64_t* table = allocate_table();
+    if (!table) return nullptr;
+
+    kstd::size_t child_size = entry_size / PAGE_TABLE_ENTRIES;
+    kstd::uint64_t block = *entry & ~PTE_CONTIGUOUS;
+    kstd::uint64_t attrs = block & ~PTE_ADDR_MASK;
+    kstd::uint64_t base = block & PTE_ADDR_MASK;
+    if (child_size == PAGE_SIZE_4KB) {
+        attrs |= PTE_TABLE_OR_PAGE; // L3 page descriptor
+    }
+    attrs |= PTE_CONTIGUOUS; // The block is aligned, so every run of 16 children qualifies
+    for (kstd::size_t i = 0; i < PAGE_TABLE_ENTRIES; ++i) {
+        table[i] = (base + i * child_size) | attrs;
+    }
+    asm volatile("dsb ishst" ::: "memory");
+    if (live) {
+        *entry = 0;
+        flush_tlb_all();
+    }
+    *entry = reinterpret_cast<kstd::uintptr_t>(table) | PTE_VALID | PTE_TABLE_OR_PAGE;
+    asm volatile("dsb ishst" ::: "memory");
+    return table;
+}
+
+// Write a leaf descriptor. A live entry whose address or attributes (beyond permissions) change
+// goes through break-before-make so the TLB never holds two conflicting translations.
+// Returns true if the old entry was valid, i.e. the TLB may still hold it.
+bool MMU::write_entry(kstd::uint64_t* entry, kstd::uint64_t value, kstd::uintptr_t va, bool live) {
+    kstd::uint64_t old = *entry;
+    if (live && (old & PTE_VALID) && ((old ^ value) & ~PTE_PERMISSION_MASK)) {
+        *entry = 0;
+        flush_tlb_page(va);
+    }
+    *entry = value;
+    asm volatile("dsb ishst" ::: "memory");
+    return (old & PTE_VALID) != 0;
+}
+
+// Changing the hint on a live run needs break-before-make over the whole run (64KB of pages,
+// 32MB of blocks), so it is refused when the run holds the running code or stack.
+// va is the address the run starts at.
+bool MMU::rewrite_contiguous_group(kstd::uint64_t* table, kstd::size_t first, bool contiguous,
+                                   kstd::uintptr_t va, kstd::size_t entry_size, bool live) {
+    if (live) {
+        if (holds_running_code(va, PTE_CONTIGUOUS_ENTRIES * entry_size)) return false;
+        for (kstd::size_t i = 0; i < PTE_CONTIGUOUS_ENTRIES; ++i) {
+            table[first + i] = 0;
+        }
+        flush_tlb_all();
+    }
+    kstd::uint64_t* group = &table[first];
+    for (kstd::size_t i = 0; i < PTE_CONTIGUOUS_ENTRIES; ++i) {
+        group[i] = contiguous ? (group[i] | PTE_CONTIGUOUS) : (group[i] & ~PTE_CONTIGUOUS);
+    }
+    asm volatile("dsb ishst" ::: "memory");
+    return true;
+}
+
+// Set or clear the contiguous hint on the aligned run of 16 entries containing index:
+// all must be leaves with the same attributes mapping one naturally aligned physical run.
+// The hint is only an optimization: a live run that cannot be rewritten is left without it.
+void MMU::refresh_contiguous(kstd::uint64_t* table, kstd::size_t index, kstd::size_t entry_size,
+                             kstd::uintptr_t va, bool live) {
+    kstd::size_t first = index & ~(PTE_CONTIGUOUS_ENTRIES - 1);
+    kstd::uint64_t head = table[first] & ~PTE_CONTIGUOUS;
+    kstd::uint64_t leaf_type = (entry_size == PAGE_SIZE_4KB) ? (PTE_VALID | PTE_TABLE_OR_PAGE) : PTE_VALID;
+
+    bool qualifies = (head & (PTE_VALID | PTE_TABLE_OR_PAGE)) == leaf_type &&
+                     ((head & PTE_ADDR_MASK) % (PTE_CONTIGUOUS_ENTRIES * entry_size)) == 0;
+    for (kstd::size_t i = 1; qualifies && i < PTE_CONTIGUOUS_ENTRIES; ++i) {
+        qualifies = (table[first + i] & ~PTE_CONTIGUOUS) == head + i * entry_size;
+    }
+
+    bool current = true;
+    for (kstd::size_t i = 0; i < PTE_CONTIGUOUS_ENTRIES; ++i) {
+        current = current && (table[first + i] & PTE_CONTIGUOUS);
+    }
+    if (qualifies != current) {
+        kstd::uintptr_t group_va = va & ~(PTE_CONTIGUOUS_ENTRIES * entry_size - 1);
+        rewrite_contiguous_group(table, first, qualifies, group_va, entry_size, live);
+    }
+}
+
+bool MMU::update_range(Op op, kstd::uintptr_t va, kstd::uintptr_t pa, kstd::size_t size, kstd::uint32_t flags) {
+    kstd::uint64_t* root = root_table_for(va, va + size);
+    if (size == 0 || ((va | pa | size) & (PAGE_SIZE_4KB - 1)) || va + size < va || !root) {
+        return false;
+    }
+    if (op != Op::UNMAP) {
+        // W^X, and nothing executes from device memory
+        if ((flags & MAP_EXEC) && (flags & (MAP_WRITE | MAP_DEVICE))) return false;
+    }
+    kstd::uint64_t attrs = attributes_for(flags);
+    kstd::uintptr_t end = va + size;
+    bool flush = false; // Invalid -> valid needs no TLB maintenance (faulting entries are never cached)
+    bool live = table_live(root);
+
+    while (va < end) {
+        kstd::uint64_t* table = root;
+        kstd::size_t entry_size = PAGE_SIZE_1GB;
+        for (;;) {
+            kstd::size_t index = (va / entry_size) % PAGE_TABLE_ENTRIES;
+            kstd::uint64_t* entry = &table[index];
+            kstd::uint64_t old = *entry;
+            kstd::uintptr_t group_va = va & ~(PTE_CONTIGUOUS_ENTRIES * entry_size - 1);
+            bool is_table = entry_size != PAGE_SIZE_4KB && (old & (PTE_VALID | PTE_TABLE_OR_PAGE)) == (PTE_VALID | PTE_TABLE_OR_PAGE);
+            bool covers = (va % entry_size) == 0 && (end - va) >= entry_size &&
+                          (op != Op::MAP || (pa % entry_size) == 0);
+
+            if (covers && !is_table) {
+                kstd::uint64_t value = 0;
+                if (op == Op::MAP) {
+                    value = pa | attrs;
+                } else if (op == Op::PROTECT) {
+                    if (!(old & PTE_VALID)) return false;
+                    value = (old & PTE_ADDR_MASK) | attrs;
+                }
+                if (value && entry_size == PAGE_SIZE_4KB) {
+                    value |= PTE_TABLE_OR_PAGE;
+                }
+                if ((old & PTE_CONTIGUOUS) &&
+                    !rewrite_contiguous_group(table, index & ~(PTE_CONTIGUOUS_ENTRIES - 1), false, group_va, entry_size, live)) {
+                    return false;
+                }
+                flush |= write_entry(entry, value, va, live);
+                refresh_contiguous(table, index, entry_size, va, live);
+                va += entry_size;
+                pa += entry_size;
+                break;
+            }
+
+            if (!is_table) {
+                if (old & PTE_VALID) {
+                    if ((old & PTE_CONTIGUOUS) &&
+                        !rewrite_contiguous_group(table, index & ~(PTE_CONTIGUOUS_ENTRIES - 1), false, group_va, entry_size, live)) {
+                        return false;
+                    }
+                    if (!split_block(entry, entry_size, va & ~(entry_size - 1), live)) return false;
+                    flush = true;
+                } else if (op == Op::UNMAP) {
+                    // Nothing mapped here; skip to the end of this entry
+                    kstd::uintptr_t next = (va / entry_size + 1) * entry_size;
+                    va = next < end ? next : end;
+                    break;
+                } else if (op == Op::PROTECT) {
+                    return false;
+                } else {
+                    kstd::uint64_t* next_table = allocate_table();
+                    if (!next_table) return false;
+                    asm volatile("dsb ishst" ::: "memory");
+                    *entry = reinterpret_cast<kstd::uintptr_t>(next_table) | PTE_VALID | PTE_TABLE_OR_PAGE;
+                }
+            }
+            table = reinterpret_cast<kstd::uint64_t*>(*entry & PTE_ADDR_MASK);
+            entry_size /= PAGE_TABLE_ENTRIES;
+        }
+    }
+
+    if (flush && live) {
+        flush_tlb_all();
+    }
+    return true;
+}
+
+bool MMU::map_range(kstd::uintptr_t va, kstd::uintptr_t pa, kstd::size_t size, kstd::uint32_t flags) {
+    return update_range(Op::MAP, va, pa, size, flags);
+}
+
+bool MMU::unmap_range(kstd::uintptr_t va, kstd::size_t size) {
+    return update_range(Op::UNMAP, va, 0, size, 0);
+}
+
+bool MMU::protect_range(kstd::uintptr_t va, kstd::size_t size, kstd::uint32_t flags) {
+    return update_range(Op::PROTECT, va, 0, size, flags);
+}
+
+bool MMU::set_guard_page(kstd::uintptr_t va) {
+    va &= ~(PAGE_SIZE_4KB - 1);
+    if (guard_page_count >= MAX_GUARD_PAGES || !unmap_range(va, PAGE_SIZE_4KB)) {
+        return false;
+    }
+    guard_pages[guard_page_count++] = va;
+    return true;
+}
 
+bool MMU::is_guard_page(kstd::uintptr_t va) {
+    va &= ~(PAGE_SIZE_4KB - 1);
+    for (kstd::size_t i = 0; i < guard_page_count; ++i) {
+        if (guard_pages[i] == va) return true;
+    }
+    return false;
+}
+
+kstd::uint64_t MMU::lookup(kstd::uintptr_t va, kstd::size_t* level_size) {
+    const kstd::uint64_t* table = root_table_for(va, va + 1);
+    if (!table) return 0;
+    kstd::size_t entry_size = PAGE_SIZE_1GB;
+    for (;;) {
+        kstd::uint64_t entry = table[(va / entry_size) % PAGE_TABLE_ENTRIES];
+        if (!(entry & PTE_VALID)) return 0;
+        if (entry_size == PAGE_SIZE_4KB || !(entry & PTE_TABLE_OR_PAGE)) {
+            if (level_size) *level_size = entry_size;
+            return entry;
+        }
+        table = reinterpret_cast<const kstd::uint64_t*>(entry & PTE_ADDR_MASK);
+        entry_size /= PAGE_TABLE_ENTRIES;
+    }
+}
+
+
+// MAIR_EL1 and TCR_EL1 values, shared by the early boot map and the full one
+static kstd::uint64_t mair_value() {
     // --- Configure MAIR_EL1 (Memory Attribute Indirection Register) ---
     // Attr0: Device-nGnRnE (MAIR_IDX_DEVICE_NGNRNE = 0)
     // Attr1: Normal, Non-Cacheable (MAIR_IDX_NORMAL_NC = 1)
@@ -124,12 +414,13 @@ void MMU::configure_translation_control() {
     mair_val |= (static_cast<kstd::uint64_t>(MAIR_ATTR_DEVICE_NGNRNE) << (MAIR_IDX_DEVICE_NGNRNE * 8));
     mair_val |= (static_cast<kstd::uint64_t>(MAIR_ATTR_NORMAL_NC)     << (MAIR_IDX_NORMAL_NC * 8));
     mair_val |= (static_cast<kstd::uint64_t>(MAIR_ATTR_NORMAL_C)      << (MAIR_IDX_NORMAL_C * 8));
-    asm volatile("msr mair_el1, %0" : : "r"(mair_val));
-    Kernel::kprintf("MMU: MAIR_EL1 set to 0x%llx\n", mair_val);
+    return mair_val;
+}
 
+static kstd::uint64_t tcr_value() {
     // --- Configure TCR_EL1 (Translation Control Register) ---
-    // Using TTBR0_EL1 for the first 2GB (identity map).
-    // Assuming 4KB granule (TG0=00), 48-bit VA (T0SZ=16).
+    // Using TTBR0_EL1 for the identity map (RAM and peripherals, below 512GB).
+    // Assuming 4KB granule (TG0=00), 39-bit VA (T0SZ=25).
     // Physical Address Size (IPS). RPi4 supports up to 40-bit physical addresses for RAM.
     // For peripherals like GIC, addresses are higher (e.g., 0xFF841000).
     // Let's assume 40-bit PA space (IPS=010) to be safe for peripherals up to 1TB.
@@ -138,8 +429,9 @@ void MMU::configure_translation_control() {
     // Shareability (SH0) and Cacheability (IRGN0, ORGN0) for page table walks:
     // Typically Inner Shareable, Write-Back Read-Allocate Write-Allocate Cacheable.
     kstd::uint64_t tcr_val = 0;
-    // T0SZ (bits 5:0): Region size for TTBR0_EL1 is 2^(64-T0SZ). T0SZ = 16 for 48-bit VA space.
-    tcr_val |= (16ULL << 0);  // T0SZ = 16
+    // T0SZ (bits 5:0): Region size for TTBR0_EL1 is 2^(64-T0SZ). T0SZ = 25 for a 39-bit VA space,
+    // which makes the walk start at L1 (our top-level table).
+    tcr_val |= (25ULL << 0);  // T0SZ = 25
     // TG0 (bits 15:14): Granule size for TTBR0. 00 = 4KB.
     tcr_val |= (0b00ULL << 14); // TG0 = 4KB granule
     // SH0 (bits 13:12): Shareability for TTBR0 walks. 0b11 = Inner Shareable.
@@ -149,21 +441,65 @@ void MMU::configure_translation_control() {
     // IRGN0 (bits 9:8): Inner cacheability for TTBR0 walks. 0b01 = Normal WB Read-Alloc Write-Alloc.
     tcr_val |= (0b01ULL << 8);  // IRGN0 = Normal WB RAWA Cacheable
     // EPD0 (bit 7): Disable page table walk for TTBR0 if set. Must be 0 to enable.
-    // EPD1 (bit 23): Disable page table walk for TTBR1 if set. Set to 1 if TTBR1 not used.
-    tcr_val |= (1ULL << 23); // Disable TTBR1 walks for now.
+    // EPD1 (bit 23): Disable page table walk for TTBR1 if set. Left 0: TTBR1 holds kernel virtual memory.
+    // T1SZ (bits 21:16), TG1 (bits 31:30, 0b10 = 4KB!), SH1/ORGN1/IRGN1 as for TTBR0.
+    tcr_val |= (25ULL << 16);   // T1SZ = 25 (512GB from KERNEL_VA_BASE)
+    tcr_val |= (0b10ULL << 30); // TG1 = 4KB granule
+    tcr_val |= (0b11ULL << 28); // SH1 = Inner Shareable
+    tcr_val |= (0b01ULL << 26); // ORGN1 = Normal WB RAWA Cacheable
+    tcr_val |= (0b01ULL << 24); // IRGN1 = Normal WB RAWA Cacheable
     // IPS (bits 34:32): Intermediate Physical Address Size. 010 = 40 bits.
     tcr_val |= (0b010ULL << 32); // IPS = 40-bit PA
 
     // TBI0 (bit 37): Top Byte Ignore for TTBR0_EL1. Set to 0 if using full VA range.
     // TBI1 (bit 38): Top Byte Ignore for TTBR1_EL1.
+    return tcr_val;
+}
 
-    asm volatile("msr tcr_el1, %0" : : "r"(tcr_val));
-    Kernel::kprintf("MMU: TCR_EL1 set to 0x%llx\n", tcr_val);
-
-    // --- Set TTBR0_EL1 (Translation Table Base Register 0) ---
+void MMU::configure_translation_control() {
+    Kernel::kprintf("MMU: Configuring TCR_EL1 and MAIR_EL1...\n");
+    kstd::uint64_t mair_val = mair_value();
     kstd::uintptr_t l1_pt_phys = get_physical_address(l1_page_table);
-    asm volatile("msr ttbr0_el1, %0" : : "r"(l1_pt_phys));
+    kstd::uintptr_t l1_kernel_phys = get_physical_address(l1_kernel_table); // Empty until vmalloc maps something
+    kstd::uint64_t tcr_val = tcr_value();
+
+    kstd::uint64_t sctlr;
+    asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    if (sctlr & 1) {
+        // The early boot map is live. It maps the code and stack here with 1GB blocks where the
+        // new map has 2MB blocks and pages, so switching under a running MMU could leave both in
+        // the TLB. Turn the MMU off for the switch instead: this code runs on the identity map,
+        // so it carries on at the same address, and nothing between the SCTLR_EL1 writes
+        // touches memory.
+        kstd::uint64_t daif = Kernel::irq_save();
+        asm volatile(
+            "dsb ish\n\t"
+            "msr sctlr_el1, %[off]\n\t"
+            "isb\n\t"
+            "msr mair_el1, %[mair]\n\t"
+            "msr ttbr0_el1, %[ttbr0]\n\t"
+            "msr ttbr1_el1, %[ttbr1]\n\t"
+            "msr tcr_el1, %[tcr]\n\t"
+            "isb\n\t"
+            "tlbi vmalle1\n\t"
+            "dsb nsh\n\t"
+            "msr sctlr_el1, %[on]\n\t"
+            "isb"
+            : : [off] "r"(sctlr & ~1ULL), [on] "r"(sctlr), [mair] "r"(mair_val), [ttbr0] "r"(l1_pt_phys),
+                [ttbr1] "r"(l1_kernel_phys), [tcr] "r"(tcr_val)
+            : "memory");
+        Kernel::irq_restore(daif);
+    } else {
+        asm volatile("msr mair_el1, %0" : : "r"(mair_val));
+        asm volatile("msr ttbr0_el1, %0" : : "r"(l1_pt_phys));
+        asm volatile("msr ttbr1_el1, %0" : : "r"(l1_kernel_phys));
+        asm volatile("msr tcr_el1, %0" : : "r"(tcr_val));
+        asm volatile("isb" ::: "memory");
+    }
+    Kernel::kprintf("MMU: MAIR_EL1 set to 0x%llx\n", mair_val);
     Kernel::kprintf("MMU: TTBR0_EL1 set to 0x%llx (L1 Table Physical Address)\n", l1_pt_phys);
+    Kernel::kprintf("MMU: TTBR1_EL1 set to 0x%llx (kernel VA 0x%llx+)\n", l1_kernel_phys, KERNEL_VA_BASE);
+    Kernel::kprintf("MMU: TCR_EL1 set to 0x%llx\n", tcr_val);
 }
 
 void MMU::enable_mmu_and_caches() {
@@ -184,6 +520,13 @@ void MMU::enable_mmu_and_caches() {
     kstd::uint64_t sctlr_val;
     asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr_val));
 
+    // The caches may hold stale lines from before reset or from the firmware. With the D-cache
+    // still off nothing in it is ours, so drop everything before it starts serving our data.
+    if (!(sctlr_val & (1ULL << 2))) {
+        Cache::invalidate_dcache_all();
+    }
+    Cache::invalidate_icache_all();
+
     // Bits to set:
     // M (bit 0): MMU enable for EL1 and EL0 stage 1 address translation.
     // C (bit 2): Data Cache enable.
@@ -200,6 +543,7 @@ void MMU::enable_mmu_and_caches() {
     sctlr_val |= (1ULL << 0);  // M - Enable MMU
     sctlr_val |= (1ULL << 2);  // C - Enable Data Cache
     sctlr_val |= (1ULL << 12); // I - Enable Instruction Cache
+    sctlr_val |= (1ULL << 19); // WXN - Writable memory is never executable, whatever the tables say
     // sctlr_val |= (1ULL << 3);  // SA - Stack Alignment Check EL1
     // sctlr_val |= (1ULL << 4);  // SA0 - Stack Alignment Check EL0
     // sctlr_val &= ~(1ULL << 1); // A - Alignment Check Disable (ensure it's 0 to enable checks)
@@ -209,6 +553,8 @@ void MMU::enable_mmu_and_caches() {
 
     asm volatile("msr sctlr_el1, %0" : : "r"(sctlr_val));
     asm volatile("isb"); // Synchronize context on this PE
+    // WXN may be cached in TLB entries; drop any made under the early boot map
+    asm volatile("tlbi vmalle1; dsb nsh; isb" ::: "memory");
 
     Kernel::kprintf("MMU: MMU and Caches Enabled (SCTLR_EL1 written).\n");
     kstd::uint64_t final_sctlr;
@@ -221,18 +567,50 @@ void MMU::enable_mmu_and_caches() {
 }
 
 
-void MMU::init_and_enable() {
+void MMU::early_enable() {
+    kstd::uint64_t current_el, sctlr;
+    asm volatile("mrs %0, CurrentEL" : "=r"(current_el));
+    asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    if (((current_el >> 2) & 3) != 1 || (sctlr & 1)) return;
+
+    // MMU off: data accesses are Device, so zero_range uses plain stores
+    Cache::zero_range(early_l1_table, sizeof(early_l1_table));
+    kstd::uint64_t ram = PTE_VALID | PTE_AF | PTE_SH_INNER_SHAREABLE | PTE_AP_EL1_RW_EL0_NONE |
+                         PTE_ATTR_INDX(MAIR_IDX_NORMAL_C);
+    kstd::uint64_t device = PTE_VALID | PTE_AF | PTE_SH_INNER_SHAREABLE | PTE_AP_EL1_RW_EL0_NONE |
+                            PTE_ATTR_INDX(MAIR_IDX_DEVICE_NGNRNE) | PTE_PXN | PTE_UXN;
+    early_l1_table[0] = ram;                          // 0-1GB: kernel, stack, heap, DTB
+    early_l1_table[3] = (3 * PAGE_SIZE_1GB) | device; // 3-4GB: peripherals, GIC
+
+    asm volatile("msr mair_el1, %0" : : "r"(mair_value()));
+    // TTBR1 is not set up yet: keep its walks disabled (EPD1)
+    asm volatile("msr tcr_el1, %0" : : "r"(tcr_value() | (1ULL << 23)));
+    asm volatile("msr ttbr0_el1, %0" : : "r"(reinterpret_cast<kstd::uintptr_t>(early_l1_table)));
+    asm volatile("dsb sy; isb" ::: "memory");
+    asm volatile("tlbi vmalle1; dsb nsh; isb" ::: "memory");
+
+    // Nothing in the D-cache is ours yet (see enable_mmu_and_caches)
+    Cache::invalidate_dcache_all();
+    Cache::invalidate_icache_all();
+    sctlr |= (1ULL << 0) | (1ULL << 2) | (1ULL << 12); // M, C, I
+    asm volatile("msr sctlr_el1, %0" : : "r"(sctlr));
+    asm volatile("isb" ::: "memory");
+}
+
+extern "C" void mmu_early_enable() {
+    MMU::early_enable();
+}
+
+void MMU::init_and_enable(kstd::uintptr_t dtb_address) {
     // Check if MMU is already enabled. If so, perhaps skip or panic.
     kstd::uint64_t sctlr_val;
     asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr_val));
     if (sctlr_val & 1) {
-        Kernel::kprintf("MMU: Warning - MMU already enabled (SCTLR_EL1.M = 1).\n");
-        // For now, we'll proceed, assuming it might be okay or for re-configuration.
-        // A robust system might panic or handle this state carefully.
-        // return; // Or proceed to reconfigure if that's the intent.
+        // Normally the early boot map from start.S; configure_translation_control switches away from it
+        Kernel::kprintf("MMU: Replacing the early boot map (MMU already enabled).\n");
     }
 
-    setup_page_tables();
+    setup_page_tables(dtb_address);
     configure_translation_control();
     enable_mmu_and_caches();
 
@@ -258,8 +636,7 @@ void MMU::init_and_enable() {
 //    VBAR_EL1 should point to the *virtual* address of the vectors if MMU is on.
 //    If identity mapping, virtual == physical.
 //    Let's ensure exceptions.S .vectors section is mapped as Normal_C, R-X for kernel.
-//    The current page table setup maps KERNEL_START to KERNEL_END as Normal_C, R/W (kernel), X (kernel).
-//    This should cover the .vectors section if it's linked within kernel image.
+//    apply_kernel_layout() maps .vectors and .text as Normal_C, read-only, executable (kernel).
 // 5. GIC init
 // 6. Timer init
 // The `init_exceptions()` which sets VBAR_EL1 should ideally be called *after* MMU is enabled if the
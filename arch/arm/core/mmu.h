@@ -3,6 +3,7 @@
 
 #include <kstd/cstdint.h>
 #include <kstd/cstddef.h> // For kstd::size_t
+#include <lib/fdt/fdt.h>   // For Kernel::FDT::MemoryRegion
 
 namespace Arch {
 namespace Arm {
@@ -59,6 +60,16 @@ constexpr kstd::uint64_t PTE_AF = (1ULL << 10); // Must be set to 1 by software
 // Upper attributes for Page/Block entries
 constexpr kstd::uint64_t PTE_PXN = (1ULL << 53); // Privileged Execute Never (EL1 execute never)
 constexpr kstd::uint64_t PTE_UXN = (1ULL << 54); // Unprivileged Execute Never (EL0 execute never)
+constexpr kstd::uint64_t PTE_CONTIGUOUS = (1ULL << 52); // Hint: entry is one of an aligned run sharing a single TLB entry
+
+// Output address (bits 47:12) of a table, block or page descriptor
+constexpr kstd::uint64_t PTE_ADDR_MASK = 0x0000FFFFFFFFF000ULL;
+// Permission bits that may change on a live entry without break-before-make
+constexpr kstd::uint64_t PTE_PERMISSION_MASK = (0b11ULL << 6) | PTE_PXN | PTE_UXN;
+
+// With a 4KB granule, the contiguous hint covers 16 aligned entries at both L2 and L3:
+// 16 x 4KB = 64KB runs of pages, 16 x 2MB = 32MB runs of blocks.
+constexpr kstd::size_t PTE_CONTIGUOUS_ENTRIES = 16;
 
 // --- Specific to Table descriptors ---
 // (PTE_TABLE_OR_PAGE is 1)
@@ -99,6 +110,20 @@ constexpr kstd::size_t PAGE_SIZE_4KB    = 4096;
 constexpr kstd::size_t PAGE_SIZE_2MB    = 2 * 1024 * 1024;
 constexpr kstd::size_t PAGE_SIZE_1GB    = 1 * 1024 * 1024 * 1024;
 
+// Tables handed out by the mapping API when a block is split or a new region is mapped
+constexpr kstd::size_t MMU_TABLE_POOL_SIZE = 32;
+
+// Flags for MMU::map_range / MMU::protect_range. Mappings are always EL1-only.
+constexpr kstd::uint32_t MAP_READ    = (1 << 0);
+constexpr kstd::uint32_t MAP_WRITE   = (1 << 1);
+constexpr kstd::uint32_t MAP_EXEC    = (1 << 2); // Rejected together with MAP_WRITE (W^X)
+constexpr kstd::uint32_t MAP_DEVICE  = (1 << 3); // Device-nGnRnE instead of Normal cacheable
+constexpr kstd::uint32_t MAP_NOCACHE = (1 << 4); // Normal non-cacheable
+constexpr kstd::uint32_t MAP_KERNEL_RW   = MAP_READ | MAP_WRITE;
+constexpr kstd::uint32_t MAP_KERNEL_RO   = MAP_READ;
+constexpr kstd::uint32_t MAP_KERNEL_RX   = MAP_READ | MAP_EXEC;
+constexpr kstd::uint32_t MAP_DEVICE_RW   = MAP_READ | MAP_WRITE | MAP_DEVICE;
+
 // TCR_EL1 (Translation Control Register) bits
 // TG0: Granule size for TTBR0_EL1. 00=4KB, 01=16KB, 10=64KB. We use 4KB.
 // SH0: Shareability for TTBR0_EL1 page table walks. 00=Non-shareable, 10=Outer, 11=Inner.
@@ -111,43 +136,128 @@ constexpr kstd::size_t PAGE_SIZE_1GB    = 1 * 1024 * 1024 * 1024;
 //      Let's assume 40-bit PA (IPS=010) for now.
 //      Or for simplicity, 32-bit PA (IPS=000) if only mapping first 4GB.
 //      Max physical address on RPi4 can be higher for peripherals.
-//      Let's target 48-bit VA and 40-bit PA (IPS=010).
-//      T0SZ = 16 (for 48-bit VA starting at 0)
+//      We target 39-bit VA and 40-bit PA (IPS=010).
+//      T0SZ = 25 (for 39-bit VA starting at 0)
 //      TTBR0_EL1 covers the lower VA range (typically user space or low kernel space).
 //      TTBR1_EL1 covers the upper VA range (typically kernel space).
 //      For a simple kernel identity mapping low addresses, we use TTBR0_EL1.
 
 // We'll use a 3-level page table structure for 2MB blocks with 4KB granule:
-// L1 table -> L2 table -> 2MB Block entry
-// (L0 is not used if T0SZ means 48-bit input address with 4KB granule)
+// L1 table -> L2 table -> 2MB Block entry (-> L3 table -> 4KB page where finer control is needed)
+// L0 is not used: T0SZ = 25 gives a 39-bit (512GB) input range, so walks start at L1.
+// With T0SZ = 16 (48-bit) the walk would start at L0 and our L1 table would be misread.
 // If L1 entry points to L2 table, L1 has 512 entries (1GB each)
 // L2 table has 512 entries (2MB each) = 1GB per L2 table.
-// So, for 2GB identity map, we need:
-// One L1 table. Two L1 entries used.
-// Two L2 tables. Each L2 table fully populated (512 entries).
+// The identity map is built from the RAM ranges in the device tree:
+// 1GB L1 blocks where a range covers a whole aligned gigabyte, L2 tables of 2MB blocks
+// for the rest, plus the peripheral window as device memory.
+
+// BCM2711 peripheral window ("low peripheral" mode): main peripherals at 0xFC000000-0xFF7FFFFF,
+// ARM local peripherals and the GIC-400 at 0xFF800000-0xFFFFFFFF.
+constexpr kstd::uintptr_t RPI4_PERIPHERAL_WINDOW_BASE = 0xFC000000;
+constexpr kstd::uintptr_t RPI4_PERIPHERAL_WINDOW_END  = 0x100000000;
+
+// Used when no device tree is passed: every Raspberry Pi 4 has at least this much RAM at 0.
+constexpr kstd::uint64_t RPI4_FALLBACK_RAM_SIZE = PAGE_SIZE_1GB;
+
+constexpr kstd::size_t MMU_MAX_RAM_REGIONS = 8;
+
+// TTBR1 (kernel virtual) half: T1SZ = 25 gives 512GB at the top of the address space.
+// Nothing is mapped there at boot; Kernel::vmalloc hands out ranges from it.
+constexpr kstd::uintptr_t KERNEL_VA_BASE = 0xFFFFFF8000000000ULL;
+// TTBR0 (identity) half ends here (T0SZ = 25)
+constexpr kstd::uintptr_t IDENTITY_VA_LIMIT = 1ULL << 39;
 
 class MMU {
 public:
     MMU() = default;
 
     // Initialize and enable the MMU.
-    // Creates identity mapping for the first 2GB of RAM.
-    // Kernel image should be within this 2GB range.
-    static void init_and_enable();
+    // Identity maps all RAM listed in the device tree at dtb_address (first 1GB if there is none)
+    // and the peripheral window.
+    static void init_and_enable(kstd::uintptr_t dtb_address = 0);
+
+    // Minimal identity map so the BSS clear and early init run with caches on. Called from
+    // start.S (via mmu_early_enable) before .bss is cleared, so it touches no .bss data and
+    // prints nothing. 1GB blocks: the first gigabyte as Normal cacheable, 3-4GB (the peripheral
+    // window) as device memory; the rest stays unmapped until init_and_enable replaces the map.
+    // Does nothing unless running at EL1 with the MMU off.
+    static void early_enable();
+
+    // RAM ranges the identity map was built from. Returns the number of entries in *regions.
+    static kstd::size_t get_ram_regions(const Kernel::FDT::MemoryRegion** regions);
+
+    // Mapping API for both halves: identity/remapping below IDENTITY_VA_LIMIT (TTBR0) and kernel
+    // virtual addresses from KERNEL_VA_BASE (TTBR1). Addresses and sizes must be 4KB aligned.
+    // 2MB blocks are used where both addresses are 2MB aligned, otherwise the covering block is
+    // split into an L3 table that keeps its old attributes outside the range.
+    // Runs that qualify get the contiguous hint. Safe to call with the MMU on: live entries are
+    // replaced break-before-make and the TLB is invalidated, so the range must not contain the
+    // code or stack doing the call unless only permissions change. Splitting a live block or
+    // clearing the hint on a live run unmaps more than the range for a moment; that is refused
+    // when it would take away the kernel image or the current stack (edit the identity map
+    // before it is live instead, as init_and_enable does).
+    // Returns false on bad arguments, when the table pool is exhausted or on such a refusal.
+    static bool map_range(kstd::uintptr_t va, kstd::uintptr_t pa, kstd::size_t size, kstd::uint32_t flags);
+    static bool unmap_range(kstd::uintptr_t va, kstd::size_t size);
+    // Change permissions/memory type of an already mapped range, keeping its output addresses.
+    static bool protect_range(kstd::uintptr_t va, kstd::size_t size, kstd::uint32_t flags);
+
+    // Unmap one page so any access faults. Used under stacks.
+    static bool set_guard_page(kstd::uintptr_t va);
+    // True if va lies in a page installed by set_guard_page (for fault reporting).
+    static bool is_guard_page(kstd::uintptr_t va);
+
+    // Walk the tables for va. Returns the leaf descriptor (0 if unmapped) and its size in *level_size.
+    static kstd::uint64_t lookup(kstd::uintptr_t va, kstd::size_t* level_size = nullptr);
+
+    // Where page tables come from once the static pool is used up (e.g. the page allocator).
+    // Must return a zeroed, 4KB-aligned, identity-mapped page, or nullptr.
+    using TableAllocator = void* (*)();
+    static void set_table_allocator(TableAllocator allocator) { table_allocator = allocator; }
 
 private:
     // Aligned page table storage. Needs to be in memory accessible before MMU is on.
     // These will be static members, allocated in .bss or .data.
     // Ensure they are page-aligned (4KB).
     static kstd::uint64_t l1_page_table[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
-    static kstd::uint64_t l2_page_table_0[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB))); // For VA 0x00000000 - 0x3FFFFFFF (1st GB)
-    static kstd::uint64_t l2_page_table_1[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB))); // For VA 0x40000000 - 0x7FFFFFFF (2nd GB)
-    // Add more L2 tables if mapping more than 2GB via L1.
+    static kstd::uint64_t l1_kernel_table[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB))); // TTBR1
+    // Built by early_enable; lives in .noinit because it is in use while .bss is being cleared
+    static kstd::uint64_t early_l1_table[PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
+
+    // Pool for the L2/L3 tables below it (partial gigabytes, block splits)
+    static kstd::uint64_t table_pool[MMU_TABLE_POOL_SIZE][PAGE_TABLE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
+    static kstd::size_t tables_used;
+    static TableAllocator table_allocator;
 
-    static void setup_page_tables();
+    static constexpr kstd::size_t MAX_GUARD_PAGES = 8;
+    static kstd::uintptr_t guard_pages[MAX_GUARD_PAGES];
+    static kstd::size_t guard_page_count;
+
+    static Kernel::FDT::MemoryRegion ram_regions[MMU_MAX_RAM_REGIONS];
+    static kstd::size_t ram_region_count;
+
+    static void setup_page_tables(kstd::uintptr_t dtb_address);
+    static void apply_kernel_layout(); // W^X for the kernel image, guard page under the boot stack
     static void configure_translation_control();
     static void enable_mmu_and_caches();
 
+    enum class Op { MAP, UNMAP, PROTECT };
+    static bool update_range(Op op, kstd::uintptr_t va, kstd::uintptr_t pa, kstd::size_t size, kstd::uint32_t flags);
+    static kstd::uint64_t attributes_for(kstd::uint32_t flags);
+    static kstd::uint64_t* root_table_for(kstd::uintptr_t va, kstd::uintptr_t end);
+    static kstd::uint64_t* allocate_table();
+    static bool holds_running_code(kstd::uintptr_t va, kstd::size_t size);
+    static kstd::uint64_t* split_block(kstd::uint64_t* entry, kstd::size_t entry_size, kstd::uintptr_t va, bool live);
+    static bool write_entry(kstd::uint64_t* entry, kstd::uint64_t value, kstd::uintptr_t va, bool live);
+    static void refresh_contiguous(kstd::uint64_t* table, kstd::size_t index, kstd::size_t entry_size,
+                                   kstd::uintptr_t va, bool live);
+    static bool rewrite_contiguous_group(kstd::uint64_t* table, kstd::size_t first, bool contiguous,
+                                         kstd::uintptr_t va, kstd::size_t entry_size, bool live);
+    static void flush_tlb_page(kstd::uintptr_t va);
+    static void flush_tlb_all();
+    static bool table_live(const kstd::uint64_t* root);
+
     // Helper to get physical address of static page table arrays
     template<typename T, kstd::size_t N>
     static kstd::uintptr_t get_physical_address(T (&array)[N]) {
@@ -161,4 +271,7 @@ private:
 } // namespace Arm
 } // namespace Arch
 
+// Entry point for start.S
+extern "C" void mmu_early_enable();
+
 #endif // ARCH_ARM_CORE_MMU_H
@@ -0,0 +1,235 @@
+#include "pmu.h"
+#include <kernel/interrupt.h>     // For get_interrupt_controller
+#include <kernel/irqflags.h>      // For irq_save/irq_restore
+#include <kernel/smp.h>           // For cpu_id, MAX_CPUS
+#include <kernel/irq/balance.h>   // For IrqBalance::pin (overflow IRQs stay on their core)
+#include <kernel/init/initcall.h> // For KERNEL_INITCALL
+
+namespace Arch {
+namespace Arm {
+
+// PMCR_EL0
+constexpr kstd::uint64_t PMCR_E  = 1u << 0; // Enable all counters
+constexpr kstd::uint64_t PMCR_P  = 1u << 1; // Reset the event counters
+constexpr kstd::uint64_t PMCR_C  = 1u << 2; // Reset the cycle counter
+constexpr kstd::uint64_t PMCR_LC = 1u << 6; // Cycle counter overflows at 64 bits, not 32
+constexpr unsigned int PMCR_N_SHIFT = 11;
+
+constexpr kstd::uint32_t PMU_CYCLE_COUNTER = 1u << 31; // Bit of PMCCNTR_EL0 in PMCNTEN/PMINTEN/PMOVS
+
+// Touched only by the owning core: from thread context with IRQs masked, and by its overflow IRQ
+struct PmuCpu {
+    unsigned int counters;
+    kstd::uint32_t allocated;
+    kstd::uint32_t sampling;                      // Allocated counters that call a handler
+    kstd::uint64_t high[Pmu::MAX_EVENT_COUNTERS]; // Overflows so far, in units of 2^32
+    kstd::uint32_t period[Pmu::MAX_EVENT_COUNTERS];
+    Pmu::OverflowHandler handler[Pmu::MAX_EVENT_COUNTERS];
+    void* context[Pmu::MAX_EVENT_COUNTERS];
+};
+
+static PmuCpu pmu_cpu[Kernel::MAX_CPUS];
+
+static inline void select_counter(unsigned int counter) {
+    asm volatile("msr pmselr_el0, %0; isb" : : "r"(static_cast<kstd::uint64_t>(counter)) : "memory");
+}
+
+static inline kstd::uint32_t read_selected_counter() {
+    kstd::uint64_t value;
+    asm volatile("mrs %0, pmxevcntr_el0" : "=r"(value) : : "memory");
+    return static_cast<kstd::uint32_t>(value);
+}
+
+static inline kstd::uint32_t overflow_status() {
+    kstd::uint64_t ovs;
+    asm volatile("isb; mrs %0, pmovsset_el0" : "=r"(ovs) : : "memory");
+    return static_cast<kstd::uint32_t>(ovs);
+}
+
+void Pmu::init_cpu() {
+    unsigned int cpu = Kernel::cpu_id();
+    kstd::uint64_t pmcr;
+    asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    unsigned int counters = (pmcr >> PMCR_N_SHIFT) & 0x1F;
+
+    asm volatile("msr pmuserenr_el0, xzr");      // No EL0 access
+    asm volatile("msr pmccfiltr_el0, xzr");      // Cycles at EL0 and EL1
+    asm volatile("msr pmcntenclr_el0, %0" : : "r"(0xFFFFFFFFull));
+    asm volatile("msr pmintenclr_el1, %0" : : "r"(0xFFFFFFFFull));
+    asm volatile("msr pmovsclr_el0, %0" : : "r"(0xFFFFFFFFull));
+    asm volatile("msr pmcr_el0, %0" : : "r"(PMCR_E | PMCR_P | PMCR_C | PMCR_LC));
+    asm volatile("msr pmcntenset_el0, %0; isb" : : "r"(static_cast<kstd::uint64_t>(PMU_CYCLE_COUNTER)) : "memory");
+
+    PmuCpu& state = pmu_cpu[cpu];
+    state.counters = counters;
+    state.allocated = 0;
+    state.sampling = 0;
+
+    // Overflow IRQ of this core only: a counter that wrapped on another core is not ours
+    Kernel::InterruptController* ic = Kernel::get_interrupt_controller();
+    unsigned int irq = IRQ_BASE + cpu;
+    if (ic && ic->register_handler(irq, overflow_irq, nullptr, Kernel::IRQ_PRIORITY_DEFAULT)) {
+        Kernel::IrqBalance::pin(irq, 1u << cpu);
+        ic->enable_irq(irq);
+    }
+}
+
+static void pmu_init_boot_cpu() {
+    Pmu::init_cpu();
+}
+// Needs the GIC for overflow interrupts
+KERNEL_INITCALL(INITCALL_LEVEL_DEVICE, "pmu", pmu_init_boot_cpu);
+
+unsigned int Pmu::num_counters() {
+    return pmu_cpu[Kernel::cpu_id()].counters;
+}
+
+bool Pmu::event_supported(PmuEvent event) {
+    unsigned int number = static_cast<unsigned int>(event);
+    kstd::uint64_t ceid;
+    if (number < 32) {
+        asm volatile("mrs %0, pmceid0_el0" : "=r"(ceid));
+    } else if (number < 64) {
+        asm volatile("mrs %0, pmceid1_el0" : "=r"(ceid));
+    } else {
+        return false;
+    }
+    return (ceid >> (number % 32)) & 1;
+}
+
+const char* Pmu::event_name(PmuEvent event) {
+    switch (event) {
+        case PmuEvent::L1I_CACHE_REFILL: return "l1i-refills";
+        case PmuEvent::L1D_CACHE_REFILL: return "l1d-refills";
+        case PmuEvent::L1D_CACHE:        return "l1d-accesses";
+        case PmuEvent::L1D_TLB_REFILL:   return "l1d-tlb-refills";
+        case PmuEvent::INST_RETIRED:     return "instructions";
+        case PmuEvent::EXC_TAKEN:        return "exceptions";
+        case PmuEvent::BR_MIS_PRED:      return "branch-misses";
+        case PmuEvent::CPU_CYCLES:       return "cycles";
+        case PmuEvent::BR_PRED:          return "branches";
+        case PmuEvent::MEM_ACCESS:       return "mem-accesses";
+        case PmuEvent::L2D_CACHE:        return "l2-accesses";
+        case PmuEvent::L2D_CACHE_REFILL: return "l2-refills";
+        case PmuEvent::BUS_ACCESS:       return "bus-accesses";
+        case PmuEvent::STALL_FRONTEND:   return "stalls-frontend";
+        case PmuEvent::STALL_BACKEND:    return "stalls-backend";
+    }
+    return "unknown";
+}
+
+int Pmu::allocate(PmuEvent event) {
+    kstd::uint64_t daif = Kernel::irq_save();
+    int counter = claim(event, 0, nullptr, nullptr);
+    Kernel::irq_restore(daif);
+    return counter;
+}
+
+int Pmu::allocate_sampling(PmuEvent event, kstd::uint32_t period, OverflowHandler handler, void* context) {
+    if (period == 0 || !handler) return -1;
+    kstd::uint64_t daif = Kernel::irq_save();
+    int counter = claim(event, period, handler, context);
+    Kernel::irq_restore(daif);
+    return counter;
+}
+
+// With IRQs masked: take the lowest free counter and start it. A period of 0 counts from zero,
+// anything else makes it a sampling counter that overflows after 'period' events.
+int Pmu::claim(PmuEvent event, kstd::uint32_t period, OverflowHandler handler, void* context) {
+    if (!event_supported(event)) return -1;
+    PmuCpu& state = pmu_cpu[Kernel::cpu_id()];
+    kstd::uint32_t all = state.counters ? (1u << state.counters) - 1 : 0;
+    kstd::uint32_t free = all & ~state.allocated;
+    if (!free) return -1;
+    unsigned int counter = static_cast<unsigned int>(__builtin_ctz(free));
+    state.allocated |= 1u << counter;
+    if (period) {
+        state.period[counter] = period;
+        state.handler[counter] = handler;
+        state.context[counter] = context;
+        state.sampling |= 1u << counter;
+    }
+    state.high[counter] = 0;
+
+    // Count at EL0 and EL1 (P, U clear) and interrupt on overflow
+    select_counter(counter);
+    asm volatile("msr pmxevtyper_el0, %0" : : "r"(static_cast<kstd::uint64_t>(event)));
+    asm volatile("msr pmxevcntr_el0, %0" : : "r"(static_cast<kstd::uint64_t>(0u - period)));
+    asm volatile("msr pmovsclr_el0, %0" : : "r"(static_cast<kstd::uint64_t>(1u << counter)));
+    asm volatile("msr pmintenset_el1, %0" : : "r"(static_cast<kstd::uint64_t>(1u << counter)));
+    asm volatile("msr pmcntenset_el0, %0; isb" : : "r"(static_cast<kstd::uint64_t>(1u << counter)) : "memory");
+    return static_cast<int>(counter);
+}
+
+void Pmu::release(int counter) {
+    kstd::uint64_t daif = Kernel::irq_save();
+    PmuCpu& state = pmu_cpu[Kernel::cpu_id()];
+    if (counter >= 0 && static_cast<unsigned int>(counter) < state.counters) {
+        kstd::uint64_t bit = 1u << counter;
+        asm volatile("msr pmcntenclr_el0, %0" : : "r"(bit));
+        asm volatile("msr pmintenclr_el1, %0" : : "r"(bit));
+        asm volatile("msr pmovsclr_el0, %0; isb" : : "r"(bit) : "memory");
+        state.allocated &= ~static_cast<kstd::uint32_t>(bit);
+        state.sampling &= ~static_cast<kstd::uint32_t>(bit);
+    }
+    Kernel::irq_restore(daif);
+}
+
+kstd::uint64_t Pmu::read(int counter) {
+    kstd::uint64_t daif = Kernel::irq_save();
+    PmuCpu& state = pmu_cpu[Kernel::cpu_id()];
+    if (counter < 0 || static_cast<unsigned int>(counter) >= state.counters || (state.sampling & (1u << counter))) {
+        Kernel::irq_restore(daif);
+        return 0;
+    }
+    // With IRQs masked the overflow handler cannot run here, but the counter can still wrap.
+    // If PMOVSSET shows a wrap not yet accounted for, the low half is read again after it.
+    select_counter(static_cast<unsigned int>(counter));
+    kstd::uint32_t low = read_selected_counter();
+    kstd::uint64_t high = state.high[counter];
+    if (overflow_status() & (1u << counter)) {
+        low = read_selected_counter();
+        high++;
+    }
+    Kernel::irq_restore(daif);
+    return (high << 32) | low;
+}
+
+void Pmu::overflow_irq(unsigned int irq_num, void* context) {
+    (void)irq_num; (void)context;
+    kstd::uint64_t daif = Kernel::irq_save(); // Against a preempted read() on this core
+    PmuCpu& state = pmu_cpu[Kernel::cpu_id()];
+    kstd::uint32_t ovs = overflow_status() & state.allocated;
+    asm volatile("msr pmovsclr_el0, %0; isb" : : "r"(static_cast<kstd::uint64_t>(ovs)) : "memory");
+    while (ovs) {
+        unsigned int counter = static_cast<unsigned int>(__builtin_ctz(ovs));
+        ovs &= ovs - 1;
+        if (state.sampling & (1u << counter)) {
+            // Re-arm from the overflow, whatever counted since then is lost (skid)
+            select_counter(counter);
+            asm volatile("msr pmxevcntr_el0, %0" : : "r"(static_cast<kstd::uint64_t>(0u - state.period[counter])));
+            state.handler[counter](state.context[counter]);
+        } else {
+            state.high[counter]++;
+        }
+    }
+    Kernel::irq_restore(daif);
+}
+
+PmuScope::PmuScope(PmuEvent event, PmuCount& total)
+    : total(total), counter(Pmu::allocate(event)), start_events(0), start_cycles(0) {
+    start_events = counting() ? Pmu::read(counter) : 0;
+    start_cycles = Pmu::cycles();
+}
+
+PmuScope::~PmuScope() {
+    kstd::uint64_t end_cycles = Pmu::cycles();
+    total.cycles += end_cycles - start_cycles;
+    if (counting()) {
+        total.events += Pmu::read(counter) - start_events;
+        Pmu::release(counter);
+    }
+}
+
+} // namespace Arm
+} // namespace Arch
@@ -0,0 +1,109 @@
+#ifndef ARCH_ARM_CORE_PMU_H
+#define ARCH_ARM_CORE_PMU_H
+
+#include <kstd/cstdint.h>
+
+namespace Arch {
+namespace Arm {
+
+// ARMv8 common event numbers (PMEVTYPER<n>_EL0.evtCount). Which ones a core implements is in
+// PMCEID0/1_EL0: see Pmu::event_supported. The Cortex-A72 has none of the STALL_* events.
+enum class PmuEvent : kstd::uint16_t {
+    L1I_CACHE_REFILL = 0x01,
+    L1D_CACHE_REFILL = 0x03,
+    L1D_CACHE        = 0x04,
+    L1D_TLB_REFILL   = 0x05,
+    INST_RETIRED     = 0x08,
+    EXC_TAKEN        = 0x09,
+    BR_MIS_PRED      = 0x10,
+    CPU_CYCLES       = 0x11,
+    BR_PRED          = 0x12,
+    MEM_ACCESS       = 0x13,
+    L2D_CACHE        = 0x16,
+    L2D_CACHE_REFILL = 0x17,
+    BUS_ACCESS       = 0x19,
+    STALL_FRONTEND   = 0x23,
+    STALL_BACKEND    = 0x24,
+};
+
+// Performance Monitors of the calling core (Cortex-A72: the 64-bit cycle counter PMCCNTR_EL0
+// and six 32-bit event counters). Each core has its own: counters are allocated, read and
+// released on the CPU that uses them, and count EL1 and EL0.
+//
+// The cycle counter runs from init_cpu() on and is shared: users take differences. Event
+// counters are handed out one per allocate() and extended to 64 bits by the overflow IRQ
+// (BCM2711: SPI 16 + cpu, routed to that core), so they do not wrap in practice either.
+class Pmu {
+public:
+    static constexpr unsigned int MAX_EVENT_COUNTERS = 31; // PMCR_EL0.N is 5 bits
+    static constexpr unsigned int IRQ_BASE = 48;           // PMU IRQ of CPU n is IRQ_BASE + n
+
+    // Start the calling core's PMU. Once per core: at boot for CPU 0, in secondary_main for
+    // the others, after the core is online (its overflow IRQ is pinned to it).
+    static void init_cpu();
+
+    // PMCCNTR_EL0. The ISB keeps the read from being speculated ahead of measured code.
+    static inline kstd::uint64_t cycles() {
+        kstd::uint64_t ccnt;
+        asm volatile("isb; mrs %0, pmccntr_el0" : "=r"(ccnt) : : "memory");
+        return ccnt;
+    }
+
+    // Event counters of this core, 0 before init_cpu
+    static unsigned int num_counters();
+    // Whether this core counts 'event' (PMCEID0/1_EL0)
+    static bool event_supported(PmuEvent event);
+    static const char* event_name(PmuEvent event);
+
+    // Claim a free event counter on this core and start it counting 'event'. Returns the
+    // counter index, or -1 if all are taken or the event is not supported.
+    static int allocate(PmuEvent event);
+    static void release(int counter);
+
+    // Events counted since allocate(), 64 bits
+    static kstd::uint64_t read(int counter);
+
+    // Sampling: like allocate(), but the counter overflows every 'period' events and each
+    // overflow calls handler(context) from this core's overflow IRQ, where
+    // Kernel::irq_interrupted_context tells what was running. Freed with release(); read()
+    // returns 0 for it.
+    using OverflowHandler = void (*)(void* context);
+    static int allocate_sampling(PmuEvent event, kstd::uint32_t period, OverflowHandler handler, void* context);
+
+private:
+    static void overflow_irq(unsigned int irq_num, void* context);
+    static int claim(PmuEvent event, kstd::uint32_t period, OverflowHandler handler, void* context);
+};
+
+struct PmuCount {
+    kstd::uint64_t cycles;
+    kstd::uint64_t events;
+};
+
+// Counts cycles and one event over its lifetime on the calling core and adds both to 'total',
+// so one PmuCount can sum a region over several runs. If no counter is free only cycles are
+// counted (counting() is false). Must be destroyed on the core that created it.
+//
+//     PmuCount misses = {};
+//     { PmuScope scope(PmuEvent::L1D_CACHE_REFILL, misses); copy(dst, src, size); }
+class PmuScope {
+public:
+    PmuScope(PmuEvent event, PmuCount& total);
+    ~PmuScope();
+
+    bool counting() const { return counter >= 0; }
+
+    PmuScope(const PmuScope&) = delete;
+    PmuScope& operator=(const PmuScope&) = delete;
+
+private:
+    PmuCount& total;
+    int counter;
+    kstd::uint64_t start_events;
+    kstd::uint64_t start_cycles;
+};
+
+} // namespace Arm
+} // namespace Arch
+
+#endif // ARCH_ARM_CORE_PMU_H
@@ -0,0 +1,116 @@
+#include <kernel/smp.h>
+#include <kernel/console.h>      // For kprintf
+#include <kernel/interrupt.h>    // For get_interrupt_controller (per-CPU GIC setup)
+#include <kernel/irqflags.h>     // For irq_enable
+#include <kernel/irq/softirq.h>  // For SoftIrq::run_pending in the idle loop
+#include <arch/arm/core/cache.h> // For clean_dcache_range (read with the D-cache off)
+#include <arch/arm/core/pmu.h>   // For Pmu::init_cpu
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter (start-up timeout)
+
+extern "C" void init_exceptions_this_cpu(); // exceptions.cpp
+extern "C" char _start_secondary[];         // start.S
+
+namespace Arch {
+namespace Arm {
+
+// Spin table of the Raspberry Pi 4 firmware stub (armstub8, and QEMU's raspi boot code):
+// core n waits in WFE until the 64-bit word at SPIN_TABLE_BASE + 8 * n holds an entry
+// address, then jumps there with the MMU off.
+constexpr kstd::uintptr_t SPIN_TABLE_BASE = 0xD8;
+
+constexpr kstd::size_t SECONDARY_STACK_SIZE = 16 * 1024;
+constexpr kstd::uint64_t SECONDARY_START_TIMEOUT_MS = 100;
+
+// What a secondary core needs before it can turn on its MMU (SECONDARY_BOOT_* in start.S)
+struct SecondaryBoot {
+    kstd::uint64_t mair;
+    kstd::uint64_t tcr;
+    kstd::uint64_t ttbr0;
+    kstd::uint64_t ttbr1;
+    kstd::uint64_t sctlr;
+    kstd::uint64_t stack_top[Kernel::MAX_CPUS];
+};
+static_assert(sizeof(SecondaryBoot) == 40 + 8 * Kernel::MAX_CPUS, "SecondaryBoot must match start.S");
+
+extern "C" SecondaryBoot secondary_boot;
+SecondaryBoot secondary_boot;
+
+static kstd::uint8_t secondary_stacks[Kernel::MAX_CPUS - 1][SECONDARY_STACK_SIZE] __attribute__((aligned(16)));
+
+// The boot CPU is online from the start. Only the core coming up writes its bit, while CPU 0
+// waits for it: start_secondary_cpus releases one core at a time. It waits for the core's bit
+// in started_mask, set once everything that needs it online (its pinned PMU IRQ) is set up.
+static volatile kstd::uint32_t online_mask = 1u;
+static volatile kstd::uint32_t started_mask = 1u;
+
+extern "C" void secondary_main() {
+    unsigned int cpu = Kernel::cpu_id();
+    init_exceptions_this_cpu();
+    Kernel::InterruptController* ic = Kernel::get_interrupt_controller();
+    if (ic) ic->init_cpu();
+
+    online_mask = online_mask | (1u << cpu);
+    Pmu::init_cpu();
+    started_mask = started_mask | (1u << cpu);
+    asm volatile("dsb ish; sev" ::: "memory");
+    Kernel::irq_enable();
+
+    // Nothing runs here in thread context: wait for IRQs routed to this core, and run any
+    // softirqs they left after SoftIrq::MAX_RESTARTS rounds
+    for (;;) {
+        asm volatile("wfi");
+        Kernel::SoftIrq::run_pending();
+    }
+}
+
+static bool start_cpu(unsigned int cpu) {
+    volatile kstd::uint64_t* release = reinterpret_cast<volatile kstd::uint64_t*>(SPIN_TABLE_BASE + 8 * cpu);
+    *release = reinterpret_cast<kstd::uintptr_t>(_start_secondary);
+    Cache::clean_dcache_range(const_cast<kstd::uint64_t*>(release), sizeof(*release));
+    asm volatile("sev" ::: "memory");
+
+    kstd::uint64_t timeout = RaspberryPi::GenericTimer::get_timer_frequency_hz() / 1000 * SECONDARY_START_TIMEOUT_MS;
+    kstd::uint64_t start = RaspberryPi::GenericTimer::get_counter();
+    while (!(started_mask & (1u << cpu))) {
+        if (RaspberryPi::GenericTimer::get_counter() - start > timeout) return false;
+        asm volatile("yield");
+    }
+    return true;
+}
+
+} // namespace Arm
+} // namespace Arch
+
+namespace Kernel {
+
+kstd::uint32_t online_cpus() {
+    return Arch::Arm::online_mask;
+}
+
+kstd::uint32_t start_secondary_cpus() {
+    using namespace Arch::Arm;
+    kstd::uint32_t all = (1u << MAX_CPUS) - 1;
+    if (online_mask == all) return online_mask;
+
+    // Same translation regime as this core: the tables are shared, so are the mappings
+    asm volatile("mrs %0, mair_el1" : "=r"(secondary_boot.mair));
+    asm volatile("mrs %0, tcr_el1" : "=r"(secondary_boot.tcr));
+    asm volatile("mrs %0, ttbr0_el1" : "=r"(secondary_boot.ttbr0));
+    asm volatile("mrs %0, ttbr1_el1" : "=r"(secondary_boot.ttbr1));
+    asm volatile("mrs %0, sctlr_el1" : "=r"(secondary_boot.sctlr));
+    for (unsigned int cpu = 1; cpu < MAX_CPUS; ++cpu) {
+        secondary_boot.stack_top[cpu] = reinterpret_cast<kstd::uintptr_t>(secondary_stacks[cpu - 1]) + SECONDARY_STACK_SIZE;
+    }
+    Cache::clean_dcache_range(&secondary_boot, sizeof(secondary_boot));
+
+    for (unsigned int cpu = 1; cpu < MAX_CPUS; ++cpu) {
+        if (online_mask & (1u << cpu)) continue;
+        if (!start_cpu(cpu)) {
+            kprintf("SMP: CPU%u did not come up within %llu ms.\n", cpu, SECONDARY_START_TIMEOUT_MS);
+        }
+    }
+    kprintf("SMP: %u CPUs online (mask 0x%x).\n", num_online_cpus(), online_mask);
+    return online_mask;
+}
+
+} // namespace Kernel
@@ -0,0 +1,282 @@
+#include "dma.h"
+#include <kernel/interrupt.h>  // For Kernel::get_interrupt_controller
+#include <lib/printf/printf.h> // For Kernel::kprintf
+#include <kstd/cstring.h>      // For kmemcpy
+#include <arch/arm/core/cache.h> // For Arch::Arm::Cache (coherency with the engines)
+#include <kernel/init/initcall.h> // For KERNEL_INITCALL
+
+namespace Arch {
+namespace RaspberryPi {
+
+// Static control block storage
+DMAControlBlock DMAController::control_blocks[DMA_NUM_CHANNELS][DMA_MAX_SEGMENTS];
+
+static DMAController global_dma_controller;
+
+DMAController& get_dma_controller() {
+    return global_dma_controller;
+}
+
+
+// Translate an ARM physical address to the bus address the legacy DMA engines use.
+static bool to_bus_address(kstd::uintptr_t addr, kstd::size_t size, kstd::uint32_t& out_bus) {
+    if (addr + size <= DMA_RAM_LIMIT) {
+        out_bus = static_cast<kstd::uint32_t>(addr) | DMA_BUS_RAM_ALIAS;
+        return true;
+    }
+    // Main peripheral window: ARM 0xFE000000 -> bus 0x7E000000
+    if (addr >= 0xFE000000 && addr + size <= 0xFF800000) {
+        out_bus = static_cast<kstd::uint32_t>(addr - 0xFE000000 + 0x7E000000);
+        return true;
+    }
+    return false;
+}
+
+static kstd::uintptr_t from_bus_address(kstd::uint32_t bus) {
+    return static_cast<kstd::uintptr_t>(bus & ~DMA_BUS_RAM_ALIAS);
+}
+
+// C-style trampoline for the GIC; context carries the channel number
+static void dma_irq_trampoline(unsigned int irq_num, void* context) {
+    (void)irq_num;
+    int channel = static_cast<int>(reinterpret_cast<kstd::uintptr_t>(context));
+    global_dma_controller.handle_interrupt(channel);
+}
+
+
+void DMAController::init() {
+    Kernel::InterruptController* ic = Kernel::get_interrupt_controller();
+    kstd::uint32_t enable = *(volatile kstd::uint32_t*)(DMA_BASE + DMA_ENABLE_OFFSET);
+
+    for (int ch = 0; ch < static_cast<int>(DMA_NUM_CHANNELS); ++ch) {
+        channels[ch].busy = false;
+        channels[ch].allocated = false;
+        channels[ch].last_error = false;
+        channels[ch].cb_count = 0;
+        channels[ch].callback = nullptr;
+        channels[ch].context = nullptr;
+        if (!valid_channel(ch)) continue;
+
+        enable |= (1u << ch);
+        mmio_write(ch, DMA_CS_OFFSET, DMA_CS_RESET);
+        mmio_write(ch, DMA_DEBUG_OFFSET, DMA_DEBUG_ERRORS);
+
+        if (ic) {
+            unsigned int irq = DMA_IRQ_BASE + ch;
+            if (ic->register_handler(irq, dma_irq_trampoline, reinterpret_cast<void*>(static_cast<kstd::uintptr_t>(ch)),
+                                     Kernel::IRQ_PRIORITY_DEFAULT)) {
+                ic->enable_irq(irq);
+            } else {
+                Kernel::kprintf("DMA: Failed to register IRQ %u for channel %d.\n", irq, ch);
+            }
+        }
+    }
+    *(volatile kstd::uint32_t*)(DMA_BASE + DMA_ENABLE_OFFSET) = enable;
+
+    initialized = true;
+    Kernel::kprintf("DMA: Channels 0x%x enabled (IRQ %u + n).\n", DMA_ARM_CHANNEL_MASK, DMA_IRQ_BASE);
+}
+
+int DMAController::allocate_channel() {
+    if (!initialized) return -1;
+    kstd::uint64_t daif = lock.lock_irqsave();
+    int result = -1;
+    // Highest first: the firmware is more likely to use the low channels
+    for (int ch = static_cast<int>(DMA_NUM_CHANNELS) - 1; ch >= 0; --ch) {
+        if (valid_channel(ch) && !channels[ch].allocated) {
+            channels[ch].allocated = true;
+            result = ch;
+            break;
+        }
+    }
+    lock.unlock_irqrestore(daif);
+    return result;
+}
+
+void DMAController::free_channel(int channel) {
+    if (!valid_channel(channel)) return;
+    channels[channel].allocated = false;
+}
+
+bool DMAController::start(int channel, const DMASegment* segments, kstd::size_t count,
+                          DMACallback callback, void* context) {
+    if (!initialized || !valid_channel(channel) || !channels[channel].allocated) return false;
+    if (channels[channel].busy || count == 0 || count > DMA_MAX_SEGMENTS) return false;
+
+    DMAControlBlock* cbs = control_blocks[channel];
+    for (kstd::size_t i = 0; i < count; ++i) {
+        const DMASegment& seg = segments[i];
+        kstd::uintptr_t src = reinterpret_cast<kstd::uintptr_t>(seg.src);
+        kstd::uintptr_t dst = reinterpret_cast<kstd::uintptr_t>(seg.dest);
+        kstd::uint32_t src_bus, dst_bus, next_bus = 0;
+        if (seg.length == 0 || seg.length > 0x3FFFFFFF ||
+            !to_bus_address(src, seg.length, src_bus) || !to_bus_address(dst, seg.length, dst_bus)) {
+            return false;
+        }
+        if (i + 1 < count) {
+            to_bus_address(reinterpret_cast<kstd::uintptr_t>(&cbs[i + 1]), sizeof(DMAControlBlock), next_bus);
+        }
+
+        kstd::uint32_t ti = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP | DMA_TI_BURST_LENGTH(4);
+        if (((src | dst | seg.length) & 0xF) == 0) {
+            ti |= DMA_TI_SRC_WIDTH | DMA_TI_DEST_WIDTH; // 128-bit bus accesses
+        }
+        if (i + 1 == count) {
+            ti |= DMA_TI_INTEN; // Interrupt once, at the end of the chain
+        }
+        cbs[i].transfer_info = ti;
+        cbs[i].source_ad = src_bus;
+        cbs[i].dest_ad = dst_bus;
+        cbs[i].transfer_length = static_cast<kstd::uint32_t>(seg.length);
+        cbs[i].stride = 0;
+        cbs[i].next_control_block = next_bus;
+        cbs[i].reserved[0] = cbs[i].reserved[1] = 0;
+
+        // Publish the source; drop destination lines so no dirty line is evicted on top of DMA data
+        Arch::Arm::Cache::clean_dcache_range(seg.src, seg.length);
+        Arch::Arm::Cache::clean_invalidate_dcache_range(seg.dest, seg.length);
+    }
+    Arch::Arm::Cache::clean_dcache_range(cbs, count * sizeof(DMAControlBlock));
+
+    kstd::uint32_t cb_bus = 0;
+    to_bus_address(reinterpret_cast<kstd::uintptr_t>(cbs), sizeof(DMAControlBlock), cb_bus);
+
+    channels[channel].cb_count = count;
+    channels[channel].callback = callback;
+    channels[channel].context = context;
+    channels[channel].last_error = false;
+    channels[channel].busy = true;
+
+    mmio_write(channel, DMA_CS_OFFSET, DMA_CS_END | DMA_CS_INT); // Clear stale status
+    mmio_write(channel, DMA_CONBLK_AD_OFFSET, cb_bus);
+    mmio_write(channel, DMA_CS_OFFSET, DMA_CS_ACTIVE | DMA_CS_PRIORITY(8) | DMA_CS_PANIC_PRIORITY(15) |
+                                       DMA_CS_WAIT_FOR_OUTSTANDING_WRITES);
+    return true;
+}
+
+bool DMAController::is_busy(int channel) const {
+    return valid_channel(channel) && channels[channel].busy;
+}
+
+void DMAController::complete(int channel) {
+    Channel& ch = channels[channel];
+    kstd::uint32_t cs = mmio_read(channel, DMA_CS_OFFSET);
+    ch.last_error = (cs & DMA_CS_ERROR) != 0;
+    if (ch.last_error) {
+        Kernel::kprintf("DMA: Channel %d error (CS 0x%x, DEBUG 0x%x).\n", channel, cs,
+                        mmio_read(channel, DMA_DEBUG_OFFSET));
+        mmio_write(channel, DMA_DEBUG_OFFSET, DMA_DEBUG_ERRORS);
+        mmio_write(channel, DMA_CS_OFFSET, DMA_CS_RESET);
+    }
+    mmio_write(channel, DMA_CS_OFFSET, DMA_CS_END | DMA_CS_INT);
+
+    // Drop any lines the CPU may have speculatively pulled in while the engine was writing
+    for (kstd::size_t i = 0; i < ch.cb_count; ++i) {
+        const DMAControlBlock& cb = control_blocks[channel][i];
+        Arch::Arm::Cache::invalidate_dcache_range(reinterpret_cast<void*>(from_bus_address(cb.dest_ad)), cb.transfer_length);
+    }
+
+    ch.busy = false;
+}
+
+void DMAController::poll(int channel, bool from_irq) {
+    DMACallback callback = nullptr;
+    void* context = nullptr;
+    bool error = false;
+
+    kstd::uint64_t daif = lock.lock_irqsave();
+    Channel& ch = channels[channel];
+    if (ch.busy && (mmio_read(channel, DMA_CS_OFFSET) & (DMA_CS_END | DMA_CS_ERROR))) {
+        complete(channel);
+        callback = ch.callback;
+        context = ch.context;
+        error = ch.last_error;
+    } else if (from_irq) {
+        mmio_write(channel, DMA_CS_OFFSET, DMA_CS_INT); // Spurious or already polled; just ack
+    }
+    lock.unlock_irqrestore(daif);
+
+    if (callback) {
+        callback(channel, error, context);
+    }
+}
+
+bool DMAController::wait(int channel) {
+    if (!valid_channel(channel)) return false;
+    while (channels[channel].busy) {
+        poll(channel, false); // Poll the engine too, so waiting works with IRQs masked
+    }
+    return !channels[channel].last_error;
+}
+
+void DMAController::shutdown() {
+    if (!initialized) return;
+    for (int ch = 0; ch < static_cast<int>(DMA_NUM_CHANNELS); ++ch) {
+        if (!valid_channel(ch)) continue;
+        wait(ch);
+        mmio_write(ch, DMA_CS_OFFSET, DMA_CS_RESET);
+    }
+    initialized = false;
+}
+
+void DMAController::handle_interrupt(int channel) {
+    if (valid_channel(channel)) {
+        poll(channel, true);
+    }
+}
+
+
+void dma_init_global() {
+    global_dma_controller.init();
+}
+// Needs the GIC for completion interrupts
+KERNEL_INITCALL(INITCALL_LEVEL_DEVICE, "dma", dma_init_global);
+
+
+// dma_memcpy owns its channel until dma_wait has read the result: released on completion,
+// another copy could take the channel and dma_wait would report that copy's status instead
+struct MemcpyRequest {
+    DMACallback callback;
+    void* context;
+};
+static MemcpyRequest memcpy_requests[DMA_NUM_CHANNELS];
+
+static void dma_memcpy_done(int channel, bool error, void* context) {
+    (void)context;
+    MemcpyRequest req = memcpy_requests[channel];
+    if (req.callback) {
+        req.callback(channel, error, req.context);
+    }
+}
+
+int dma_memcpy(void* dest, const void* src, kstd::size_t n, DMACallback callback, void* context) {
+    int channel = -1;
+    if (n >= DMA_MEMCPY_MIN_BYTES && global_dma_controller.is_initialized()) {
+        channel = global_dma_controller.allocate_channel();
+    }
+    if (channel >= 0) {
+        memcpy_requests[channel].callback = callback;
+        memcpy_requests[channel].context = context;
+        DMASegment seg = { dest, src, n };
+        if (global_dma_controller.start(channel, &seg, 1, dma_memcpy_done, nullptr)) {
+            return channel;
+        }
+        global_dma_controller.free_channel(channel); // Not DMA-reachable
+    }
+
+    kstd::kmemcpy(dest, src, n);
+    if (callback) {
+        callback(DMA_COPY_DONE, false, context);
+    }
+    return DMA_COPY_DONE;
+}
+
+bool dma_wait(int handle) {
+    if (handle == DMA_COPY_DONE) return true;
+    bool ok = global_dma_controller.wait(handle);
+    global_dma_controller.free_channel(handle);
+    return ok;
+}
+
+} // namespace RaspberryPi
+} // namespace Arch
@@ -0,0 +1,184 @@
+#ifndef ARCH_ARM_PERIPHERALS_DMA_H
+#define ARCH_ARM_PERIPHERALS_DMA_H
+
+#include <kstd/cstdint.h>
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kernel/spinlock.h> // For Kernel::Spinlock (the channel IRQs may go to any core)
+
+namespace Arch {
+namespace RaspberryPi {
+
+// BCM2711 DMA controller. Channels 0-14 sit at 0xFE007000 + n * 0x100 (ARM physical).
+// Channels 0-6 are full DMA engines, 7-10 are DMA LITE and 11-14 are DMA4 engines with their own
+// register layout; this driver only drives the full engines.
+constexpr kstd::uintptr_t DMA_BASE            = 0xFE007000;
+constexpr kstd::uintptr_t DMA_CHANNEL_STRIDE  = 0x100;
+constexpr kstd::uintptr_t DMA_INT_STATUS_OFFSET = 0xFE0; // One bit per channel
+constexpr kstd::uintptr_t DMA_ENABLE_OFFSET   = 0xFF0; // One bit per channel
+
+// Per-channel register offsets
+constexpr kstd::uintptr_t DMA_CS_OFFSET        = 0x00; // Control and Status
+constexpr kstd::uintptr_t DMA_CONBLK_AD_OFFSET = 0x04; // Control Block Address (bus address)
+constexpr kstd::uintptr_t DMA_TI_OFFSET        = 0x08; // Current CB: Transfer Information
+constexpr kstd::uintptr_t DMA_SOURCE_AD_OFFSET = 0x0C;
+constexpr kstd::uintptr_t DMA_DEST_AD_OFFSET   = 0x10;
+constexpr kstd::uintptr_t DMA_TXFR_LEN_OFFSET  = 0x14;
+constexpr kstd::uintptr_t DMA_NEXTCONBK_OFFSET = 0x1C;
+constexpr kstd::uintptr_t DMA_DEBUG_OFFSET     = 0x20;
+
+// CS register bits
+constexpr kstd::uint32_t DMA_CS_ACTIVE   = (1 << 0);
+constexpr kstd::uint32_t DMA_CS_END      = (1 << 1);  // Write 1 to clear
+constexpr kstd::uint32_t DMA_CS_INT      = (1 << 2);  // Write 1 to clear
+constexpr kstd::uint32_t DMA_CS_ERROR    = (1 << 8);
+constexpr kstd::uint32_t DMA_CS_PRIORITY(kstd::uint32_t p)       { return (p & 0xF) << 16; }
+constexpr kstd::uint32_t DMA_CS_PANIC_PRIORITY(kstd::uint32_t p) { return (p & 0xF) << 20; }
+constexpr kstd::uint32_t DMA_CS_WAIT_FOR_OUTSTANDING_WRITES = (1 << 28);
+constexpr kstd::uint32_t DMA_CS_ABORT    = (1 << 30);
+constexpr kstd::uint32_t DMA_CS_RESET    = (1U << 31);
+
+// TI (Transfer Information) bits
+constexpr kstd::uint32_t DMA_TI_INTEN     = (1 << 0);  // Interrupt when this CB completes
+constexpr kstd::uint32_t DMA_TI_WAIT_RESP = (1 << 3);  // Wait for the AXI write response
+constexpr kstd::uint32_t DMA_TI_DEST_INC  = (1 << 4);
+constexpr kstd::uint32_t DMA_TI_DEST_WIDTH= (1 << 5);  // 128-bit writes
+constexpr kstd::uint32_t DMA_TI_SRC_INC   = (1 << 8);
+constexpr kstd::uint32_t DMA_TI_SRC_WIDTH = (1 << 9);  // 128-bit reads
+constexpr kstd::uint32_t DMA_TI_BURST_LENGTH(kstd::uint32_t n) { return (n & 0xF) << 12; }
+
+// DEBUG register error bits (write 1 to clear)
+constexpr kstd::uint32_t DMA_DEBUG_ERRORS = 0x7; // READ_ERROR | FIFO_ERROR | READ_LAST_NOT_SET_ERROR
+
+// Channel n raises VideoCore IRQ 16 + n, which the GIC-400 sees as SPI 80 + n (interrupt ID 112 + n).
+constexpr unsigned int DMA_IRQ_BASE = 112;
+
+// Channels the firmware leaves to the ARM (Linux "brcm,dma-channel-mask" = 0x7f5), restricted
+// to the full engines: 0, 2, 4, 5, 6.
+constexpr kstd::uint32_t DMA_ARM_CHANNEL_MASK = 0x0075;
+constexpr unsigned int   DMA_NUM_CHANNELS     = 7;
+
+// The legacy engines see RAM through the uncached 0xC0000000 bus alias, which covers the first 1 GB.
+constexpr kstd::uint32_t  DMA_BUS_RAM_ALIAS = 0xC0000000;
+constexpr kstd::uintptr_t DMA_RAM_LIMIT     = 0x40000000;
+
+// Longest chain a single transfer may use
+constexpr kstd::size_t DMA_MAX_SEGMENTS = 16;
+
+// Copies below this size are done by the CPU; setting up a chain and the cache maintenance cost more.
+constexpr kstd::size_t DMA_MEMCPY_MIN_BYTES = 4096;
+
+// Hardware control block. Must be 32-byte aligned; NEXTCONBK links the chain (0 ends it).
+struct alignas(32) DMAControlBlock {
+    kstd::uint32_t transfer_info;
+    kstd::uint32_t source_ad;
+    kstd::uint32_t dest_ad;
+    kstd::uint32_t transfer_length;
+    kstd::uint32_t stride;
+    kstd::uint32_t next_control_block;
+    kstd::uint32_t reserved[2];
+};
+
+// One piece of a scatter-gather transfer (ARM addresses)
+struct DMASegment {
+    void* dest;
+    const void* src;
+    kstd::size_t length;
+};
+
+// Completion callback. Runs in IRQ context (or from wait() when IRQs are masked).
+// error: true if the engine reported a bus error.
+using DMACallback = void (*)(int channel, bool error, void* context);
+
+// Returned by dma_memcpy when the copy was done by the CPU and is already complete.
+constexpr int DMA_COPY_DONE = -1;
+
+
+class DMAController {
+public:
+    // Reset and enable the ARM channels and hook their interrupts into the GIC.
+    void init();
+
+    // Claim a free channel. Returns the channel number, or -1 if all are in use.
+    int allocate_channel();
+    void free_channel(int channel);
+
+    // Build a control-block chain from the segments and start it on an allocated channel.
+    // Sources are cleaned and destinations invalidated from the data cache around the transfer.
+    // The CPU must not touch the destination buffers until the transfer completes.
+    // Returns false if the channel is busy, a buffer is not DMA-reachable or there are too many segments.
+    bool start(int channel, const DMASegment* segments, kstd::size_t count,
+               DMACallback callback = nullptr, void* context = nullptr);
+
+    bool is_busy(int channel) const;
+
+    // Block until the channel is idle. Works with IRQs masked (polls the engine).
+    // Returns false if the last transfer ended with an error.
+    bool wait(int channel);
+
+    // Let running transfers finish, then reset the ARM channels. Before a warm restart (kexec).
+    void shutdown();
+
+    // Called from the GIC for the channel's IRQ
+    void handle_interrupt(int channel);
+
+    bool is_initialized() const { return initialized; }
+
+private:
+    struct Channel {
+        volatile bool busy;
+        bool allocated;
+        bool last_error;
+        kstd::size_t cb_count;
+        DMACallback callback;
+        void* context;
+    };
+
+    Channel channels[DMA_NUM_CHANNELS];
+    bool initialized = false;
+    // Channel allocation and completion: a waiter on one core and the channel's IRQ on
+    // another must not both finish the same transfer
+    Kernel::Spinlock lock;
+
+    // Control blocks live in .bss, one chain per channel
+    static DMAControlBlock control_blocks[DMA_NUM_CHANNELS][DMA_MAX_SEGMENTS];
+
+    // Finish the transfer if the engine is done, then run its callback with the lock dropped
+    // (so the callback may start the next one). From the IRQ, acknowledge it either way.
+    void poll(int channel, bool from_irq);
+
+    // Acknowledge the engine and invalidate destinations. Called with 'lock' held.
+    void complete(int channel);
+
+    static bool valid_channel(int channel) {
+        return channel >= 0 && channel < static_cast<int>(DMA_NUM_CHANNELS) &&
+               (DMA_ARM_CHANNEL_MASK & (1u << channel));
+    }
+
+    static inline void mmio_write(int channel, kstd::uintptr_t offset, kstd::uint32_t val) {
+        *(volatile kstd::uint32_t*)(DMA_BASE + channel * DMA_CHANNEL_STRIDE + offset) = val;
+    }
+
+    static inline kstd::uint32_t mmio_read(int channel, kstd::uintptr_t offset) {
+        return *(volatile kstd::uint32_t*)(DMA_BASE + channel * DMA_CHANNEL_STRIDE + offset);
+    }
+};
+
+DMAController& get_dma_controller();
+
+// Global init function, run as a device-level initcall (after the GIC is up)
+void dma_init_global();
+
+// Copy n bytes with a DMA engine. Small copies, unreachable buffers or no free channel fall
+// back to the CPU. Returns the channel to pass to dma_wait(), or DMA_COPY_DONE if the copy
+// already happened (the callback has then already run as well). The channel stays allocated
+// until dma_wait(), so every channel returned must be waited for.
+int dma_memcpy(void* dest, const void* src, kstd::size_t n,
+               DMACallback callback = nullptr, void* context = nullptr);
+
+// Wait for a dma_memcpy to finish and release its channel. No-op for DMA_COPY_DONE.
+bool dma_wait(int handle);
+
+} // namespace RaspberryPi
+} // namespace Arch
+
+#endif // ARCH_ARM_PERIPHERALS_DMA_H
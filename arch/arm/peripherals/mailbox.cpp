@@ -0,0 +1,162 @@
+#include "mailbox.h"
+#include <lib/printf/printf.h> // For Kernel::kprintf
+#include <kstd/cstdint.h>
+#include <arch/arm/core/cache.h> // For Arch::Arm::Cache
+#include <kernel/init/initcall.h> // For KERNEL_INITCALL
+
+namespace Arch {
+namespace RaspberryPi {
+
+// Static property buffer
+volatile kstd::uint32_t Mailbox::property_buffer[Mailbox::PROPERTY_BUFFER_WORDS] __attribute__((aligned(64)));
+
+bool Mailbox::call(kstd::uint8_t channel, volatile kstd::uint32_t* buffer) {
+    kstd::uintptr_t buffer_addr = reinterpret_cast<kstd::uintptr_t>(buffer);
+    if ((buffer_addr & 0xF) != 0 || buffer_addr > 0xFFFFFFFF) {
+        return false; // Mailbox only carries the upper 28 bits of a 32-bit address
+    }
+    kstd::uint32_t message = static_cast<kstd::uint32_t>(buffer_addr & ~0xFULL) | (channel & 0xF);
+
+    // The buffer is in Normal Cacheable RAM, but the VideoCore accesses memory directly:
+    // clean before the call to publish the request, invalidate after it to see the response.
+    kstd::size_t size_bytes = buffer[0]; // buffer[0] is the total size in bytes
+    Arch::Arm::Cache::clean_invalidate_dcache_range(const_cast<kstd::uint32_t*>(buffer), size_bytes);
+
+    // 1. Wait until the write mailbox has space
+    while (mmio_read(MBOX_STATUS_OFFSET) & MBOX_STATUS_FULL) {
+        asm volatile("nop");
+    }
+
+    // 2. Post the message
+    mmio_write(MBOX_WRITE_OFFSET, message);
+
+    // 3. Wait for the response on our channel. Replies for other channels are dropped.
+    while (true) {
+        while (mmio_read(MBOX_STATUS_OFFSET) & MBOX_STATUS_EMPTY) {
+            asm volatile("nop");
+        }
+        if (mmio_read(MBOX_READ_OFFSET) == message) {
+            break;
+        }
+    }
+
+    Arch::Arm::Cache::clean_invalidate_dcache_range(const_cast<kstd::uint32_t*>(buffer), size_bytes);
+    return buffer[1] == MBOX_RESPONSE_SUCCESS;
+}
+
+bool Mailbox::property_call(kstd::uint32_t tag, kstd::uint32_t* values,
+                            kstd::size_t value_words, kstd::size_t request_words) {
+    // Layout: [size, code, tag, value buffer size, request size, values..., end tag]
+    constexpr kstd::size_t HEADER_WORDS = 5;
+    if (HEADER_WORDS + value_words + 1 > PROPERTY_BUFFER_WORDS || request_words > value_words) {
+        return false;
+    }
+
+    kstd::size_t idx = 0;
+    property_buffer[idx++] = 0; // Total size, filled in below
+    property_buffer[idx++] = MBOX_REQUEST;
+    property_buffer[idx++] = tag;
+    property_buffer[idx++] = static_cast<kstd::uint32_t>(value_words * 4);
+    property_buffer[idx++] = static_cast<kstd::uint32_t>(request_words * 4);
+    for (kstd::size_t i = 0; i < value_words; ++i) {
+        property_buffer[idx++] = (i < request_words) ? values[i] : 0;
+    }
+    property_buffer[idx++] = MBOX_TAG_END;
+    property_buffer[0] = static_cast<kstd::uint32_t>(idx * 4);
+
+    if (!call(MBOX_CHANNEL_PROPERTY_ARM_TO_VC, property_buffer)) {
+        return false;
+    }
+    // The firmware sets bit 31 of the request/response size word when it processed the tag.
+    if (!(property_buffer[4] & MBOX_TAG_RESPONSE)) {
+        return false;
+    }
+
+    for (kstd::size_t i = 0; i < value_words; ++i) {
+        values[i] = property_buffer[HEADER_WORDS + i];
+    }
+    return true;
+}
+
+kstd::uint32_t Mailbox::get_clock_rate(ClockId clock) {
+    kstd::uint32_t values[2] = { static_cast<kstd::uint32_t>(clock), 0 };
+    return property_call(MBOX_TAG_GET_CLOCK_RATE, values, 2, 1) ? values[1] : 0;
+}
+
+kstd::uint32_t Mailbox::get_max_clock_rate(ClockId clock) {
+    kstd::uint32_t values[2] = { static_cast<kstd::uint32_t>(clock), 0 };
+    return property_call(MBOX_TAG_GET_MAX_CLOCK_RATE, values, 2, 1) ? values[1] : 0;
+}
+
+kstd::uint32_t Mailbox::get_min_clock_rate(ClockId clock) {
+    kstd::uint32_t values[2] = { static_cast<kstd::uint32_t>(clock), 0 };
+    return property_call(MBOX_TAG_GET_MIN_CLOCK_RATE, values, 2, 1) ? values[1] : 0;
+}
+
+kstd::uint32_t Mailbox::set_clock_rate(ClockId clock, kstd::uint32_t rate_hz, bool skip_turbo) {
+    kstd::uint32_t values[3] = { static_cast<kstd::uint32_t>(clock), rate_hz, skip_turbo ? 1u : 0u };
+    return property_call(MBOX_TAG_SET_CLOCK_RATE, values, 3, 3) ? values[1] : 0;
+}
+
+bool Mailbox::get_temperature(kstd::uint32_t& out_millidegrees) {
+    kstd::uint32_t values[2] = { 0, 0 }; // Temperature ID 0 is the SoC
+    if (!property_call(MBOX_TAG_GET_TEMPERATURE, values, 2, 1)) return false;
+    out_millidegrees = values[1];
+    return true;
+}
+
+bool Mailbox::get_max_temperature(kstd::uint32_t& out_millidegrees) {
+    kstd::uint32_t values[2] = { 0, 0 };
+    if (!property_call(MBOX_TAG_GET_MAX_TEMPERATURE, values, 2, 1)) return false;
+    out_millidegrees = values[1];
+    return true;
+}
+
+bool Mailbox::get_arm_memory(kstd::uint32_t& out_base, kstd::uint32_t& out_size) {
+    kstd::uint32_t values[2] = { 0, 0 };
+    if (!property_call(MBOX_TAG_GET_ARM_MEMORY, values, 2, 0)) return false;
+    out_base = values[0];
+    out_size = values[1];
+    return true;
+}
+
+const char* Mailbox::clock_name(ClockId clock) {
+    switch (clock) {
+        case ClockId::EMMC:  return "EMMC";
+        case ClockId::UART:  return "UART";
+        case ClockId::ARM:   return "ARM";
+        case ClockId::CORE:  return "CORE";
+        case ClockId::V3D:   return "V3D";
+        case ClockId::H264:  return "H264";
+        case ClockId::ISP:   return "ISP";
+        case ClockId::SDRAM: return "SDRAM";
+        case ClockId::PIXEL: return "PIXEL";
+        case ClockId::PWM:   return "PWM";
+        case ClockId::HEVC:  return "HEVC";
+        case ClockId::EMMC2: return "EMMC2";
+    }
+    return "?";
+}
+
+
+void mailbox_set_arm_clock_max() {
+    kstd::uint32_t current = Mailbox::get_clock_rate(ClockId::ARM);
+    kstd::uint32_t max = Mailbox::get_max_clock_rate(ClockId::ARM);
+    if (current == 0 || max == 0) {
+        Kernel::kprintf("Mailbox: Could not query ARM clock (firmware did not answer).\n");
+        return;
+    }
+    if (current >= max) {
+        Kernel::kprintf("Mailbox: ARM clock already at max (%u MHz).\n", max / 1000000);
+        return;
+    }
+
+    kstd::uint32_t new_rate = Mailbox::set_clock_rate(ClockId::ARM, max);
+    Kernel::kprintf("Mailbox: ARM clock %u MHz -> %u MHz (max %u MHz).\n",
+                    current / 1000000, new_rate / 1000000, max / 1000000);
+}
+// The firmware usually leaves the Cortex-A72 below its max rate
+KERNEL_INITCALL(INITCALL_LEVEL_ARCH, "arm clock (mailbox)", mailbox_set_arm_clock_max);
+
+} // namespace RaspberryPi
+} // namespace Arch
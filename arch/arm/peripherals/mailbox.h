@@ -0,0 +1,118 @@
+#ifndef ARCH_ARM_PERIPHERALS_MAILBOX_H
+#define ARCH_ARM_PERIPHERALS_MAILBOX_H
+
+#include <kstd/cstdint.h>
+#include <kstd/cstddef.h> // For kstd::size_t
+
+namespace Arch {
+namespace RaspberryPi {
+
+// VideoCore Mailbox 0 Base Address
+// RPi4: 0xFE00B880 (ARM physical address). The ARM reads from mailbox 0 and writes to mailbox 1,
+// which sits 0x20 bytes above it.
+constexpr kstd::uintptr_t MAILBOX_BASE = 0xFE00B880;
+
+// Mailbox Register Offsets
+constexpr kstd::uintptr_t MBOX_READ_OFFSET   = 0x00; // Mailbox 0 Read
+constexpr kstd::uintptr_t MBOX_STATUS_OFFSET = 0x18; // Mailbox 0 Status
+constexpr kstd::uintptr_t MBOX_WRITE_OFFSET  = 0x20; // Mailbox 1 Write
+
+// Status Register bits
+constexpr kstd::uint32_t MBOX_STATUS_FULL  = 0x80000000; // Write mailbox full
+constexpr kstd::uint32_t MBOX_STATUS_EMPTY = 0x40000000; // Read mailbox empty
+
+// Mailbox Channels (lower 4 bits of a mailbox message)
+constexpr kstd::uint8_t MBOX_CHANNEL_PROPERTY_ARM_TO_VC = 8;
+
+// Property buffer request/response codes
+constexpr kstd::uint32_t MBOX_REQUEST          = 0x00000000;
+constexpr kstd::uint32_t MBOX_RESPONSE_SUCCESS = 0x80000000;
+constexpr kstd::uint32_t MBOX_RESPONSE_ERROR   = 0x80000001;
+constexpr kstd::uint32_t MBOX_TAG_RESPONSE     = 0x80000000; // Set in a tag's value length on response
+constexpr kstd::uint32_t MBOX_TAG_END          = 0x00000000;
+
+// Property Tags (see the Raspberry Pi firmware wiki, "Mailbox property interface")
+constexpr kstd::uint32_t MBOX_TAG_GET_ARM_MEMORY      = 0x00010005;
+constexpr kstd::uint32_t MBOX_TAG_GET_CLOCK_RATE      = 0x00030002;
+constexpr kstd::uint32_t MBOX_TAG_GET_MAX_CLOCK_RATE  = 0x00030004;
+constexpr kstd::uint32_t MBOX_TAG_GET_TEMPERATURE     = 0x00030006;
+constexpr kstd::uint32_t MBOX_TAG_GET_MIN_CLOCK_RATE  = 0x00030007;
+constexpr kstd::uint32_t MBOX_TAG_GET_MAX_TEMPERATURE = 0x0003000A;
+constexpr kstd::uint32_t MBOX_TAG_SET_CLOCK_RATE      = 0x00038002;
+
+// Clock IDs understood by the clock rate tags
+enum class ClockId : kstd::uint32_t {
+    EMMC  = 1,
+    UART  = 2,
+    ARM   = 3,
+    CORE  = 4,
+    V3D   = 5,
+    H264  = 6,
+    ISP   = 7,
+    SDRAM = 8,
+    PIXEL = 9,
+    PWM   = 10,
+    HEVC  = 11,
+    EMMC2 = 12
+};
+
+
+// Driver for the VideoCore mailbox property interface.
+// Like GPIO, this is a stateless driver with static methods; the only state is the
+// shared property buffer, which is protected by the fact that the kernel is single-threaded.
+class Mailbox {
+public:
+    // Send a message (28-bit, 16-byte aligned buffer address) on a channel and wait for the reply.
+    // buffer: Property buffer, must be 16-byte aligned and reachable by the VideoCore.
+    // Returns true if the firmware answered with MBOX_RESPONSE_SUCCESS.
+    static bool call(kstd::uint8_t channel, volatile kstd::uint32_t* buffer);
+
+    // Clock rates in Hz. All return 0 on failure.
+    static kstd::uint32_t get_clock_rate(ClockId clock);
+    static kstd::uint32_t get_max_clock_rate(ClockId clock);
+    static kstd::uint32_t get_min_clock_rate(ClockId clock);
+
+    // Request a new clock rate. The firmware clamps it to the supported range.
+    // skip_turbo: If true, do not let the firmware raise voltages/other clocks for turbo mode.
+    // Returns the rate actually set by the firmware, or 0 on failure.
+    static kstd::uint32_t set_clock_rate(ClockId clock, kstd::uint32_t rate_hz, bool skip_turbo = false);
+
+    // SoC temperature in thousandths of a degree Celsius.
+    static bool get_temperature(kstd::uint32_t& out_millidegrees);
+    static bool get_max_temperature(kstd::uint32_t& out_millidegrees);
+
+    // Memory region reserved for the ARM by the firmware (base and size in bytes).
+    static bool get_arm_memory(kstd::uint32_t& out_base, kstd::uint32_t& out_size);
+
+    static const char* clock_name(ClockId clock);
+
+private:
+    // Send a single-tag property request.
+    // values: In/out tag values. request_words values are sent, value_words are returned.
+    static bool property_call(kstd::uint32_t tag, kstd::uint32_t* values,
+                              kstd::size_t value_words, kstd::size_t request_words);
+
+    // Helper to write to memory-mapped register
+    static inline void mmio_write(kstd::uintptr_t offset, kstd::uint32_t val) {
+        *(volatile kstd::uint32_t*)(MAILBOX_BASE + offset) = val;
+    }
+
+    // Helper to read from memory-mapped register
+    static inline kstd::uint32_t mmio_read(kstd::uintptr_t offset) {
+        return *(volatile kstd::uint32_t*)(MAILBOX_BASE + offset);
+    }
+
+    // Property buffer shared by all requests. 16-byte alignment is required by the mailbox,
+    // 64-byte alignment keeps it in cache lines of its own for the clean/invalidate around calls.
+    static constexpr kstd::size_t PROPERTY_BUFFER_WORDS = 16;
+    static volatile kstd::uint32_t property_buffer[PROPERTY_BUFFER_WORDS] __attribute__((aligned(64)));
+};
+
+// Raise the ARM core clock to the maximum the firmware allows.
+// Called once during boot, after the MMU is enabled.
+void mailbox_set_arm_clock_max();
+
+} // namespace RaspberryPi
+} // namespace Arch
+
+#endif // ARCH_ARM_PERIPHERALS_MAILBOX_H
@@ -1,6 +1,7 @@
 #include "timer.h"
 #include <kernel/interrupt.h> // For get_interrupt_controller
 #include <kernel/console.h>   // For kprintf
+#include <kernel/irq/softirq.h> // For SoftIrq::raise (user handler outside hard-IRQ context)
 #include <kstd/cstdint.h>
 
 namespace Arch {
@@ -30,6 +31,10 @@ static void generic_timer_irq_trampoline(unsigned int irq_num, void* context) {
     }
 }
 
+static void generic_timer_softirq(void* context) {
+    static_cast<GenericTimer*>(context)->run_user_handler();
+}
+
 
 GenericTimer::GenericTimer()
     : user_handler(nullptr), user_context(nullptr),
@@ -65,6 +70,7 @@ void GenericTimer::init(unsigned int frequency_hz, Kernel::InterruptHandler hand
 
     this->user_handler = handler;
     this->user_context = context;
+    Kernel::SoftIrq::open(Kernel::SoftIrq::TIMER, generic_timer_softirq, this);
 
     Kernel::InterruptController* ic = Kernel::get_interrupt_controller();
     if (!ic) {
@@ -75,7 +81,8 @@ void GenericTimer::init(unsigned int frequency_hz, Kernel::InterruptHandler hand
 
     // Register this timer's IRQ with the GIC
     // Pass 'this' as context so the trampoline can call the member function.
-    if (!ic->register_handler(this->irq_number, generic_timer_irq_trampoline, this)) {
+    // High priority: the tick preempts every other device's handler.
+    if (!ic->register_handler(this->irq_number, generic_timer_irq_trampoline, this, Kernel::IRQ_PRIORITY_HIGH)) {
         Kernel::kprintf("GenericTimer: Failed to register IRQ %u with GIC.\n", this->irq_number);
         Kernel::panic("Timer init failed: GIC registration.");
         return;
@@ -131,16 +138,15 @@ void GenericTimer::handle_interrupt() {
         set_control(false, true); // Disable and mask
     }
 
-    // Call the user-provided handler, if any
+    // The user-provided handler runs after the EOI, with IRQs enabled
+    Kernel::SoftIrq::raise(Kernel::SoftIrq::TIMER);
+    // End of interrupt: the GIC driver's dispatch loop
+}
+
+void GenericTimer::run_user_handler() {
     if (user_handler) {
         user_handler(this->irq_number, user_context);
     }
-
-    // Signal End Of Interrupt to the GIC
-    Kernel::InterruptController* ic = Kernel::get_interrupt_controller();
-    if (ic) {
-        ic->end_of_interrupt(this->irq_number);
-    }
 }
 
 
@@ -148,6 +154,10 @@ void system_timer_init_global(unsigned int frequency_hz, Kernel::InterruptHandle
     global_el1_timer_instance.init(frequency_hz, handler, context);
 }
 
+void system_timer_stop_global() {
+    global_el1_timer_instance.stop();
+}
+
 // The Makefile needs to be updated to include timer.cpp in CPP_SOURCES.
 // It is already listed there.
 
@@ -20,6 +20,7 @@ public:
 
     // Initialize the timer and set its interrupt frequency.
     // frequency_hz: Desired interrupt frequency (e.g., 100 for 100Hz).
+    // 'handler' runs from the TIMER softirq, not in hard-IRQ context (see kernel/irq/softirq.h).
     void init(unsigned int frequency_hz, Kernel::InterruptHandler handler, void* context);
 
     // Stop the timer
@@ -28,9 +29,21 @@ public:
     // Get current timer frequency (counter frequency, not interrupt frequency)
     static kstd::uint64_t get_timer_frequency_hz();
 
-    // Handle the timer interrupt (called by the common IRQ handler for this timer's IRQ)
+    // Read the physical counter (CNTPCT_EL0). The ISB keeps the read from being
+    // speculated ahead of the code being measured.
+    static inline kstd::uint64_t get_counter() {
+        kstd::uint64_t cntpct;
+        asm volatile("isb; mrs %0, cntpct_el0" : "=r"(cntpct) : : "memory");
+        return cntpct;
+    }
+
+    // Handle the timer interrupt (called by the common IRQ handler for this timer's IRQ):
+    // re-arm and raise the TIMER softirq
     void handle_interrupt();
 
+    // Call the user handler (TIMER softirq)
+    void run_user_handler();
+
 
 private:
     Kernel::InterruptHandler user_handler;
@@ -51,6 +64,9 @@ private:
 // Global function to initialize the primary system timer.
 void system_timer_init_global(unsigned int frequency_hz, Kernel::InterruptHandler handler, void* context);
 
+// Disable the timer and its IRQ (before a warm restart, see kernel/kexec)
+void system_timer_stop_global();
+
 // Global timer instance (if only one primary system timer is used this way)
 // Or, Timer could be a member of a Peripherals class.
 // For now, a global instance or access via init function.
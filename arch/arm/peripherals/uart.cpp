@@ -1,5 +1,7 @@
 #include "uart.h"
 #include "gpio.h" // For configuring GPIO pins for UART use
+#include "mailbox.h" // For querying/setting the UART reference clock
+#include "timer.h"   // For GenericTimer::get_counter (loopback test timing)
 #include <kstd/cstdint.h>
 
 namespace Arch {
@@ -17,12 +19,71 @@ UART* get_main_uart() {
 }
 
 void uart_init_global() {
-    // Default RPi4 UART clock is 48MHz. Baud rate 115200.
+    // Baud rate 115200. Ask the firmware for the actual UART reference clock instead of
+    // assuming 48MHz, since config.txt (init_uart_clock) can change it.
     // This function should be called once during kernel initialization.
-    main_uart_instance.init();
+    unsigned int uart_clock_hz = Mailbox::get_clock_rate(ClockId::UART);
+    if (uart_clock_hz == 0) {
+        uart_clock_hz = UART_DEFAULT_CLOCK_HZ;
+    }
+    main_uart_instance.init(115200, uart_clock_hz);
 }
 
-UART::UART(kstd::uintptr_t base_addr) : base_address(base_addr) {}
+bool uart_set_baud_global(unsigned int baud_rate) {
+    if (baud_rate == 0) return false;
+
+    unsigned int uart_clock_hz = main_uart_instance.get_clock_hz();
+    kstd::uint64_t required_clock_hz = static_cast<kstd::uint64_t>(baud_rate) * UART_OVERSAMPLING;
+    if (required_clock_hz <= uart_clock_hz) {
+        return main_uart_instance.set_baud_rate(baud_rate, uart_clock_hz);
+    }
+
+    // Raise the reference clock. Never go below the firmware default, so the divisors for
+    // standard rates stay exact. Check the divisors first: once the clock has changed, the
+    // current ones no longer give the current rate.
+    kstd::uint64_t wanted_hz = required_clock_hz > UART_DEFAULT_CLOCK_HZ ? required_clock_hz : UART_DEFAULT_CLOCK_HZ;
+    kstd::uint32_t ibrd = 0, fbrd = 0;
+    if (wanted_hz > 0xFFFFFFFFu || !UART::compute_divisors(baud_rate, static_cast<unsigned int>(wanted_hz), ibrd, fbrd)) {
+        return false;
+    }
+    unsigned int old_baud_rate = main_uart_instance.get_baud_rate();
+    main_uart_instance.flush(); // Clock change must not corrupt a character in flight
+    if (Mailbox::set_clock_rate(ClockId::UART, static_cast<kstd::uint32_t>(wanted_hz)) == 0) {
+        return false;
+    }
+    // The firmware may round the clock; the divisors follow what it actually set
+    unsigned int new_clock_hz = Mailbox::get_clock_rate(ClockId::UART);
+    if (new_clock_hz != 0 && main_uart_instance.set_baud_rate(baud_rate, new_clock_hz)) {
+        return true;
+    }
+    // Put the old clock and divisors back so the console keeps working
+    Mailbox::set_clock_rate(ClockId::UART, uart_clock_hz);
+    main_uart_instance.set_baud_rate(old_baud_rate, uart_clock_hz);
+    return false;
+}
+
+UART::UART(kstd::uintptr_t base_addr)
+    : base_address(base_addr), current_baud_rate(0), current_clock_hz(UART_DEFAULT_CLOCK_HZ) {}
+
+bool UART::compute_divisors(unsigned int baud_rate, unsigned int uart_clock_hz,
+                            kstd::uint32_t& out_ibrd, kstd::uint32_t& out_fbrd) {
+    if (baud_rate == 0 || static_cast<kstd::uint64_t>(baud_rate) * UART_OVERSAMPLING > uart_clock_hz) {
+        return false;
+    }
+    // BAUDDIV = FUARTCLK / (16 * baud_rate), kept as a 6-bit fixed point value:
+    // BAUDDIV * 64 = (FUARTCLK * 4) / baud_rate, rounded to nearest.
+    // Example for 115200 baud with 48MHz clock:
+    // (192,000,000 + 57,600) / 115200 = 1667 -> IBRD = 1667 >> 6 = 26, FBRD = 1667 & 63 = 3
+    kstd::uint64_t div64 = (static_cast<kstd::uint64_t>(uart_clock_hz) * 4 + baud_rate / 2) / baud_rate;
+    kstd::uint32_t ibrd = static_cast<kstd::uint32_t>(div64 >> 6);
+    kstd::uint32_t fbrd = static_cast<kstd::uint32_t>(div64 & 0x3F);
+    if (ibrd == 0 || ibrd > 0xFFFF) {
+        return false;
+    }
+    out_ibrd = ibrd;
+    out_fbrd = fbrd;
+    return true;
+}
 
 void UART::init(unsigned int baud_rate, unsigned int uart_clock_hz) {
     // 1. Disable UART before configuration
@@ -51,17 +112,15 @@ void UART::init(unsigned int baud_rate, unsigned int uart_clock_hz) {
     // 4. Clear pending interrupts (writing 1s to relevant bits)
     mmio_write(UART_ICR_OFFSET, 0x7FF); // Clear all relevant PL011 interrupt sources
 
-    // 5. Calculate baud rate divisor
-    //    BAUDDIV = (FUARTCLK / (16 * baud_rate))
-    //    IBRD = integer part of BAUDDIV
-    //    FBRD = integer part of ((fractional part of BAUDDIV * 64) + 0.5)
-    // Example for 115200 baud with 48MHz clock:
-    // BAUDDIV = 48,000,000 / (16 * 115200) = 48,000,000 / 1,843,200 = 26.041666...
-    // IBRD = 26
-    // FBRD = int((0.041666... * 64) + 0.5) = int(2.666... + 0.5) = int(3.166...) = 3
-    double baud_divisor = static_cast<double>(uart_clock_hz) / (16.0 * baud_rate);
-    kstd::uint32_t ibrd = static_cast<kstd::uint32_t>(baud_divisor);
-    kstd::uint32_t fbrd = static_cast<kstd::uint32_t>((baud_divisor - ibrd) * 64.0 + 0.5);
+    // 5. Calculate baud rate divisor (integer math, see compute_divisors).
+    //    Fall back to 115200 if the requested rate is not reachable.
+    kstd::uint32_t ibrd = 0, fbrd = 0;
+    if (!compute_divisors(baud_rate, uart_clock_hz, ibrd, fbrd)) {
+        baud_rate = 115200;
+        compute_divisors(baud_rate, uart_clock_hz, ibrd, fbrd);
+    }
+    current_baud_rate = baud_rate;
+    current_clock_hz = uart_clock_hz;
 
     mmio_write(UART_IBRD_OFFSET, ibrd);
     mmio_write(UART_FBRD_OFFSET, fbrd);
@@ -124,5 +183,104 @@ bool UART::has_data() const {
     return !(mmio_read(UART_FR_OFFSET) & UART_FR_RXFE);
 }
 
+void UART::write_byte(kstd::uint8_t byte) {
+    while (mmio_read(UART_FR_OFFSET) & UART_FR_TXFF) {
+        asm volatile("nop");
+    }
+    mmio_write(UART_DR_OFFSET, byte);
+}
+
+bool UART::try_read_byte(kstd::uint8_t& out_byte) {
+    if (mmio_read(UART_FR_OFFSET) & UART_FR_RXFE) {
+        return false;
+    }
+    out_byte = static_cast<kstd::uint8_t>(mmio_read(UART_DR_OFFSET) & 0xFF);
+    return true;
+}
+
+void UART::flush() {
+    // TXFE alone is not enough: the last character may still be in the shift register.
+    while (!(mmio_read(UART_FR_OFFSET) & UART_FR_TXFE) || (mmio_read(UART_FR_OFFSET) & UART_FR_BUSY)) {
+        asm volatile("nop");
+    }
+}
+
+bool UART::set_baud_rate(unsigned int baud_rate, unsigned int uart_clock_hz) {
+    if (uart_clock_hz == 0) {
+        uart_clock_hz = current_clock_hz;
+    }
+    kstd::uint32_t ibrd = 0, fbrd = 0;
+    if (!compute_divisors(baud_rate, uart_clock_hz, ibrd, fbrd)) {
+        return false;
+    }
+
+    // PL011 programming sequence: drain, disable, update divisors, then write LCRH
+    // (the divisor registers are only latched on an LCRH write), and re-enable.
+    flush();
+    kstd::uint32_t cr_val = mmio_read(UART_CR_OFFSET);
+    mmio_write(UART_CR_OFFSET, 0);
+    mmio_write(UART_IBRD_OFFSET, ibrd);
+    mmio_write(UART_FBRD_OFFSET, fbrd);
+    mmio_write(UART_LCRH_OFFSET, UART_LCRH_WLEN_8BIT | UART_LCRH_FEN);
+    mmio_write(UART_CR_OFFSET, cr_val | UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE);
+
+    current_baud_rate = baud_rate;
+    current_clock_hz = uart_clock_hz;
+    return true;
+}
+
+void UART::set_loopback(bool enable) {
+    flush();
+    kstd::uint32_t cr_val = mmio_read(UART_CR_OFFSET);
+    if (enable) {
+        cr_val |= UART_CR_LBE;
+    } else {
+        cr_val &= ~UART_CR_LBE;
+    }
+    mmio_write(UART_CR_OFFSET, cr_val);
+}
+
+void UART::loopback_test(kstd::size_t byte_count, kstd::uint64_t& out_ticks, kstd::size_t& out_errors) {
+    out_ticks = 0;
+    out_errors = 0;
+
+    set_loopback(true);
+    // Drop anything still sitting in the RX FIFO
+    while (has_data()) {
+        (void)mmio_read(UART_DR_OFFSET);
+    }
+
+    // Keep at most half the 32-byte RX FIFO in flight so nothing overruns while we
+    // alternate between feeding TX and draining RX.
+    constexpr kstd::size_t MAX_IN_FLIGHT = 16;
+    kstd::size_t sent = 0, received = 0;
+    kstd::uint64_t start = GenericTimer::get_counter();
+    kstd::uint64_t last_progress = start;
+    kstd::uint64_t timeout_ticks = GenericTimer::get_timer_frequency_hz() / 10; // 100 ms without progress
+
+    while (received < byte_count) {
+        kstd::uint32_t fr = mmio_read(UART_FR_OFFSET);
+        if (sent < byte_count && (sent - received) < MAX_IN_FLIGHT && !(fr & UART_FR_TXFF)) {
+            mmio_write(UART_DR_OFFSET, static_cast<kstd::uint8_t>(sent * 7 + 1));
+            sent++;
+        }
+        if (!(fr & UART_FR_RXFE)) {
+            kstd::uint32_t data = mmio_read(UART_DR_OFFSET);
+            // Bits 11:8 are the overrun/break/parity/framing error flags
+            if ((data & 0xF00) || static_cast<kstd::uint8_t>(data) != static_cast<kstd::uint8_t>(received * 7 + 1)) {
+                out_errors++;
+            }
+            received++;
+            last_progress = GenericTimer::get_counter();
+        } else if (GenericTimer::get_counter() - last_progress > timeout_ticks) {
+            out_errors += byte_count - received; // Bytes that never came back
+            break;
+        }
+    }
+
+    out_ticks = GenericTimer::get_counter() - start;
+    set_loopback(false);
+}
+
 } // namespace RaspberryPi
 } // namespace Arch
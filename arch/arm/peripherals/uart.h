@@ -36,9 +36,15 @@ constexpr kstd::uint32_t UART_LCRH_FEN     = (1 << 4);   // Enable FIFOs
 
 // Control Register bits
 constexpr kstd::uint32_t UART_CR_UARTEN = (1 << 0); // UART enable
+constexpr kstd::uint32_t UART_CR_LBE    = (1 << 7); // Loopback enable (TX fed internally to RX)
 constexpr kstd::uint32_t UART_CR_TXE    = (1 << 8); // Transmit enable
 constexpr kstd::uint32_t UART_CR_RXE    = (1 << 9); // Receive enable
 
+// Default PL011 reference clock on RPi4 (firmware default, see init_uart_clock in config.txt)
+constexpr unsigned int UART_DEFAULT_CLOCK_HZ = 48000000;
+// The PL011 oversamples by 16, so the fastest baud rate is UARTCLK / 16.
+constexpr unsigned int UART_OVERSAMPLING = 16;
+
 
 class UART {
 public:
@@ -50,7 +56,33 @@ public:
     // uart_clock_hz: The clock frequency supplied to the UART peripheral.
     // On RPi, this is often derived from the system clock (e.g., core clock / divisor).
     // For RPi4, the default UART clock is often 48MHz. This needs to be accurate.
-    void init(unsigned int baud_rate = 115200, unsigned int uart_clock_hz = 48000000);
+    void init(unsigned int baud_rate = 115200, unsigned int uart_clock_hz = UART_DEFAULT_CLOCK_HZ);
+
+    // Reprogram the baud rate divisors at runtime, keeping GPIO/FIFO setup.
+    // Waits for pending output to drain first so no character is sent at a mixed rate.
+    // uart_clock_hz: New reference clock, or 0 to keep the current one.
+    // Returns false if the rate is not reachable with the reference clock.
+    bool set_baud_rate(unsigned int baud_rate, unsigned int uart_clock_hz = 0);
+
+    // Compute IBRD/FBRD for the PL011 with integer math.
+    // Returns false if the divisor is out of range (IBRD must be 1..65535).
+    static bool compute_divisors(unsigned int baud_rate, unsigned int uart_clock_hz,
+                                 kstd::uint32_t& out_ibrd, kstd::uint32_t& out_fbrd);
+
+    unsigned int get_baud_rate() const { return current_baud_rate; }
+    unsigned int get_clock_hz() const { return current_clock_hz; }
+
+    // Block until the TX FIFO is empty and the last character has left the shift register.
+    void flush();
+
+    // Route TX internally back to RX (nothing reaches the TX pin while enabled).
+    void set_loopback(bool enable);
+
+    // Send byte_count bytes through the internal loopback and read them back.
+    // out_ticks: Generic timer ticks spent (CNTPCT_EL0 delta).
+    // out_errors: Bytes that were lost or came back different.
+    // Interrupts should be masked by the caller so nothing else writes to the UART meanwhile.
+    void loopback_test(kstd::size_t byte_count, kstd::uint64_t& out_ticks, kstd::size_t& out_errors);
 
     // Write a single character
     void write_char(char c);
@@ -64,8 +96,15 @@ public:
     // Check if receive FIFO has data
     bool has_data() const;
 
+    // Raw binary I/O for bulk transfers: no '\n' -> '\r\n' translation.
+    void write_byte(kstd::uint8_t byte);
+    // Non-blocking read. Returns false if the RX FIFO is empty.
+    bool try_read_byte(kstd::uint8_t& out_byte);
+
 private:
     kstd::uintptr_t base_address;
+    unsigned int current_baud_rate;
+    unsigned int current_clock_hz;
 
     // Helper to write to memory-mapped register
     inline void mmio_write(kstd::uintptr_t offset, kstd::uint32_t val) const {
@@ -93,6 +132,11 @@ UART* get_main_uart();
 // Global init function, typically called from kernel_main
 void uart_init_global();
 
+// Switch the main UART to a new baud rate.
+// If the current reference clock is too slow for the rate, a faster UART clock is requested
+// from the firmware via the mailbox first. On failure the previous clock and rate stay in effect.
+bool uart_set_baud_global(unsigned int baud_rate);
+
 
 } // namespace RaspberryPi
 } // namespace Arch
@@ -2,25 +2,39 @@
 #define KERNEL_INTERRUPT_H
 
 #include <kstd/cstdint.h>
+#include <kernel/smp.h> // For MAX_CPUS
 
 namespace Kernel {
 
-// Maximum number of IRQs supported. Adjust as needed for the specific GIC version.
-// GICv2 typically supports up to 1020 SPIs (Shared Peripheral Interrupts).
-// SGIs (Software Generated Interrupts) are 0-15.
-// PPIs (Private Peripheral Interrupts) are 16-31.
-constexpr unsigned int MAX_IRQS = 256; // A reasonable starting point, can be increased.
+// Number of interrupt IDs: the GICv2 IAR returns a 10-bit ID, so a table of this size is
+// indexed by it directly. SGIs are 0-15, PPIs 16-31, SPIs 32-1019, 1020-1023 are special
+// (1023: spurious).
+constexpr unsigned int MAX_IRQS = 1024;
+
+// Priorities (GICD_IPRIORITYR): lower is more urgent. While a handler runs, only IRQs of a more
+// urgent priority level can preempt it; IRQs of the same or a lower level wait for its EOI.
+constexpr kstd::uint8_t IRQ_PRIORITY_HIGH    = 0x40; // Timer and other latency-critical sources
+constexpr kstd::uint8_t IRQ_PRIORITY_DEFAULT = 0xA0;
+constexpr kstd::uint8_t IRQ_PRIORITY_LOW     = 0xC0; // Slow handlers that must not delay the rest
 
 // Define a type for interrupt handler functions
 // The context parameter can be used to pass data to the handler (e.g., device instance)
 // The irq_num is the ID of the interrupt that occurred.
 using InterruptHandler = void (*)(unsigned int irq_num, void* context);
 
-// Structure to hold interrupt registration details
+// One slot of the dispatch table. handler is never null: free slots hold the controller's
+// fallback for unhandled IRQs.
 struct InterruptRegistration {
     InterruptHandler handler;
     void* context;
-    bool is_registered;
+    kstd::uint64_t count[MAX_CPUS]; // Times dispatched on each CPU
+    kstd::uint64_t last_eoi; // CNTPCT_EL0 right after the last EOI
+    kstd::uint8_t priority;
+};
+
+struct InterruptStats {
+    kstd::uint64_t spurious;  // Exception entries that found nothing pending (IAR = 1023)
+    kstd::uint64_t unhandled; // IRQs without a handler (each is disabled after its first one)
 };
 
 
@@ -32,24 +46,48 @@ public:
     // Initialize the interrupt controller
     virtual void init() = 0;
 
+    // Per-CPU part of init() for a secondary core (its CPU interface and banked registers).
+    // Called on that core before it unmasks IRQs.
+    virtual void init_cpu() = 0;
+
     // Enable a specific IRQ
     virtual void enable_irq(unsigned int irq_num) = 0;
 
     // Disable a specific IRQ
     virtual void disable_irq(unsigned int irq_num) = 0;
 
-    // Signal the end of interrupt processing for a specific IRQ
-    virtual void end_of_interrupt(unsigned int irq_num) = 0;
-
-    // Register a handler for a specific IRQ
-    virtual bool register_handler(unsigned int irq_num, InterruptHandler handler, void* context) = 0;
+    // Register a handler for a specific IRQ and set its priority (IRQ_PRIORITY_*).
+    // The handler runs with IRQs unmasked and may be preempted by more urgent IRQs.
+    virtual bool register_handler(unsigned int irq_num, InterruptHandler handler, void* context,
+                                  kstd::uint8_t priority) = 0;
 
     // Unregister a handler for a specific IRQ
     virtual bool unregister_handler(unsigned int irq_num) = 0;
 
-    // Dispatch an interrupt to its registered handler.
-    // This would be called by the common IRQ entry point.
-    virtual void dispatch_interrupt(unsigned int irq_num) = 0;
+    // Dispatch pending interrupts to their registered handlers, called from the IRQ entry.
+    // The controller signals end of interrupt itself: handlers only deal with their device.
+    // With allow_preemption, IRQs are unmasked while each handler runs.
+    virtual void dispatch_interrupt(bool allow_preemption) = 0;
+
+    virtual InterruptStats stats() const = 0;
+
+    // Route a shared IRQ to the CPUs in cpu_mask (bit n = CPU n); each occurrence goes to one
+    // of them. Fails for per-CPU IRQs (SGIs, PPIs) and for masks naming offline CPUs.
+    virtual bool set_affinity(unsigned int irq_num, kstd::uint32_t cpu_mask) = 0;
+    // CPUs irq_num is routed to, 0 for per-CPU IRQs
+    virtual kstd::uint32_t affinity(unsigned int irq_num) const = 0;
+
+    // Raise SGI sgi_num (0-15) on each CPU in cpu_mask. Memory writes made before the call are
+    // visible to the handlers it runs.
+    virtual void send_sgi(unsigned int sgi_num, kstd::uint32_t cpu_mask) = 0;
+
+    // Times irq_num was dispatched (on all CPUs, or on one), 0 if it has no handler
+    virtual kstd::uint64_t irq_count(unsigned int irq_num) const = 0;
+    virtual kstd::uint64_t irq_count_cpu(unsigned int irq_num, unsigned int cpu) const = 0;
+    virtual kstd::uint8_t irq_priority(unsigned int irq_num) const = 0;
+    // CNTPCT_EL0 right after irq_num's most recent end of interrupt (latency measurements)
+    virtual kstd::uint64_t irq_eoi_ticks(unsigned int irq_num) const = 0;
+    virtual bool has_handler(unsigned int irq_num) const = 0;
 
     // Globally enable interrupts at the CPU level
     virtual void enable_cpu_interrupts() = 0;
@@ -61,6 +99,23 @@ public:
 // Global access to the main interrupt controller instance
 InterruptController* get_interrupt_controller();
 
+// CNTPCT_EL0 at the exception vector of the innermost IRQ being handled. For handlers that
+// measure their own latency (kernel/trace/latency.h).
+kstd::uint64_t irq_entry_ticks();
+
+// True while this CPU is handling an IRQ, at any nesting level
+bool in_irq();
+
+// Where the innermost IRQ being handled on this CPU arrived: PC (ELR_EL1), PSTATE (SPSR_EL1)
+// and frame pointer (x29, the head of the interrupted code's frame record chain). For
+// sampling profilers (kernel/trace/profile.h). False outside IRQ handlers.
+struct InterruptedContext {
+    kstd::uint64_t pc;
+    kstd::uint64_t spsr;
+    kstd::uint64_t fp;
+};
+bool irq_interrupted_context(InterruptedContext& context);
+
 } // namespace Kernel
 
 #endif // KERNEL_INTERRUPT_H
@@ -0,0 +1,56 @@
+#ifndef KERNEL_IRQFLAGS_H
+#define KERNEL_IRQFLAGS_H
+
+#include <kstd/cstdint.h>
+
+namespace Kernel {
+
+// Masking IRQs on this CPU (DAIF.I). Critical sections in C++ go through these helpers rather
+// than raw 'msr daif*', so the irqsoff tracer (kernel/trace/irqsoff.h) sees every transition
+// from unmasked to masked and back. Exception vectors mask in hardware; c_irq_handler and
+// c_sync_handler report those sections themselves.
+
+constexpr kstd::uint64_t DAIF_I = (1u << 7);
+
+namespace Trace {
+extern volatile bool irqsoff_tracing;
+void irqsoff_begin(kstd::uintptr_t pc); // IRQs just became masked at pc
+void irqsoff_end(kstd::uintptr_t pc);   // IRQs are about to be unmasked at pc
+} // namespace Trace
+
+// Address of the instruction itself: the helpers are always inlined, so this is the call site
+__attribute__((always_inline)) inline kstd::uintptr_t current_pc() {
+    kstd::uintptr_t pc;
+    asm volatile("adr %0, ." : "=r"(pc));
+    return pc;
+}
+
+// Mask IRQs; returns the previous DAIF for irq_restore
+__attribute__((always_inline)) inline kstd::uint64_t irq_save() {
+    kstd::uint64_t daif;
+    asm volatile("mrs %0, daif" : "=r"(daif));
+    asm volatile("msr daifset, #2" ::: "memory");
+    if (Trace::irqsoff_tracing && !(daif & DAIF_I)) Trace::irqsoff_begin(current_pc());
+    return daif;
+}
+
+__attribute__((always_inline)) inline void irq_restore(kstd::uint64_t daif) {
+    if (Trace::irqsoff_tracing && !(daif & DAIF_I)) Trace::irqsoff_end(current_pc());
+    asm volatile("msr daif, %0" : : "r"(daif) : "memory");
+}
+
+__attribute__((always_inline)) inline void irq_disable() {
+    kstd::uint64_t daif;
+    asm volatile("mrs %0, daif" : "=r"(daif));
+    asm volatile("msr daifset, #2" ::: "memory");
+    if (Trace::irqsoff_tracing && !(daif & DAIF_I)) Trace::irqsoff_begin(current_pc());
+}
+
+__attribute__((always_inline)) inline void irq_enable() {
+    if (Trace::irqsoff_tracing) Trace::irqsoff_end(current_pc()); // No-op outside a section
+    asm volatile("msr daifclr, #2" ::: "memory");
+}
+
+} // namespace Kernel
+
+#endif // KERNEL_IRQFLAGS_H
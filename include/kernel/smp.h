@@ -0,0 +1,49 @@
+#ifndef KERNEL_SMP_H
+#define KERNEL_SMP_H
+
+#include <kstd/cstdint.h>
+
+namespace Kernel {
+
+// Cores of the BCM2711's Cortex-A72 cluster. CPU 0 boots the kernel; the others stay parked
+// in the firmware's spin table until start_secondary_cpus() releases them. A secondary core
+// takes interrupts routed to it and otherwise idles: the shell, the work queue and everything
+// else that runs in thread context stay on CPU 0.
+constexpr unsigned int MAX_CPUS = 4;
+
+// Index of the calling CPU: MPIDR_EL1.Aff0, 0 to MAX_CPUS - 1 within the cluster
+__attribute__((always_inline)) inline unsigned int cpu_id() {
+    kstd::uint64_t mpidr;
+    asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return static_cast<unsigned int>(mpidr & 0xFF);
+}
+
+// Bit n set once CPU n has its exception vectors and GIC CPU interface up and takes IRQs
+kstd::uint32_t online_cpus();
+
+inline unsigned int num_online_cpus() {
+    return static_cast<unsigned int>(__builtin_popcount(online_cpus()));
+}
+
+// Release the parked secondary cores and wait for each to come online. Idempotent.
+// Returns online_cpus() afterwards.
+kstd::uint32_t start_secondary_cpus();
+
+// Cross-core function calls (kernel/irq/ipi.cpp). fn(arg) runs on 'cpu' in IRQ context, from
+// the handler of an SGI the caller sends it, so it must not block; calls from one CPU to
+// another run in the order they were made. A call to the calling CPU runs right away with
+// IRQs masked.
+//
+// With wait, returns once fn has returned on the target: only from thread context with IRQs
+// unmasked, since two CPUs calling each other would wait forever. From a handler or with IRQs
+// masked it fails instead (except for a call to the calling CPU). Without
+// wait, fails instead of waiting when the target still has IPI_CALL_QUEUE_SIZE calls from
+// this CPU queued. Fails for offline CPUs.
+using SmpCallFunction = void (*)(void* arg);
+constexpr unsigned int IPI_CALL_QUEUE_SIZE = 16;
+
+bool smp_call_function(unsigned int cpu, SmpCallFunction fn, void* arg, bool wait);
+
+} // namespace Kernel
+
+#endif // KERNEL_SMP_H
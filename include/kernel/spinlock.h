@@ -0,0 +1,64 @@
+#ifndef KERNEL_SPINLOCK_H
+#define KERNEL_SPINLOCK_H
+
+#include <kstd/cstdint.h>
+#include <kernel/irqflags.h> // For irq_save/irq_restore
+
+namespace Kernel {
+
+// Test-and-set lock for data shared between cores. Exclusives (LDAXR/STXR) only work on
+// Normal cacheable memory, so a lock must not be taken before the MMU is on.
+//
+// State also touched from IRQ handlers must be locked with lock_irqsave: a handler on the
+// same core spinning on a lock its own thread holds never gets it.
+class Spinlock {
+public:
+    void lock() {
+        kstd::uint32_t busy;
+        asm volatile(
+            "   sevl\n"
+            "1: wfe\n"                  // First round falls through (SEVL); later ones wait for the unlock
+            "   ldaxr %w0, [%1]\n"      // Exclusive monitor armed: the STLR in unlock() wakes the WFE
+            "   cbnz %w0, 1b\n"
+            "   stxr %w0, %w2, [%1]\n"
+            "   cbnz %w0, 1b\n"
+            : "=&r"(busy)
+            : "r"(&locked), "r"(1u)
+            : "memory");
+    }
+
+    bool try_lock() {
+        kstd::uint32_t busy;
+        asm volatile(
+            "   ldaxr %w0, [%1]\n"
+            "   cbnz %w0, 1f\n"
+            "   stxr %w0, %w2, [%1]\n"
+            "1:\n"
+            : "=&r"(busy)
+            : "r"(&locked), "r"(1u)
+            : "memory");
+        return busy == 0;
+    }
+
+    void unlock() {
+        asm volatile("stlr wzr, [%0]" : : "r"(&locked) : "memory");
+    }
+
+    kstd::uint64_t lock_irqsave() {
+        kstd::uint64_t daif = irq_save();
+        lock();
+        return daif;
+    }
+
+    void unlock_irqrestore(kstd::uint64_t daif) {
+        unlock();
+        irq_restore(daif);
+    }
+
+private:
+    volatile kstd::uint32_t locked = 0;
+};
+
+} // namespace Kernel
+
+#endif // KERNEL_SPINLOCK_H
@@ -11,7 +11,7 @@ Console& global_console() {
     return main_console_instance;
 }
 
-Console::Console() : uart_device(nullptr), initialized(false) {
+Console::Console() : uart_device(nullptr), initialized(false), idle_hook(nullptr) {
     // Constructor: UART device will be acquired during init()
 }
 
@@ -54,6 +54,12 @@ void Console::println(const char* str) {
 
 char Console::get_char() {
     if (!initialized || !uart_device) return 0; // Or some error indicator
+    // Use the wait for background work (deferred initcalls) until there is none left
+    while (idle_hook && !uart_device->has_data()) {
+        if (!idle_hook()) {
+            idle_hook = nullptr;
+        }
+    }
     return uart_device->read_char();
 }
 
@@ -26,8 +26,13 @@ public:
     void println(const char* str);
 
     // Read a single character (blocking)
+    // While no input is pending, the idle hook (if set) is called repeatedly; once it returns
+    // false it is dropped and get_char waits on the UART alone.
     char get_char();
 
+    using IdleHook = bool (*)();
+    void set_idle_hook(IdleHook hook) { idle_hook = hook; }
+
     // Read a line of input from the console until newline or buffer full.
     // Stores the null-terminated string in 'buffer'.
     // Returns the number of characters read (excluding null terminator).
@@ -45,6 +50,7 @@ public:
 private:
     Arch::RaspberryPi::UART* uart_device; // Pointer to the UART device
     bool initialized;
+    IdleHook idle_hook;
 };
 
 // Global accessor for the main kernel console
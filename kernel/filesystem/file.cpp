@@ -104,49 +104,10 @@ ErrorCode File::write(const void* buffer, kstd::size_t count, kstd::size_t& byte
         if (count == 0) return ErrorCode::FILE_TOO_LARGE; // Cannot write even 1 byte
     }
 
-    // Check if we need to allocate more blocks
-    kstd::size_t new_required_size = current_seek_pos + count;
-    kstd::size_t required_blocks = (new_required_size + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
-    if (required_blocks == 0 && new_required_size > 0) required_blocks = 1; // Min 1 block for non-empty file
-
-    if (required_blocks > meta->num_blocks) {
-        if (required_blocks > MAX_BLOCKS_PER_FILE) {
-            return ErrorCode::FILE_TOO_LARGE; // Exceeds max blocks per file limit
-        }
-        // Need to reallocate. This simple FS uses contiguous blocks.
-        // A real FS would be more complex (extend, or allocate new, copy, free old).
-        // For now, if extending beyond current contiguous allocation, it's tricky.
-        // Let's assume Filesystem handles reallocation if needed, or this write implies it.
-        // The current Filesystem::allocate_contiguous_blocks is for new files or full rewrites.
-        // This simple File::write will assume blocks are pre-allocated by Filesystem
-        // up to MAX_BLOCKS_PER_FILE if opened for write, or that write is within current allocation.
-        // A more robust write would ask Filesystem to ensure_capacity(new_required_size).
-
-        // For this version, let's assume if we write past allocated blocks but within MAX_BLOCKS_PER_FILE,
-        // the Filesystem should have handled it during open or a prior write that set the size.
-        // This simplified write will just write into the currently allocated blocks.
-        // If current_seek_pos + count > meta->num_blocks * BLOCK_SIZE_BYTES, it's an issue.
-        if (required_blocks > meta->num_blocks) {
-            // This means we need more blocks than currently allocated.
-            // This simple File class cannot reallocate itself. The Filesystem should manage this.
-            // For now, this is a limitation. A write that extends the file might fail
-            // if it requires more blocks than initially allocated by a `create` or previous `write`
-            // that set the file size and block count.
-            // A robust solution:
-            // FS::ErrorCode e = filesystem.resize_file_blocks(meta, required_blocks); if (e != OK) return e;
-            // For now, we'll cap the write to existing allocated blocks or MAX_FILE_SIZE_BYTES.
-             if (current_seek_pos + count > meta->num_blocks * BLOCK_SIZE_BYTES && meta->num_blocks < MAX_BLOCKS_PER_FILE) {
-                // This indicates an internal FS logic gap if we reach here with more to write than space.
-                // Let's assume for now that the filesystem has pre-allocated up to MAX_BLOCKS_PER_FILE
-                // if the file is writable and empty, or that write() is used to overwrite.
-                // The provided C code's fs_write_file re-allocates entirely.
-                // Our File class is lower level.
-                // For now, let's just return an error if we try to write past allocated block space.
-                 return ErrorCode::DISK_FULL; // Simplified: means "no more allocated blocks for this file"
-             }
-        }
-    }
-
+    // Grow the allocation if the write extends past the blocks the file owns.
+    // Filesystem::ensure_capacity extends in place or relocates the file's contiguous run.
+    ErrorCode cap = filesystem.ensure_capacity(meta, current_seek_pos + count);
+    if (cap != ErrorCode::OK) return cap;
 
     // Proceed with writing data
     kstd::uint32_t current_block_idx_in_file = current_seek_pos / BLOCK_SIZE_BYTES;
@@ -194,6 +155,13 @@ ErrorCode File::write(const void* buffer, kstd::size_t count, kstd::size_t& byte
     return ErrorCode::OK;
 }
 
+ErrorCode File::reserve(kstd::size_t size_bytes) {
+    if (!is_valid || !meta) return ErrorCode::INVALID_OPERATION;
+    if (!has_write_access(current_mode)) return ErrorCode::INVALID_OPERATION;
+    if (size_bytes > MAX_FILE_SIZE_BYTES) return ErrorCode::FILE_TOO_LARGE;
+    return filesystem.ensure_capacity(meta, size_bytes);
+}
+
 ErrorCode File::seek(kstd::size_t offset) {
     if (!is_valid || !meta) return ErrorCode::INVALID_OPERATION;
 
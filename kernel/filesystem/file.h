@@ -35,6 +35,10 @@ public:
     // Returns ErrorCode::OK on success.
     ErrorCode write(const void* buffer, kstd::size_t count, kstd::size_t& bytes_written);
 
+    // Pre-allocate room for size_bytes of content so later writes do not have to move the file.
+    // Does not change the file size. Requires write access.
+    ErrorCode reserve(kstd::size_t size_bytes);
+
     // Seek to a position in the file
     // offset: Offset to seek to.
     // whence: Starting point for offset (e.g., SEEK_SET, SEEK_CUR, SEEK_END - similar to stdio)
@@ -3,15 +3,16 @@
 #include <kstd/algorithm.h> // For kstd::min
 #include <kernel/console.h> // For kprintf (used in list_files_to_console)
 #include <lib/printf/printf.h> // For Kernel::kprintf specifically
+#include <arch/arm/peripherals/dma.h> // For dma_memcpy (relocating large files)
+#include <arch/arm/core/cache.h>      // For Cache::zero_range (clearing the RAM disk)
+#include <kernel/init/initcall.h>     // For KERNEL_INITCALL
+#include <kernel/kexec/kexec.h>       // For Kexec::preserved_region (where the disk lives)
+#include <kernel/mm/vmalloc.h>        // For vmalloc (the disk when there is no preserved region)
+#include <lib/crc32/crc32.h>          // For the superblock's metadata CRC
+#include <kernel/panic.h>             // For Kernel::panic
 
 namespace Kernel {
 
-// Define static members
-unsigned char Filesystem::ram_disk_data[FS::RAM_DISK_SIZE_BYTES];
-// FileMetadata Filesystem::file_table[FS::MAX_FILES]; // Already a member
-// unsigned char Filesystem::block_bitmap[FS::BLOCK_BITMAP_SIZE_BYTES]; // Already a member
-
-
 // Global filesystem instance
 static Filesystem g_filesystem_instance;
 
@@ -19,33 +20,101 @@ Filesystem& global_filesystem() {
     return g_filesystem_instance;
 }
 
+// Deferred: mounting (or, after a cold boot, zeroing) the RAM disk waits until the shell is idle.
+// Every entry point initializes on first use if a command gets there first.
+static void filesystem_initcall() {
+    g_filesystem_instance.init();
+}
+KERNEL_INITCALL(INITCALL_LEVEL_DEFERRED, "filesystem", filesystem_initcall);
+
 
-Filesystem::Filesystem() : initialized(false) {
-    // Initialize arrays to zero. This is important as they are static.
-    // kstd::kmemset might not be usable if kstd itself relies on FS or other things not yet up.
-    // However, for static/global objects, they should be zero-initialized by C++ runtime (.bss).
-    // Explicitly zeroing here is safer if that's not guaranteed in our freestanding env.
-    // For now, assume .bss is cleared by startup code. If issues arise, explicitly zero here.
+Filesystem::Filesystem()
+    : superblock(nullptr), file_table(nullptr), block_bitmap(nullptr), ram_disk_data(nullptr), initialized(false) {
 }
 
 void Filesystem::init() {
     if (initialized) return;
 
-    Kernel::kprintf("Initializing In-Memory Filesystem...\n");
-    // Clear RAM disk data
-    kstd::kmemset(ram_disk_data, 0, FS::RAM_DISK_SIZE_BYTES);
+    Kexec::PreservedRegion region = Kexec::preserved_region();
+    void* disk = region.base;
+    bool preserved = region.size >= FS::DISK_TOTAL_SIZE;
+    if (!preserved) {
+        // Kexec::init gives the region up when the DTB lies in it: a plain disk instead
+        disk = Mem::vmalloc(FS::DISK_TOTAL_SIZE);
+        if (!disk) {
+            Kernel::panic("Filesystem: No memory for the RAM disk.");
+        }
+        Kernel::kprintf("Filesystem: No preserved region, the RAM disk will not survive a warm restart.\n");
+    }
+    FS::DiskHeader* header = static_cast<FS::DiskHeader*>(disk);
+    superblock = &header->superblock;
+    file_table = header->file_table;
+    block_bitmap = header->block_bitmap;
+    ram_disk_data = static_cast<unsigned char*>(disk) + FS::DISK_DATA_OFFSET;
+
+    if (preserved && region.kept && superblock_valid()) {
+        superblock->generation++;
+        unsigned int files = 0;
+        for (kstd::size_t i = 0; i < FS::MAX_FILES; ++i) {
+            if (file_table[i].in_use) ++files;
+        }
+        Kernel::kprintf("Filesystem remounted: %u files, generation %llu.\n", files, superblock->generation);
+    } else {
+        Kernel::kprintf("Initializing In-Memory Filesystem...\n");
+        format();
+        Kernel::kprintf("Filesystem initialized: %u KB RAM Disk, %u blocks of %u bytes.\n",
+               FS::RAM_DISK_SIZE_BYTES / 1024, FS::MAX_BLOCKS, FS::BLOCK_SIZE_BYTES);
+    }
+    // The CRC is only current after sync(): a restart without it must not remount
+    superblock->metadata_crc = ~metadata_crc();
+    initialized = true;
+}
+
+void Filesystem::format() {
+    // Only pass over the block data: with the MMU on this is DC ZVA
+    Arch::Arm::Cache::zero_range(ram_disk_data, FS::RAM_DISK_SIZE_BYTES);
 
     // Clear file metadata table (FileMetadata constructor handles individual clearing)
-    for (int i = 0; i < FS::MAX_FILES; ++i) {
+    for (kstd::size_t i = 0; i < FS::MAX_FILES; ++i) {
         file_table[i] = FS::FileMetadata(); // Re-initialize
     }
 
     // Clear block bitmap (all blocks free)
     kstd::kmemset(block_bitmap, 0, FS::BLOCK_BITMAP_SIZE_BYTES);
 
-    initialized = true;
-    Kernel::kprintf("Filesystem initialized: %u KB RAM Disk, %u blocks of %u bytes.\n",
-           FS::RAM_DISK_SIZE_BYTES / 1024, FS::MAX_BLOCKS, FS::BLOCK_SIZE_BYTES);
+    superblock->magic = FS::SUPERBLOCK_MAGIC;
+    superblock->version = FS::SUPERBLOCK_VERSION;
+    superblock->block_size = FS::BLOCK_SIZE_BYTES;
+    superblock->max_blocks = FS::MAX_BLOCKS;
+    superblock->max_files = FS::MAX_FILES;
+    superblock->metadata_size = sizeof(FS::FileMetadata);
+    superblock->reserved = 0;
+    superblock->generation = 0;
+}
+
+kstd::uint32_t Filesystem::metadata_crc() const {
+    kstd::uint32_t crc = CRC32::update(0, file_table, sizeof(FS::FileMetadata) * FS::MAX_FILES);
+    return CRC32::update(crc, block_bitmap, FS::BLOCK_BITMAP_SIZE_BYTES);
+}
+
+bool Filesystem::superblock_valid() const {
+    return superblock->magic == FS::SUPERBLOCK_MAGIC &&
+           superblock->version == FS::SUPERBLOCK_VERSION &&
+           superblock->block_size == FS::BLOCK_SIZE_BYTES &&
+           superblock->max_blocks == FS::MAX_BLOCKS &&
+           superblock->max_files == FS::MAX_FILES &&
+           superblock->metadata_size == sizeof(FS::FileMetadata) &&
+           superblock->metadata_crc == metadata_crc();
+}
+
+void Filesystem::sync() {
+    init(); // A disk this boot was told to discard must not come back from an older sync
+    superblock->metadata_crc = metadata_crc();
+}
+
+kstd::uint64_t Filesystem::generation() const {
+    const_cast<Filesystem*>(this)->init();
+    return superblock->generation;
 }
 
 FS::FileMetadata* Filesystem::find_metadata(const char* filename) {
@@ -182,7 +251,7 @@ FS::ErrorCode Filesystem::open_file(const char* filename, FS::OpenMode mode, FS:
 
 
 FS::ErrorCode Filesystem::delete_file(const char* filename) {
-    if (!initialized) return FS::ErrorCode::INVALID_OPERATION;
+    if (!initialized) init();
     FS::FileMetadata* meta = find_metadata(filename);
     if (!meta) {
         return FS::ErrorCode::NOT_FOUND;
@@ -203,10 +272,7 @@ FS::ErrorCode Filesystem::delete_file(const char* filename) {
 }
 
 void Filesystem::list_files_to_console() const {
-    if (!initialized) {
-        Kernel::kprintf("Filesystem not initialized.\n");
-        return;
-    }
+    const_cast<Filesystem*>(this)->init(); // The file table only exists once the disk is mounted
     Kernel::kprintf("--- Filesystem Contents ---\n");
     Kernel::kprintf("Name                             Size (Bytes) Blocks StartBlk\n");
     Kernel::kprintf("-------------------------------- ------------ ------ --------\n");
@@ -229,12 +295,12 @@ void Filesystem::list_files_to_console() const {
 }
 
 bool Filesystem::file_exists(const char* filename) const {
-    if (!initialized) return false;
+    const_cast<Filesystem*>(this)->init();
     return find_metadata(filename) != nullptr;
 }
 
 const FS::FileMetadata* Filesystem::get_file_metadata(const char* filename) const {
-    if (!initialized) return nullptr;
+    const_cast<Filesystem*>(this)->init();
     return find_metadata(filename);
 }
 
@@ -314,6 +380,53 @@ void Filesystem::free_contiguous_blocks(kstd::uint32_t start_block_index, kstd::
     }
 }
 
+FS::ErrorCode Filesystem::ensure_capacity(FS::FileMetadata* meta, kstd::size_t size_bytes) {
+    if (!meta || !meta->in_use) return FS::ErrorCode::INVALID_OPERATION;
+
+    kstd::size_t required_blocks = (size_bytes + FS::BLOCK_SIZE_BYTES - 1) / FS::BLOCK_SIZE_BYTES;
+    if (required_blocks <= meta->num_blocks) return FS::ErrorCode::OK;
+    if (required_blocks > FS::MAX_BLOCKS_PER_FILE) return FS::ErrorCode::FILE_TOO_LARGE;
+
+    // 1. Try to grow in place: the blocks right after the current run must be free.
+    if (meta->num_blocks > 0 && meta->start_block + required_blocks <= FS::MAX_BLOCKS) {
+        bool tail_free = true;
+        for (kstd::size_t i = meta->num_blocks; i < required_blocks; ++i) {
+            if (!is_block_free(meta->start_block + i)) {
+                tail_free = false;
+                break;
+            }
+        }
+        if (tail_free) {
+            for (kstd::size_t i = meta->num_blocks; i < required_blocks; ++i) {
+                mark_block_status(meta->start_block + i, true /* used */);
+            }
+            meta->num_blocks = required_blocks;
+            return FS::ErrorCode::OK;
+        }
+    }
+
+    // 2. Move to a new run. Free the old run only after the copy, so a failed
+    //    allocation leaves the file untouched.
+    kstd::uint32_t new_start = 0;
+    FS::ErrorCode res = allocate_contiguous_blocks(required_blocks, new_start);
+    if (res != FS::ErrorCode::OK) return res;
+
+    if (meta->num_blocks > 0) {
+        // Large moves go to a DMA engine; dma_memcpy falls back to the CPU for small ones.
+        int dma = Arch::RaspberryPi::dma_memcpy(ram_disk_data + new_start * FS::BLOCK_SIZE_BYTES,
+                                                ram_disk_data + meta->start_block * FS::BLOCK_SIZE_BYTES,
+                                                meta->num_blocks * FS::BLOCK_SIZE_BYTES);
+        if (!Arch::RaspberryPi::dma_wait(dma)) {
+            free_contiguous_blocks(new_start, required_blocks);
+            return FS::ErrorCode::IO_ERROR;
+        }
+        free_contiguous_blocks(meta->start_block, meta->num_blocks);
+    }
+    meta->start_block = new_start;
+    meta->num_blocks = required_blocks;
+    return FS::ErrorCode::OK;
+}
+
 
 // Filesystem instance and global accessor are defined at the top of this file.
 // Ensure kernel_main.cpp calls global_filesystem().init();
@@ -19,9 +19,18 @@ public:
     Filesystem();
     ~Filesystem() = default;
 
-    // Initialize the filesystem (e.g., clear RAM disk, setup metadata structures)
+    // Mount the RAM disk in the preserved region: remount it if the previous kernel handed it
+    // over with 'kexec -k' and its superblock is valid, otherwise format it. Without a preserved
+    // region (Kexec gives it up when the DTB lies in it) a fresh disk from vmalloc is formatted.
     void init();
 
+    // Checksum the metadata into the superblock so the next kernel can remount the disk.
+    // Called right before a warm restart; no-op before init().
+    void sync();
+
+    // Mounts since the disk was formatted (0 = formatted by this boot)
+    kstd::uint64_t generation() const;
+
     // Create a new file
     // filename: Name of the file to create.
     // type: Type of file (FileType::FILE or FileType::DIRECTORY).
@@ -84,17 +93,20 @@ public:
     // num_blocks: Number of blocks to free.
     void free_contiguous_blocks(kstd::uint32_t start_block_index, kstd::size_t num_blocks);
 
+    // Make sure a file has enough blocks allocated to hold size_bytes.
+    // Extends the allocation in place if the following blocks are free, otherwise moves the
+    // file's data to a new contiguous run. Existing content and size_bytes are preserved.
+    // Returns ErrorCode::OK on success, DISK_FULL/FILE_TOO_LARGE if no run is large enough.
+    FS::ErrorCode ensure_capacity(FS::FileMetadata* meta, kstd::size_t size_bytes);
 
-private:
-    // RAM disk data area
-    static unsigned char ram_disk_data[FS::RAM_DISK_SIZE_BYTES]; // Static to be in .bss or .data
-
-    // File metadata table
-    FS::FileMetadata file_table[FS::MAX_FILES];
 
-    // Bitmap for free block management
-    // Each bit represents a block. 0 = free, 1 = used.
-    unsigned char block_bitmap[FS::BLOCK_BITMAP_SIZE_BYTES];
+private:
+    // All of these point into the preserved region (FS::DiskHeader, then the block data), or
+    // into a vmalloc area laid out the same way when there is none
+    FS::Superblock* superblock;
+    FS::FileMetadata* file_table;
+    unsigned char* block_bitmap; // Each bit represents a block. 0 = free, 1 = used.
+    unsigned char* ram_disk_data;
 
     bool initialized;
 
@@ -110,6 +122,10 @@ private:
     // Find a free slot in the file_table for new file metadata
     int find_free_metadata_slot() const;
 
+    kstd::uint32_t metadata_crc() const;
+    bool superblock_valid() const;
+    void format();
+
     // Prevent copying/assignment
     Filesystem(const Filesystem&) = delete;
     Filesystem& operator=(const Filesystem&) = delete;
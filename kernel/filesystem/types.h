@@ -8,19 +8,20 @@ namespace Kernel {
 namespace FS {
 
 // Configuration for our simple RAM-disk filesystem
-constexpr kstd::size_t RAM_DISK_SIZE_BYTES = 1024 * 256; // 256 KB for the RAM disk
+constexpr kstd::size_t RAM_DISK_SIZE_BYTES = 1024 * 1024 * 8; // 8 MB for the RAM disk (room for bulk UART uploads)
 constexpr kstd::size_t BLOCK_SIZE_BYTES    = 512;        // Each block is 512 bytes
-constexpr kstd::size_t MAX_BLOCKS          = RAM_DISK_SIZE_BYTES / BLOCK_SIZE_BYTES; // Total blocks (512)
+constexpr kstd::size_t MAX_BLOCKS          = RAM_DISK_SIZE_BYTES / BLOCK_SIZE_BYTES; // Total blocks (16384)
 
 // Bitmap for block allocation: 1 bit per block.
-constexpr kstd::size_t BLOCK_BITMAP_SIZE_BYTES = (MAX_BLOCKS + 7) / 8; // Rounded up to nearest byte (512/8 = 64 bytes)
+constexpr kstd::size_t BLOCK_BITMAP_SIZE_BYTES = (MAX_BLOCKS + 7) / 8; // Rounded up to nearest byte (16384/8 = 2 KB)
 
 constexpr kstd::size_t MAX_FILENAME_LENGTH = 32; // Including null terminator
 constexpr kstd::size_t MAX_FILES           = 64; // Maximum number of files we can track
 
 // Max data a single file can hold. Using contiguous blocks for simplicity.
 // This could be made more flexible with linked blocks later.
-constexpr kstd::size_t MAX_BLOCKS_PER_FILE = 8; // A file can be up to 8 * 512 = 4KB
+// A file may span the whole disk; Filesystem::ensure_capacity relocates it when it grows.
+constexpr kstd::size_t MAX_BLOCKS_PER_FILE = MAX_BLOCKS;
 constexpr kstd::size_t MAX_FILE_SIZE_BYTES = MAX_BLOCKS_PER_FILE * BLOCK_SIZE_BYTES;
 
 enum class FileType : kstd::uint8_t {
@@ -60,6 +61,35 @@ struct FileMetadata {
 };
 
 
+// On-disk header of the RAM disk, at the start of the preserved region (see kernel/kexec).
+// The block data follows at the next page boundary. A kernel started by 'kexec -k' remounts
+// the disk if the superblock matches its own geometry and the metadata CRC checks out; anything
+// else is formatted. Only the metadata is checksummed: mount cost does not grow with the disk.
+constexpr kstd::uint32_t SUPERBLOCK_MAGIC = 0x4B534452; // "RDSK"
+constexpr kstd::uint32_t SUPERBLOCK_VERSION = 1;
+
+struct Superblock {
+    kstd::uint32_t magic;
+    kstd::uint32_t version;
+    kstd::uint32_t block_size;     // Geometry and layout this kernel was built with
+    kstd::uint32_t max_blocks;
+    kstd::uint32_t max_files;
+    kstd::uint32_t metadata_size;  // sizeof(FileMetadata)
+    kstd::uint32_t metadata_crc;   // CRC32 over file_table and block_bitmap, written by sync()
+    kstd::uint32_t reserved;
+    kstd::uint64_t generation;     // Mounts since the disk was formatted
+};
+
+struct DiskHeader {
+    Superblock superblock;
+    FileMetadata file_table[MAX_FILES];
+    unsigned char block_bitmap[BLOCK_BITMAP_SIZE_BYTES]; // 1 bit per block, 1 = used
+};
+
+constexpr kstd::size_t DISK_DATA_OFFSET = (sizeof(DiskHeader) + 4095) & ~static_cast<kstd::size_t>(4095);
+constexpr kstd::size_t DISK_TOTAL_SIZE  = DISK_DATA_OFFSET + RAM_DISK_SIZE_BYTES;
+
+
 // Modes for opening a file (simplified)
 enum class OpenMode {
     READ = 1,
@@ -0,0 +1,68 @@
+#include "initcall.h"
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter / get_timer_frequency_hz
+#include <kernel/trace/boottime.h>      // For Trace::boot_phase (one phase per initcall)
+#include <lib/printf/printf.h>          // For Kernel::kprintf
+
+// Linker script: all .initcall.* sections, sorted by level
+extern "C" Kernel::Init::Initcall INITCALL_START[];
+extern "C" Kernel::Init::Initcall INITCALL_END[];
+
+namespace Kernel {
+namespace Init {
+
+using Arch::RaspberryPi::GenericTimer;
+
+static void run(Initcall& call) {
+    call.state = InitState::RUNNING;
+    call.start = GenericTimer::get_counter();
+    call.fn();
+    call.duration = GenericTimer::get_counter() - call.start;
+    call.state = InitState::DONE;
+}
+
+void run_level(kstd::uint8_t level) {
+    for (Initcall* call = INITCALL_START; call < INITCALL_END; ++call) {
+        if (call->level == level && call->state == InitState::PENDING) {
+            Trace::boot_phase(call->name);
+            run(*call);
+        }
+    }
+}
+
+bool run_deferred_step() {
+    for (Initcall* call = INITCALL_START; call < INITCALL_END; ++call) {
+        if (call->level == LEVEL_DEFERRED && call->state == InitState::PENDING) {
+            run(*call);
+            return true;
+        }
+    }
+    return false;
+}
+
+kstd::size_t initcalls(Initcall** calls) {
+    if (calls) *calls = INITCALL_START;
+    return static_cast<kstd::size_t>(INITCALL_END - INITCALL_START);
+}
+
+void print_report() {
+    static const char* const level_names[] = { "?", "arch", "device", "subsys", "deferred" };
+    static const char* const state_names[] = { "pending", "running", "done" };
+    kstd::uint64_t freq = GenericTimer::get_timer_frequency_hz();
+    kstd::uint64_t origin = Trace::boot_start_ticks();
+
+    Kernel::kprintf("%-22s %-9s %-8s %12s %10s\n", "Initcall", "Level", "State", "Start (ms)", "Took (us)");
+    for (Initcall* call = INITCALL_START; call < INITCALL_END; ++call) {
+        const char* level = call->level <= LEVEL_DEFERRED ? level_names[call->level] : "?";
+        Kernel::kprintf("%-22s %-9s %-8s ", call->name, level, state_names[static_cast<int>(call->state)]);
+        if (call->state == InitState::DONE && freq) {
+            kstd::uint64_t start_us = (call->start - origin) * 1000000 / freq;
+            Kernel::kprintf("%8llu.%03llu %10llu\n", start_us / 1000, start_us % 1000,
+                            call->duration * 1000000 / freq);
+        } else {
+            Kernel::kprintf("%12s %10s\n", "-", "-");
+        }
+    }
+}
+
+} // namespace Init
+} // namespace Kernel
@@ -0,0 +1,72 @@
+#ifndef KERNEL_INIT_INITCALL_H
+#define KERNEL_INIT_INITCALL_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint8_t, kstd::uint64_t
+
+namespace Kernel {
+namespace Init {
+
+// Initcall registry. Subsystems register their init function next to its definition with
+// KERNEL_INITCALL; the entries land in .initcall.<level>.* sections, which the linker script
+// collects level by level between INITCALL_START and INITCALL_END.
+//
+// kernel_main still brings up the basics by hand (allocator, console, MMU, exceptions, page
+// allocator), then runs the levels in order. Deferred initcalls are not run at boot: they run
+// one at a time while the console waits for input, so the shell prompt comes first.
+// A subsystem that is used before its deferred initcall ran must initialize itself on first use
+// (as Filesystem does).
+
+// Levels. Within a level, initcalls run in link order (Makefile source order).
+#define INITCALL_LEVEL_ARCH     1 // Interrupt controller, clocks: needs MMU and exception vectors
+#define INITCALL_LEVEL_DEVICE   2 // Drivers on top of the GIC (timer, DMA)
+#define INITCALL_LEVEL_SUBSYS   3 // Kernel subsystems needed before the shell
+#define INITCALL_LEVEL_DEFERRED 4 // After the first prompt, in console idle time or on first use
+
+constexpr kstd::uint8_t LEVEL_ARCH     = INITCALL_LEVEL_ARCH;
+constexpr kstd::uint8_t LEVEL_DEVICE   = INITCALL_LEVEL_DEVICE;
+constexpr kstd::uint8_t LEVEL_SUBSYS   = INITCALL_LEVEL_SUBSYS;
+constexpr kstd::uint8_t LEVEL_DEFERRED = INITCALL_LEVEL_DEFERRED;
+
+enum class InitState : kstd::uint8_t {
+    PENDING,
+    RUNNING,
+    DONE,
+};
+
+struct Initcall {
+    void (*fn)();
+    const char* name;
+    kstd::uint8_t level;
+    volatile InitState state;
+    kstd::uint64_t start;    // CNTPCT_EL0 when it started (0 if not run yet)
+    kstd::uint64_t duration; // Ticks
+};
+
+// Run every pending initcall of 'level', in order, as its own boot phase (see 'boottime').
+void run_level(kstd::uint8_t level);
+
+// Run the next pending deferred initcall. Returns false once there is nothing left.
+// Installed as the console idle hook by kernel_main.
+bool run_deferred_step();
+
+// All registered initcalls, in run order. Returns the number of entries.
+kstd::size_t initcalls(Initcall** calls);
+
+// Table of initcalls with level, state, start and duration in milliseconds
+void print_report();
+
+} // namespace Init
+} // namespace Kernel
+
+#define INITCALL_STRINGIFY_(x) #x
+#define INITCALL_STRINGIFY(x) INITCALL_STRINGIFY_(x)
+
+// Register 'fn' (void fn()) under 'name' at 'level' (one of the INITCALL_LEVEL_* macros).
+// Defines Kernel::Init::Initcall initcall_<fn>.
+#define KERNEL_INITCALL(level, name, fn)                                                        \
+    Kernel::Init::Initcall initcall_##fn                                                        \
+        __attribute__((used, aligned(8), section(".initcall." INITCALL_STRINGIFY(level) "." #fn))) = \
+        { fn, name, level, Kernel::Init::InitState::PENDING, 0, 0 }
+
+#endif // KERNEL_INIT_INITCALL_H
@@ -0,0 +1,127 @@
+#include "balance.h"
+#include <kernel/interrupt.h>           // For get_interrupt_controller, MAX_IRQS
+#include <kernel/smp.h>                 // For online_cpus, start_secondary_cpus
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter / get_timer_frequency_hz
+
+namespace Kernel {
+namespace IrqBalance {
+
+using Arch::RaspberryPi::GenericTimer;
+
+// Shared IRQs that fired in one interval and get placed; any beyond that keep their routing
+constexpr unsigned int MAX_BALANCED_IRQS = 32;
+
+// Only used from thread context on CPU 0 (shell, idle loop)
+static bool balancing = false;
+static kstd::uint64_t last_pass = 0;
+static kstd::uint64_t last_count[MAX_IRQS][MAX_CPUS]; // Dispatch counts at the previous pass
+static kstd::uint32_t pinned[MAX_IRQS / 32];
+
+struct Source {
+    unsigned int irq;
+    kstd::uint64_t rate; // Dispatches during the interval, all CPUs
+};
+
+// Dispatches of irq_num on cpu since the previous pass
+static kstd::uint64_t take_delta(InterruptController* ic, unsigned int irq_num, unsigned int cpu) {
+    kstd::uint64_t count = ic->irq_count_cpu(irq_num, cpu);
+    kstd::uint64_t last = last_count[irq_num][cpu];
+    last_count[irq_num][cpu] = count;
+    return count >= last ? count - last : count; // Re-registered handlers start from 0
+}
+
+unsigned int rebalance() {
+    InterruptController* ic = get_interrupt_controller();
+    if (!ic) return 0;
+    last_pass = GenericTimer::get_counter();
+
+    kstd::uint32_t online = online_cpus();
+    kstd::uint64_t load[MAX_CPUS] = {};
+    Source sources[MAX_BALANCED_IRQS];
+    unsigned int count = 0;
+
+    for (unsigned int irq = 0; irq < MAX_IRQS; ++irq) {
+        if (!ic->has_handler(irq)) continue;
+        kstd::uint64_t delta[MAX_CPUS];
+        kstd::uint64_t total = 0;
+        for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+            delta[cpu] = take_delta(ic, irq, cpu);
+            total += delta[cpu];
+        }
+        if (total == 0) continue;
+        // Per-CPU IRQs, pinned ones and the overflow stay where they ran
+        if (irq < 32 || is_pinned(irq) || count == MAX_BALANCED_IRQS) {
+            for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) load[cpu] += delta[cpu];
+            continue;
+        }
+        sources[count++] = { irq, total };
+    }
+
+    // Busiest first (insertion sort, at most MAX_BALANCED_IRQS entries)
+    for (unsigned int i = 1; i < count; ++i) {
+        Source source = sources[i];
+        unsigned int j = i;
+        for (; j > 0 && sources[j - 1].rate < source.rate; --j) sources[j] = sources[j - 1];
+        sources[j] = source;
+    }
+
+    unsigned int moved = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        const Source& source = sources[i];
+        unsigned int best = 0;
+        for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+            if ((online & (1u << cpu)) && load[cpu] < load[best]) best = cpu;
+        }
+
+        kstd::uint32_t current = ic->affinity(source.irq);
+        unsigned int target = best;
+        if (current && !(current & (current - 1)) && (current & online)) {
+            unsigned int current_cpu = static_cast<unsigned int>(__builtin_ctz(current));
+            if (load[current_cpu] - load[best] < source.rate / 2) target = current_cpu;
+        }
+
+        load[target] += source.rate;
+        if (current != (1u << target) && ic->set_affinity(source.irq, 1u << target)) ++moved;
+    }
+    return moved;
+}
+
+void enable(bool on) {
+    balancing = on;
+    if (on) {
+        start_secondary_cpus();
+        rebalance(); // Counts since the previous pass (or boot) are the first observation
+    }
+}
+
+bool enabled() {
+    return balancing;
+}
+
+void poll() {
+    if (!balancing) return;
+    kstd::uint64_t interval = GenericTimer::get_timer_frequency_hz() / 1000 * INTERVAL_MS;
+    if (GenericTimer::get_counter() - last_pass >= interval) {
+        rebalance();
+    }
+}
+
+bool pin(unsigned int irq_num, kstd::uint32_t cpu_mask) {
+    if (irq_num >= MAX_IRQS) return false;
+    kstd::uint32_t bit = 1u << (irq_num % 32);
+    if (cpu_mask == 0) {
+        pinned[irq_num / 32] &= ~bit;
+        return true;
+    }
+    InterruptController* ic = get_interrupt_controller();
+    if (!ic || !ic->set_affinity(irq_num, cpu_mask)) return false;
+    pinned[irq_num / 32] |= bit;
+    return true;
+}
+
+bool is_pinned(unsigned int irq_num) {
+    return irq_num < MAX_IRQS && (pinned[irq_num / 32] & (1u << (irq_num % 32)));
+}
+
+} // namespace IrqBalance
+} // namespace Kernel
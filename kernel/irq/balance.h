@@ -0,0 +1,36 @@
+#ifndef KERNEL_IRQ_BALANCE_H
+#define KERNEL_IRQ_BALANCE_H
+
+#include <kstd/cstdint.h>
+
+namespace Kernel {
+namespace IrqBalance {
+
+// Interrupt load balancing. Every INTERVAL_MS the balancer looks at how often each shared IRQ
+// (SPI) fired on each CPU since the last pass and routes the busiest ones to the least loaded
+// online CPUs: busiest first, each to the CPU with the least load so far, where a CPU starts
+// with the per-CPU IRQs (timer, SGIs) it took itself. An IRQ stays where it is unless that
+// saves at least half its own rate, so similar loads do not make IRQs bounce between CPUs.
+// IRQs that did not fire and IRQs pinned with pin() are left alone.
+
+constexpr kstd::uint64_t INTERVAL_MS = 1000;
+
+// Turning balancing on brings up the secondary cores first (Kernel::start_secondary_cpus).
+void enable(bool on);
+bool enabled();
+
+// Called from the idle loop; a pass every INTERVAL_MS while enabled
+void poll();
+
+// One pass now, over the counts since the previous one. Returns the number of IRQs moved.
+unsigned int rebalance();
+
+// Route irq_num to cpu_mask (InterruptController::set_affinity) and exclude it from balancing.
+// A mask of 0 hands it back to the balancer.
+bool pin(unsigned int irq_num, kstd::uint32_t cpu_mask);
+bool is_pinned(unsigned int irq_num);
+
+} // namespace IrqBalance
+} // namespace Kernel
+
+#endif // KERNEL_IRQ_BALANCE_H
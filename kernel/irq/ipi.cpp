@@ -0,0 +1,101 @@
+#include "ipi.h"
+#include <kernel/smp.h>           // For smp_call_function, cpu_id, online_cpus
+#include <kernel/interrupt.h>     // For get_interrupt_controller, IRQ_PRIORITY_DEFAULT, in_irq
+#include <kernel/irqflags.h>      // For irq_save/irq_restore, DAIF_I
+#include <kernel/init/initcall.h> // For KERNEL_INITCALL
+
+namespace Kernel {
+namespace Ipi {
+
+static_assert((IPI_CALL_QUEUE_SIZE & (IPI_CALL_QUEUE_SIZE - 1)) == 0, "Queue indices wrap by masking");
+
+struct Call {
+    SmpCallFunction fn;
+    void* arg;
+    volatile bool* done; // Set by the target after fn returned; null for asynchronous calls
+};
+
+// Single producer (the calling CPU), single consumer (the target's SGI handler). head and
+// tail count forever and are on separate cache lines, each written by one core only.
+struct alignas(64) CallQueue {
+    Call slots[IPI_CALL_QUEUE_SIZE];
+    kstd::uint32_t head; // Next slot the caller fills
+    alignas(64) kstd::uint32_t tail; // Next slot the target runs
+};
+
+static CallQueue queues[MAX_CPUS][MAX_CPUS]; // [target][caller]
+static bool ready = false;
+
+static void call_ipi(unsigned int irq_num, void* context) {
+    (void)irq_num; (void)context;
+    // One SGI may stand for several calls: raised again while this handler drains, it stays
+    // pending and runs it once more, so nothing queued before the SGIR write is missed
+    unsigned int self = cpu_id();
+    for (unsigned int caller = 0; caller < MAX_CPUS; ++caller) {
+        CallQueue& queue = queues[self][caller];
+        kstd::uint32_t tail = queue.tail;
+        while (tail != __atomic_load_n(&queue.head, __ATOMIC_ACQUIRE)) {
+            Call call = queue.slots[tail % IPI_CALL_QUEUE_SIZE];
+            __atomic_store_n(&queue.tail, ++tail, __ATOMIC_RELEASE); // Slot free for the caller
+            call.fn(call.arg);
+            if (call.done) {
+                __atomic_store_n(call.done, true, __ATOMIC_RELEASE);
+                asm volatile("dsb ish; sev" ::: "memory"); // Wake the WFE in smp_call_function
+            }
+        }
+    }
+}
+
+static void ipi_init() {
+    InterruptController* ic = get_interrupt_controller();
+    if (!ic || !ic->register_handler(SGI_CALL, call_ipi, nullptr, IRQ_PRIORITY_DEFAULT)) return;
+    ic->enable_irq(SGI_CALL); // This CPU; the others enable it in init_cpu
+    ready = true;
+}
+KERNEL_INITCALL(INITCALL_LEVEL_SUBSYS, "ipi", ipi_init);
+
+} // namespace Ipi
+
+bool smp_call_function(unsigned int cpu, SmpCallFunction fn, void* arg, bool wait) {
+    using namespace Ipi;
+    if (!fn || cpu >= MAX_CPUS || !(online_cpus() & (1u << cpu))) return false;
+
+    kstd::uint64_t daif = irq_save();
+    unsigned int self = cpu_id();
+    if (cpu == self) {
+        fn(arg);
+        irq_restore(daif);
+        return true;
+    }
+    // Waiting with the SGI masked never ends if the target is waiting for this CPU as well
+    if (!ready || (wait && ((daif & DAIF_I) || in_irq()))) {
+        irq_restore(daif);
+        return false;
+    }
+
+    // IRQs stay masked while a slot is claimed and filled: a handler on this CPU calling the
+    // same target must not take the same slot. They are unmasked while waiting for room.
+    CallQueue& queue = queues[cpu][self];
+    while (queue.head - __atomic_load_n(&queue.tail, __ATOMIC_ACQUIRE) == IPI_CALL_QUEUE_SIZE) {
+        irq_restore(daif);
+        if (!wait) return false;
+        asm volatile("yield");
+        daif = irq_save();
+    }
+    volatile bool done = false;
+    Call& slot = queue.slots[queue.head % IPI_CALL_QUEUE_SIZE];
+    slot.fn = fn;
+    slot.arg = arg;
+    slot.done = wait ? &done : nullptr;
+    __atomic_store_n(&queue.head, queue.head + 1, __ATOMIC_RELEASE);
+    irq_restore(daif);
+
+    get_interrupt_controller()->send_sgi(SGI_CALL, 1u << cpu);
+    // The target's SEV after setting done also ends a WFE that starts after it
+    while (wait && !__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        asm volatile("wfe" ::: "memory");
+    }
+    return true;
+}
+
+} // namespace Kernel
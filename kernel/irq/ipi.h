@@ -0,0 +1,23 @@
+#ifndef KERNEL_IRQ_IPI_H
+#define KERNEL_IRQ_IPI_H
+
+namespace Kernel {
+namespace Ipi {
+
+// Inter-processor interrupts: GIC SGIs the kernel sends between its own cores. The handlers
+// are registered on CPU 0 at boot; secondary cores pick them up in InterruptController::init_cpu.
+//
+// SGI_CALL carries smp_call_function (kernel/smp.h). Each pair of CPUs has its own queue of
+// IPI_CALL_QUEUE_SIZE calls, written only by the calling CPU (with IRQs masked) and drained
+// only by the target's SGI handler, so neither side takes a lock: the indices are published
+// with release stores and read with acquire loads.
+
+enum Sgi : unsigned int {
+    SGI_CALL = 0,
+    NUM_SGIS,
+};
+
+} // namespace Ipi
+} // namespace Kernel
+
+#endif // KERNEL_IRQ_IPI_H
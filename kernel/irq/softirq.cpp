@@ -0,0 +1,78 @@
+#include "softirq.h"
+#include <kernel/irqflags.h> // For irq_save/irq_restore (traced critical sections)
+#include <kernel/smp.h>      // For MAX_CPUS, cpu_id
+
+namespace Kernel {
+namespace SoftIrq {
+
+struct Action {
+    Handler handler;
+    void* context;
+    kstd::uint64_t count[MAX_CPUS];
+};
+
+// Only touched by its own CPU, with IRQs masked
+struct CpuState {
+    volatile kstd::uint32_t pending;
+    bool running;
+};
+
+static Action actions[NUM_VECTORS];
+static CpuState cpu_state[MAX_CPUS];
+
+static_assert(NUM_VECTORS <= 32, "Pending vectors are one 32-bit mask");
+
+void open(Vector vector, Handler handler, void* context) {
+    if (vector >= NUM_VECTORS) return;
+    actions[vector].context = context;
+    actions[vector].handler = handler;
+}
+
+void raise(Vector vector) {
+    if (vector >= NUM_VECTORS) return;
+    // Read-modify-write: a preempting handler must not lose its bit
+    kstd::uint64_t daif = irq_save();
+    CpuState& cpu = cpu_state[cpu_id()];
+    cpu.pending = cpu.pending | (1u << vector);
+    irq_restore(daif);
+}
+
+void run_pending() {
+    kstd::uint64_t daif = irq_save();
+    unsigned int id = cpu_id();
+    CpuState& cpu = cpu_state[id];
+    if (cpu.running) {
+        irq_restore(daif);
+        return;
+    }
+    cpu.running = true;
+
+    for (unsigned int round = 0; cpu.pending && round < MAX_RESTARTS; ++round) {
+        kstd::uint32_t batch = cpu.pending;
+        cpu.pending = 0;
+        irq_enable();
+        while (batch) {
+            unsigned int vector = static_cast<unsigned int>(__builtin_ctz(batch));
+            batch &= batch - 1;
+            Action& action = actions[vector];
+            if (action.handler) {
+                action.count[id]++;
+                action.handler(action.context);
+            }
+        }
+        irq_disable();
+    }
+
+    cpu.running = false;
+    irq_restore(daif);
+}
+
+kstd::uint64_t run_count(Vector vector) {
+    if (vector >= NUM_VECTORS) return 0;
+    kstd::uint64_t total = 0;
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) total += actions[vector].count[cpu];
+    return total;
+}
+
+} // namespace SoftIrq
+} // namespace Kernel
@@ -0,0 +1,46 @@
+#ifndef KERNEL_IRQ_SOFTIRQ_H
+#define KERNEL_IRQ_SOFTIRQ_H
+
+#include <kstd/cstdint.h> // For kstd::uint64_t
+
+namespace Kernel {
+namespace SoftIrq {
+
+// Softirqs: the second half of an interrupt handler. A hard-IRQ handler does only what cannot
+// wait (acknowledge the device, re-arm it, grab its data) and raises its vector; the vector's
+// handler runs when the outermost IRQ entry has dispatched everything and sent every EOI, with
+// IRQs unmasked, before returning to the interrupted code. Any hardware IRQ may preempt it.
+//
+// Softirq handlers must not wait for input or print at length: such work goes to a work queue
+// (workqueue.h), which runs in thread context. Pending vectors are per CPU: a vector runs on
+// the CPU that raised it, so a handler can run on several CPUs at once.
+
+enum Vector : unsigned int {
+    TIMER,       // Generic timer tick (GenericTimer's user handler)
+    NUM_VECTORS,
+};
+
+using Handler = void (*)(void* context);
+
+// Install the handler for 'vector'. Call before the first raise().
+void open(Vector vector, Handler handler, void* context);
+
+// Mark 'vector' pending on this CPU. Safe from any context; raising it again before it ran
+// is a no-op.
+void raise(Vector vector);
+
+// Run pending vectors with IRQs unmasked; returns with DAIF as it was on entry. Called by
+// c_irq_handler at the outermost IRQ level, and from the idle loop for anything left over
+// after MAX_RESTARTS rounds. Does nothing if softirqs are already running further down the stack.
+void run_pending();
+
+// Rounds of raised-while-running vectors run_pending processes before leaving the rest to
+// the idle loop, so an IRQ storm cannot starve thread context.
+constexpr unsigned int MAX_RESTARTS = 8;
+
+kstd::uint64_t run_count(Vector vector); // On all CPUs
+
+} // namespace SoftIrq
+} // namespace Kernel
+
+#endif // KERNEL_IRQ_SOFTIRQ_H
@@ -0,0 +1,50 @@
+#include "workqueue.h"
+#include <kernel/spinlock.h> // For Spinlock (items are queued from any core)
+
+namespace Kernel {
+namespace Work {
+
+// FIFO of queued items. Only touched with queue_lock held.
+static WorkItem* head = nullptr;
+static WorkItem* tail = nullptr;
+static Spinlock queue_lock;
+
+bool schedule(WorkItem& item) {
+    kstd::uint64_t daif = queue_lock.lock_irqsave();
+    bool queued = !item.queued;
+    if (queued) {
+        item.queued = true;
+        item.next = nullptr;
+        if (tail) {
+            tail->next = &item;
+        } else {
+            head = &item;
+        }
+        tail = &item;
+    }
+    queue_lock.unlock_irqrestore(daif);
+    return queued;
+}
+
+kstd::size_t run_pending() {
+    // Take the current list in one go: items queued while these run wait for the next call
+    kstd::uint64_t daif = queue_lock.lock_irqsave();
+    WorkItem* item = head;
+    head = tail = nullptr;
+    queue_lock.unlock_irqrestore(daif);
+
+    kstd::size_t count = 0;
+    while (item) {
+        WorkItem* next = item->next;
+        // Release: next is read before another core's schedule() can see the item free and
+        // relink it. Cleared before running: an event during fn queues it again.
+        __atomic_store_n(&item->queued, false, __ATOMIC_RELEASE);
+        item->fn(item->context);
+        item = next;
+        ++count;
+    }
+    return count;
+}
+
+} // namespace Work
+} // namespace Kernel
@@ -0,0 +1,38 @@
+#ifndef KERNEL_IRQ_WORKQUEUE_H
+#define KERNEL_IRQ_WORKQUEUE_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+
+namespace Kernel {
+namespace Work {
+
+// Work queue: deferred work in thread context. Interrupt handlers and softirqs queue a
+// WorkItem; the kernel's idle loop (the console waiting for input) runs queued items in
+// order with IRQs enabled. Items may print, allocate and take as long as they need, but
+// run only once the current shell command has returned to the prompt.
+//
+// Items are caller-owned and intrusive (no allocation in IRQ context); an item that is
+// already queued is not queued twice, so a burst of events costs one run.
+
+using WorkFn = void (*)(void* context);
+
+struct WorkItem {
+    WorkFn fn;
+    void* context;
+    WorkItem* next;       // Owned by the queue while queued
+    volatile bool queued;
+};
+
+// e.g. static Work::WorkItem tick_work = WORK_ITEM(print_tick, nullptr);
+#define WORK_ITEM(fn, context) { fn, context, nullptr, false }
+
+// Queue 'item'. Safe from any context. Returns false if it was already queued.
+bool schedule(WorkItem& item);
+
+// Run every item queued so far, oldest first. Thread context only. Returns the number run.
+kstd::size_t run_pending();
+
+} // namespace Work
+} // namespace Kernel
+
+#endif // KERNEL_IRQ_WORKQUEUE_H
@@ -0,0 +1,194 @@
+#include "kexec.h"
+#include <kernel/filesystem/file.h>          // For FS::File
+#include <kernel/filesystem/filesystem.h>    // For global_filesystem().sync() (RAM disk handover)
+#include <kernel/mm/page_alloc.h>            // For Mem::alloc_page, Mem::PAGE_SIZE
+#include <kernel/smp.h>                      // For num_online_cpus
+#include <arch/arm/peripherals/timer.h>      // For system_timer_stop_global, GenericTimer::get_counter
+#include <arch/arm/peripherals/dma.h>        // For get_dma_controller (quiesce)
+#include <arch/arm/peripherals/uart.h>       // For get_main_uart (drain before the handover)
+#include <lib/fdt/fdt.h>                     // For FDT::total_size
+#include <lib/printf/printf.h>               // For Kernel::kprintf
+#include <kstd/cstring.h>                    // For kmemcpy
+
+extern "C" {
+    extern char PRESERVED_RAM_START[];
+    extern char PRESERVED_RAM_END[];
+
+    // arch/arm/core/kexec.S
+    extern char kexec_relocate_start[];
+    extern char kexec_relocate_end[];
+    [[noreturn]] void kexec_jump(void* relocate_code, const kstd::uint64_t* page_list, kstd::uint64_t page_count,
+                                 kstd::uintptr_t load_address, kstd::uintptr_t dtb_address, kstd::uint64_t entry_ticks);
+}
+
+namespace Kernel {
+namespace Kexec {
+
+// At PRESERVED_RAM_START. Written right before the jump, cleared by the next kernel's init(),
+// so a cold boot never mistakes stale RAM contents for a handoff.
+struct Handoff {
+    kstd::uint32_t magic;
+    kstd::uint32_t flags;
+    kstd::uint32_t warm_restarts;
+    kstd::uint32_t reserved;
+};
+
+constexpr kstd::uint32_t HANDOFF_MAGIC   = 0x4358454B; // "KEXC"
+constexpr kstd::uint32_t HANDOFF_KEEP    = (1 << 0);
+constexpr kstd::size_t   HANDOFF_SIZE    = 64;          // One cache line, keeps the region aligned
+constexpr kstd::size_t   MAX_IMAGE_PAGES = MAX_IMAGE_SIZE / Mem::PAGE_SIZE;
+
+static_assert(sizeof(Handoff) <= HANDOFF_SIZE, "Handoff record outgrew its slot");
+static_assert(MAX_IMAGE_PAGES * sizeof(kstd::uint64_t) <= Mem::PAGE_SIZE, "Page list must fit one page");
+
+static kstd::uintptr_t boot_dtb = 0;
+static PreservedRegion region = {nullptr, 0, false, 0};
+
+// Staged image: page_list[i] holds the physical address of bytes [i * 4KB, (i + 1) * 4KB)
+static kstd::uint64_t* page_list = nullptr;
+static void* relocate_code = nullptr; // Copy of kexec_relocate_start..end, outside the copy target
+static kstd::size_t page_count = 0;
+static kstd::size_t image_size = 0;
+
+static volatile Handoff* handoff() {
+    return reinterpret_cast<volatile Handoff*>(PRESERVED_RAM_START);
+}
+
+void init(kstd::uintptr_t dtb_address) {
+    boot_dtb = dtb_address;
+
+    volatile Handoff* h = handoff();
+    if (h->magic == HANDOFF_MAGIC) {
+        region.kept = (h->flags & HANDOFF_KEEP) != 0;
+        region.warm_restarts = h->warm_restarts + 1;
+    }
+    h->magic = 0;
+
+    region.base = PRESERVED_RAM_START + HANDOFF_SIZE;
+    region.size = static_cast<kstd::size_t>(PRESERVED_RAM_END - PRESERVED_RAM_START) - HANDOFF_SIZE;
+
+    // The firmware decides where the DTB goes; it must not live in memory we hand out as ours
+    kstd::uintptr_t dtb_end = dtb_address + FDT::total_size(reinterpret_cast<const void*>(dtb_address));
+    if (dtb_address && dtb_address < reinterpret_cast<kstd::uintptr_t>(PRESERVED_RAM_END) &&
+        dtb_end > reinterpret_cast<kstd::uintptr_t>(PRESERVED_RAM_START)) {
+        Kernel::kprintf("Kexec: DTB at 0x%llx overlaps the preserved region, disabling it.\n", dtb_address);
+        region.size = 0;
+        region.kept = false;
+    }
+
+    if (region.warm_restarts) {
+        Kernel::kprintf("Kexec: Warm restart #%u, preserved region %s.\n", region.warm_restarts,
+                        region.kept ? "kept" : "discarded");
+    }
+}
+
+PreservedRegion preserved_region() {
+    return region;
+}
+
+void unload() {
+    for (kstd::size_t i = 0; i < page_count; ++i) {
+        Mem::free_page(reinterpret_cast<void*>(page_list[i]));
+    }
+    if (page_list) Mem::free_page(page_list);
+    if (relocate_code) Mem::free_page(relocate_code);
+    page_list = nullptr;
+    relocate_code = nullptr;
+    page_count = 0;
+    image_size = 0;
+}
+
+bool is_loaded() {
+    return page_list != nullptr;
+}
+
+kstd::size_t loaded_size() {
+    return image_size;
+}
+
+Result load(FS::File& image) {
+    unload();
+    if (num_online_cpus() > 1) return Result::CPUS_ONLINE;
+
+    kstd::size_t size = image.get_size() - image.tell();
+    if (size == 0) return Result::EMPTY_IMAGE;
+    if (size > MAX_IMAGE_SIZE || LOAD_ADDRESS + size > reinterpret_cast<kstd::uintptr_t>(PRESERVED_RAM_START)) {
+        return Result::TOO_LARGE;
+    }
+    kstd::size_t dtb_size = FDT::total_size(reinterpret_cast<const void*>(boot_dtb));
+    if (boot_dtb && boot_dtb < LOAD_ADDRESS + size && boot_dtb + dtb_size > LOAD_ADDRESS) {
+        return Result::DTB_OVERLAP;
+    }
+
+    page_list = static_cast<kstd::uint64_t*>(Mem::alloc_page());
+    relocate_code = Mem::alloc_page();
+    if (!page_list || !relocate_code) {
+        unload();
+        return Result::NO_MEMORY;
+    }
+
+    // The copy in kexec.S moves whole pages: the tail of the last one goes along unread
+    while (image_size < size) {
+        void* page = Mem::alloc_page();
+        if (!page) {
+            unload();
+            return Result::NO_MEMORY;
+        }
+        page_list[page_count++] = reinterpret_cast<kstd::uintptr_t>(page);
+
+        kstd::size_t chunk = size - image_size;
+        if (chunk > Mem::PAGE_SIZE) chunk = Mem::PAGE_SIZE;
+        kstd::size_t bytes_read = 0;
+        if (image.read(page, chunk, bytes_read) != FS::ErrorCode::OK || bytes_read != chunk) {
+            unload();
+            return Result::READ_ERROR;
+        }
+        image_size += chunk;
+    }
+    return Result::OK;
+}
+
+[[noreturn]] void execute(bool keep_preserved) {
+    kstd::uint64_t entry_ticks = Arch::RaspberryPi::GenericTimer::get_counter();
+    if (keep_preserved) global_filesystem().sync(); // The RAM disk lives in the preserved region
+
+    Kernel::kprintf("Kexec: Booting %u byte image at 0x%llx%s.\n", static_cast<unsigned int>(image_size),
+                    static_cast<kstd::uint64_t>(LOAD_ADDRESS), keep_preserved ? ", keeping preserved RAM" : "");
+    Arch::RaspberryPi::UART* uart = Arch::RaspberryPi::get_main_uart();
+    if (uart) uart->flush();
+
+    // Nothing may fire or write to memory behind the new kernel's back
+    asm volatile("msr daifset, #0xf" ::: "memory");
+    Arch::RaspberryPi::system_timer_stop_global();
+    Arch::RaspberryPi::get_dma_controller().shutdown();
+
+    if (region.size) { // Otherwise the record would land on the DTB
+        volatile Handoff* h = handoff();
+        h->flags = keep_preserved ? HANDOFF_KEEP : 0;
+        h->warm_restarts = region.warm_restarts;
+        h->magic = HANDOFF_MAGIC;
+    }
+
+    // The relocation code has to run from memory the copy does not overwrite. kexec_jump
+    // writes the D-cache back by set/way and invalidates the I-cache before branching to it.
+    kstd::kmemcpy(relocate_code, kexec_relocate_start, static_cast<kstd::size_t>(kexec_relocate_end - kexec_relocate_start));
+
+    kexec_jump(relocate_code, page_list, page_count, LOAD_ADDRESS, boot_dtb, entry_ticks);
+}
+
+const char* result_string(Result result) {
+    switch (result) {
+        case Result::OK:          return "OK";
+        case Result::EMPTY_IMAGE: return "image is empty";
+        case Result::TOO_LARGE:   return "image too large";
+        case Result::DTB_OVERLAP: return "image would overwrite the device tree";
+        case Result::NO_MEMORY:   return "out of pages";
+        case Result::READ_ERROR:  return "read error";
+        case Result::NOT_LOADED:  return "no image loaded";
+        case Result::CPUS_ONLINE: return "secondary CPUs are online";
+    }
+    return "unknown";
+}
+
+} // namespace Kexec
+} // namespace Kernel
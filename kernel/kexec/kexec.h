@@ -0,0 +1,66 @@
+#ifndef KERNEL_KEXEC_KEXEC_H
+#define KERNEL_KEXEC_KEXEC_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uintptr_t
+
+namespace Kernel {
+namespace FS { class File; }
+
+namespace Kexec {
+
+// Warm restart: boot a new kernel image straight from the running one, without the firmware.
+//
+// load() copies an image file (kernel8.img or the zImage, e.g. uploaded with 'rx') into pages
+// from the page allocator, which all lie above the boot stack. execute() stops the timer and
+// DMA, masks interrupts and hands over to arch/arm/core/kexec.S: MMU and D-cache off, image
+// copied to 0x80000 over the old kernel, entered with the firmware's register contract
+// (x0 = DTB). x1 carries CNTPCT_EL0 from the start of execute(), so the new kernel's 'boottime'
+// "entry" phase covers the whole handover.
+//
+// The preserved region (PRESERVED_RAM_START..PRESERVED_RAM_END in the linker script) lies
+// between the kernel heap and the boot stack: no boot code, zImage stub or page allocator
+// touches it. A restart with keep_preserved tells the next kernel its contents are valid.
+
+constexpr kstd::uintptr_t LOAD_ADDRESS   = 0x80000;
+constexpr kstd::size_t    MAX_IMAGE_SIZE = 2 * 1024 * 1024; // One page of page-list entries
+
+enum class Result {
+    OK,
+    EMPTY_IMAGE,
+    TOO_LARGE,   // Above MAX_IMAGE_SIZE, or would run into the preserved region
+    DTB_OVERLAP, // The image would overwrite the device tree
+    NO_MEMORY,
+    READ_ERROR,
+    NOT_LOADED,
+    CPUS_ONLINE, // Secondary cores run this kernel's code and cannot go back to the spin table
+};
+
+struct PreservedRegion {
+    void* base;          // Usable memory, after the handoff record
+    kstd::size_t size;
+    bool kept;           // The previous kernel restarted with keep_preserved: contents are valid
+    kstd::uint32_t warm_restarts; // Consecutive kexec restarts before this boot (0 after a cold boot)
+};
+
+// Record the DTB address for the next kernel and consume the previous kernel's handoff record.
+// Called from kernel_main once the page allocator is up.
+void init(kstd::uintptr_t dtb_address);
+
+PreservedRegion preserved_region();
+
+// Stage the whole file (from its current position) for execute(). Replaces a staged image.
+Result load(FS::File& image);
+void unload();
+bool is_loaded();
+kstd::size_t loaded_size();
+
+// Boot the staged image. Does not return.
+[[noreturn]] void execute(bool keep_preserved);
+
+const char* result_string(Result result);
+
+} // namespace Kexec
+} // namespace Kernel
+
+#endif // KERNEL_KEXEC_KEXEC_H
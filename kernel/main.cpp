@@ -6,7 +6,17 @@
 #include <arch/arm/peripherals/uart.h> // For Arch::RaspberryPi::uart_init_global()
 #include <arch/arm/peripherals/timer.h> // For Arch::RaspberryPi::system_timer_init_global
 #include <arch/arm/core/gic.h>      // For Arch::Arm::gic_init_global()
+#include <arch/arm/core/mmu.h>      // For Arch::Arm::MMU::init_and_enable()
+#include <arch/arm/peripherals/dma.h> // For Arch::RaspberryPi::dma_init_global()
+#include <arch/arm/peripherals/mailbox.h> // For Arch::RaspberryPi::mailbox_set_arm_clock_max()
 #include <kernel/filesystem/filesystem.h> // For Kernel::global_filesystem()
+#include <kernel/mm/page_alloc.h>  // For Kernel::Mem::page_alloc_init()
+#include <kernel/trace/boottime.h>  // For Kernel::Trace::boot_phase() (boot-phase profiler)
+#include <kernel/init/initcall.h>   // For Kernel::Init::run_level() and KERNEL_INITCALL
+#include <kernel/kexec/kexec.h>     // For Kernel::Kexec::init() (warm restart handoff)
+#include <kernel/irq/softirq.h>     // For Kernel::SoftIrq::run_pending() (idle loop)
+#include <kernel/irq/workqueue.h>   // For Kernel::Work (deferred work in thread context)
+#include <kernel/irq/balance.h>     // For Kernel::IrqBalance::poll() (idle loop)
 
 // Forward declare init_exceptions if not in a common Arch header
 // extern "C" void init_exceptions(); // Defined in exceptions.cpp
@@ -25,6 +35,8 @@ extern "C" {
     extern char HEAP_END[];   // Address of the end of the heap
 }
 
+static bool kernel_idle(); // Console idle hook, below
+
 
 // Kernel main function - entry point from assembly (_start_kernel)
 extern "C" void kernel_main(kstd::uintptr_t dtb_ptr32, kstd::uint64_t x1, kstd::uint64_t x2, kstd::uint64_t x3) {
@@ -34,45 +46,50 @@ extern "C" void kernel_main(kstd::uintptr_t dtb_ptr32, kstd::uint64_t x1, kstd::
     // The other registers (x1-x3) might hold other info or be zero.
     (void)dtb_ptr32; (void)x1; (void)x2; (void)x3; // Mark as unused for now
 
+    // Every boot_phase() call ends the previous phase; see the 'boottime' shell command.
+    Kernel::Trace::boot_phase("allocator");
+
     // 1. Initialize the C++ dynamic memory allocator (new/delete).
     // The HEAP_START and HEAP_END symbols are defined in the linker script.
     // Their addresses give us the bounds of our pre-allocated kernel heap.
     kstd::size_t heap_size = (kstd::uintptr_t)HEAP_END - (kstd::uintptr_t)HEAP_START;
     Kernel::LibCXX::init_allocator(HEAP_START, heap_size);
 
+    Kernel::Trace::boot_phase("console");
     // 2. Initialize the main console.
     // This will internally initialize the UART and GPIO pins for UART.
     Kernel::global_console().init();
     Kernel::kprintf("Kernel Console Initialized.\n");
 
+    Kernel::Trace::boot_phase("mmu");
     // 3. Initialize and Enable MMU
-    // This sets up identity mapping for the first 2GB.
-    Arch::Arm::MMU::init_and_enable();
+    // This identity maps the RAM listed in the device tree and the peripheral window.
+    Arch::Arm::MMU::init_and_enable(dtb_ptr32);
     Kernel::kprintf("MMU Initialized and Enabled.\n");
 
-
+    Kernel::Trace::boot_phase("exceptions");
     // 4. Initialize exception handling (set VBAR_EL1)
     // VBAR_EL1 should point to the virtual address of _exception_vectors.
     // With identity mapping, virtual == physical for this kernel region.
     init_exceptions(); // Calls function from exceptions.cpp to set VBAR_EL1
 
-    // 5. Initialize Interrupt Controller (GIC)
-    // This also enables CPU interrupts AFTER GIC is ready.
-    Arch::Arm::gic_init_global();
-
-
-    // 5. Initialize System Timer (ARM Generic Timer via CNTP_EL1)
-    // Example: 1 Hz timer tick
-    void timer_callback(unsigned int irq, void* ctx); // Forward declaration
-    Arch::RaspberryPi::system_timer_init_global(1, timer_callback, nullptr); // 1 Hz timer
-    Kernel::kprintf("System timer initialized (1 Hz).\n");
+    Kernel::Trace::boot_phase("page allocator");
+    // 4a. Physical page allocator and kernel virtual memory (TTBR1 / vmalloc).
+    // Needs the MMU's RAM map, and the exception vectors for lazily committed pages.
+    Kernel::Mem::page_alloc_init(dtb_ptr32);
+    // Remember the DTB for a warm restart and pick up the previous kernel's handoff, if any
+    Kernel::Kexec::init(dtb_ptr32);
 
-    // 6. Initialize Filesystem
-    Kernel::global_filesystem().init();
-    Kernel::kprintf("In-memory filesystem initialized.\n");
-    // global_filesystem().list_files_to_console(); // Optional: list files at boot for debug
+    // 5. Everything else registers itself with KERNEL_INITCALL (kernel/init/initcall.h):
+    // arch (ARM clock, GIC), then device (timer, DMA), then subsystems. Each initcall is
+    // its own boot phase. Deferred ones (filesystem) run while the shell waits for input.
+    Kernel::Init::run_level(INITCALL_LEVEL_ARCH);
+    Kernel::Init::run_level(INITCALL_LEVEL_DEVICE);
+    Kernel::Init::run_level(INITCALL_LEVEL_SUBSYS);
+    Kernel::global_console().set_idle_hook(kernel_idle);
 
 
+    Kernel::Trace::boot_phase("banner, heap test");
     // Print a welcome message using the new Console
     Kernel::kprintf("KEKOS C++ Kernel: Booting...\n");
     Kernel::kprintf("kernel_main reached. DTB at 0x%llx (passed as x0/dtb_ptr32)\n", dtb_ptr32);
@@ -96,28 +113,8 @@ extern "C" void kernel_main(kstd::uintptr_t dtb_ptr32, kstd::uint64_t x1, kstd::
         Kernel::global_console().println("Heap allocator NOT initialized or size is zero.");
     }
 
-    Kernel::global_console().println("Kernel setup complete. Entering idle loop.");
-    Kernel::global_console().println("You should see this text on your serial console (e.g., minicom, PuTTY).");
-    Kernel::global_console().println("---");
-
-
-    // Simple echo test loop
-    Kernel::global_console().println("Starting echo test. Type something:");
-    char input_buffer[128];
-    while(true) {
-        Kernel::global_console().print("> ");
-        kstd::size_t len = Kernel::global_console().read_line(input_buffer, 128);
-        if (len > 0) {
-            Kernel::global_console().print("Echo: ");
-            Kernel::global_console().println(input_buffer);
-        }
-        if (kstd::strcmp(input_buffer, "exit") == 0) {
-             Kernel::global_console().println("Exiting echo test loop.");
-             break;
-        }
-    }
-
-    Kernel::global_console().println("Kernel idle loop (after echo test). Timer ticks should print every second.");
+    Kernel::Trace::boot_phase("shell start");
+    Kernel::global_console().println("Kernel setup complete. Starting shell.");
     Kernel::global_console().println("---"); // Separator before shell starts
 
     // 7. Start the Kernel Shell
@@ -135,17 +132,40 @@ extern "C" void kernel_main(kstd::uintptr_t dtb_ptr32, kstd::uint64_t x1, kstd::
 }
 
 
-// Timer callback function
+// Thread context: what the console does while it waits for input. Leftover softirqs, queued
+// work, a due IRQ balancing pass, then the next deferred initcall (one per call, so input is
+// picked up in between).
+static bool kernel_idle() {
+    Kernel::SoftIrq::run_pending();
+    Kernel::Work::run_pending();
+    Kernel::IrqBalance::poll();
+    Kernel::Init::run_deferred_step();
+    return true; // Keep the hook: work can be queued at any time
+}
+
+
+// Example: 1 Hz timer tick (ARM Generic Timer via CNTP_EL1), needs the GIC
+void timer_callback(unsigned int irq, void* ctx);
+static void timer_initcall() {
+    Arch::RaspberryPi::system_timer_init_global(1, timer_callback, nullptr);
+    Kernel::kprintf("System timer initialized (1 Hz).\n");
+}
+KERNEL_INITCALL(INITCALL_LEVEL_DEVICE, "timer", timer_initcall);
+
+// Timer callback function (TIMER softirq). Printing waits on the UART, so it is left to the
+// work queue; ticks that arrive before it runs are reported together.
 static volatile kstd::uint64_t timer_tick_count = 0;
+static void print_timer_tick(void* ctx) {
+    (void)ctx;
+    Kernel::kprintf("Timer tick %llu\n", timer_tick_count);
+}
+static Kernel::Work::WorkItem timer_tick_work = WORK_ITEM(print_timer_tick, nullptr);
+
 void timer_callback(unsigned int irq, void* ctx) {
     (void)irq; // Should be the timer's IRQ
     (void)ctx; // Context not used in this simple example
-    timer_tick_count++;
-    Kernel::kprintf("Timer tick %llu\n", timer_tick_count);
-
-    // Note: kprintf in an ISR is generally okay for debugging but can cause issues
-    // if kprintf itself is not re-entrant or uses locks that might be held by interrupted code.
-    // Our current kprintf is fairly simple and writes directly to UART (via Console).
+    timer_tick_count = timer_tick_count + 1;
+    Kernel::Work::schedule(timer_tick_work);
 }
 
 
@@ -0,0 +1,116 @@
+#include "page_alloc.h"
+#include <arch/arm/core/mmu.h>   // For MMU::get_ram_regions, set_table_allocator
+#include <arch/arm/core/cache.h> // For Cache::zero_range
+#include <lib/fdt/fdt.h>         // For FDT::total_size
+#include <lib/printf/printf.h>   // For Kernel::kprintf
+#include <kernel/spinlock.h>     // For Spinlock (allocations may come from any core)
+
+extern "C" char BOOT_STACK_TOP[]; // Everything below belongs to the kernel image, heap and stack
+
+namespace Kernel {
+namespace Mem {
+
+struct PageRange {
+    kstd::uintptr_t next; // First page never handed out
+    kstd::uintptr_t end;
+};
+
+static PageRange ranges[MAX_PAGE_RANGES];
+static kstd::size_t range_count = 0;
+static kstd::size_t current_range = 0;
+static void* free_list = nullptr; // Each free page stores the pointer to the next one
+static kstd::size_t total_pages = 0;
+static kstd::size_t free_pages = 0;
+static Spinlock page_lock; // Guards the ranges, the free list and the counters
+
+static void add_range(kstd::uintptr_t start, kstd::uintptr_t end) {
+    start = (start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    end &= ~(PAGE_SIZE - 1);
+    if (end <= start) return;
+    if (range_count >= MAX_PAGE_RANGES) {
+        Kernel::kprintf("PageAlloc: Too many ranges, dropping 0x%llx-0x%llx.\n", start, end);
+        return;
+    }
+    ranges[range_count].next = start;
+    ranges[range_count].end = end;
+    ++range_count;
+    total_pages += (end - start) / PAGE_SIZE;
+}
+
+static void* table_allocator() {
+    return alloc_zeroed_page();
+}
+
+void page_alloc_init(kstd::uintptr_t dtb_address) {
+    kstd::uintptr_t reserved_end = reinterpret_cast<kstd::uintptr_t>(BOOT_STACK_TOP);
+    kstd::uintptr_t dtb_start = dtb_address & ~(PAGE_SIZE - 1);
+    kstd::uintptr_t dtb_end = dtb_address + FDT::total_size(reinterpret_cast<const void*>(dtb_address));
+
+    const FDT::MemoryRegion* regions = nullptr;
+    kstd::size_t count = Arch::Arm::MMU::get_ram_regions(&regions);
+    for (kstd::size_t i = 0; i < count; ++i) {
+        kstd::uintptr_t start = regions[i].base;
+        kstd::uintptr_t end = regions[i].base + regions[i].size;
+        if (start < reserved_end) start = reserved_end;
+        if (dtb_end > dtb_address && dtb_start < end && dtb_end > start) {
+            add_range(start, dtb_start);
+            add_range(dtb_end, end);
+        } else {
+            add_range(start, end);
+        }
+    }
+    free_pages = total_pages;
+
+    Arch::Arm::MMU::set_table_allocator(table_allocator);
+    Kernel::kprintf("PageAlloc: %u pages (%u MB) in %u ranges.\n", static_cast<unsigned int>(total_pages),
+                    static_cast<unsigned int>(total_pages / (1024 * 1024 / PAGE_SIZE)), static_cast<unsigned int>(range_count));
+}
+
+void* alloc_page() {
+    kstd::uint64_t daif = page_lock.lock_irqsave();
+
+    void* page = nullptr;
+    if (free_list) {
+        page = free_list;
+        free_list = *static_cast<void**>(free_list);
+    } else {
+        while (current_range < range_count && ranges[current_range].next >= ranges[current_range].end) {
+            ++current_range;
+        }
+        if (current_range < range_count) {
+            page = reinterpret_cast<void*>(ranges[current_range].next);
+            ranges[current_range].next += PAGE_SIZE;
+        }
+    }
+    if (page) --free_pages;
+
+    page_lock.unlock_irqrestore(daif);
+    return page;
+}
+
+void* alloc_zeroed_page() {
+    void* page = alloc_page();
+    if (page) {
+        Arch::Arm::Cache::zero_range(page, PAGE_SIZE);
+    }
+    return page;
+}
+
+void free_page(void* page) {
+    if (!page) return;
+    kstd::uint64_t daif = page_lock.lock_irqsave();
+    *static_cast<void**>(page) = free_list;
+    free_list = page;
+    ++free_pages;
+    page_lock.unlock_irqrestore(daif);
+}
+
+PageStats page_stats() {
+    PageStats s;
+    s.total_pages = total_pages;
+    s.free_pages = free_pages;
+    return s;
+}
+
+} // namespace Mem
+} // namespace Kernel
@@ -0,0 +1,38 @@
+#ifndef KERNEL_MM_PAGE_ALLOC_H
+#define KERNEL_MM_PAGE_ALLOC_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uintptr_t
+
+namespace Kernel {
+namespace Mem {
+
+// Physical page allocator for 4KB frames.
+// Hands out the RAM the MMU identity-mapped (see MMU::get_ram_regions), minus everything below
+// the boot stack top (kernel image, heap, stack) and the device tree blob.
+// Fresh memory is handed out by bumping through those ranges, freed pages go on a free list
+// threaded through the pages themselves, so init costs nothing regardless of RAM size.
+// Pages are identity-mapped: the returned pointer is also the physical address.
+
+constexpr kstd::size_t PAGE_SIZE = 4096;
+constexpr kstd::size_t MAX_PAGE_RANGES = 16;
+
+struct PageStats {
+    kstd::size_t total_pages;
+    kstd::size_t free_pages;
+};
+
+// Build the ranges from the MMU's RAM map. dtb_address is kept out of the pool (0 if none).
+void page_alloc_init(kstd::uintptr_t dtb_address);
+
+// nullptr when RAM is exhausted. IRQ-safe.
+void* alloc_page();
+void* alloc_zeroed_page();
+void free_page(void* page);
+
+PageStats page_stats();
+
+} // namespace Mem
+} // namespace Kernel
+
+#endif // KERNEL_MM_PAGE_ALLOC_H
@@ -0,0 +1,171 @@
+#include "vmalloc.h"
+#include "page_alloc.h"
+#include <lib/printf/printf.h> // For Kernel::kprintf
+#include <kernel/spinlock.h>    // For Spinlock (allocations may come from any core)
+
+namespace Kernel {
+namespace Mem {
+
+using Arch::Arm::MMU;
+
+struct VmArea {
+    kstd::uintptr_t start;
+    kstd::size_t size;      // Bytes, page multiple, without the guard page
+    kstd::size_t committed; // Pages currently mapped
+    bool lazy;
+};
+
+// Sorted by start address
+static VmArea areas[MAX_VM_AREAS];
+static kstd::size_t area_count = 0;
+static kstd::size_t lazy_faults = 0;
+static Spinlock vm_lock; // Guards the areas and the TTBR1 mappings behind them
+
+static VmArea* find_area(kstd::uintptr_t addr) {
+    for (kstd::size_t i = 0; i < area_count; ++i) {
+        if (addr >= areas[i].start && addr < areas[i].start + areas[i].size) {
+            return &areas[i];
+        }
+    }
+    return nullptr;
+}
+
+// First fit in the sorted area list, leaving a guard page after every area
+static VmArea* create_area(kstd::size_t size, bool lazy) {
+    if (size == 0 || area_count >= MAX_VM_AREAS) return nullptr;
+    size = (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    kstd::uintptr_t candidate = VMALLOC_START;
+    kstd::size_t slot = 0;
+    for (; slot < area_count; ++slot) {
+        if (candidate + size + PAGE_SIZE <= areas[slot].start) break;
+        candidate = areas[slot].start + areas[slot].size + PAGE_SIZE;
+    }
+    if (candidate + size + PAGE_SIZE > VMALLOC_END || candidate + size < candidate) return nullptr;
+
+    for (kstd::size_t i = area_count; i > slot; --i) {
+        areas[i] = areas[i - 1];
+    }
+    ++area_count;
+    areas[slot].start = candidate;
+    areas[slot].size = size;
+    areas[slot].committed = 0;
+    areas[slot].lazy = lazy;
+    return &areas[slot];
+}
+
+static void remove_area(VmArea* area) {
+    kstd::size_t index = static_cast<kstd::size_t>(area - areas);
+    for (kstd::size_t i = index; i + 1 < area_count; ++i) {
+        areas[i] = areas[i + 1];
+    }
+    --area_count;
+}
+
+static bool commit_page(VmArea* area, kstd::uintptr_t va) {
+    void* page = alloc_zeroed_page();
+    if (!page) return false;
+    if (!MMU::map_range(va, reinterpret_cast<kstd::uintptr_t>(page), PAGE_SIZE, Arch::Arm::MAP_KERNEL_RW)) {
+        free_page(page);
+        return false;
+    }
+    ++area->committed;
+    return true;
+}
+
+// Unmap in batches so each batch costs one TLB flush, then hand the frames back
+static void release_area(VmArea* area) {
+    constexpr kstd::size_t BATCH = 64;
+    void* pages[BATCH];
+    for (kstd::uintptr_t va = area->start; va < area->start + area->size && area->committed; va += BATCH * PAGE_SIZE) {
+        kstd::size_t span = area->start + area->size - va;
+        if (span > BATCH * PAGE_SIZE) span = BATCH * PAGE_SIZE;
+        kstd::size_t found = 0;
+        for (kstd::size_t off = 0; off < span; off += PAGE_SIZE) {
+            kstd::uint64_t entry = MMU::lookup(va + off);
+            if (entry) {
+                pages[found++] = reinterpret_cast<void*>(entry & Arch::Arm::PTE_ADDR_MASK);
+            }
+        }
+        if (found == 0) continue;
+        MMU::unmap_range(va, span);
+        for (kstd::size_t i = 0; i < found; ++i) {
+            free_page(pages[i]);
+        }
+        area->committed -= found;
+    }
+}
+
+void* vmalloc(kstd::size_t size) {
+    kstd::uint64_t daif = vm_lock.lock_irqsave();
+    VmArea* area = create_area(size, false);
+    void* result = nullptr;
+    if (area) {
+        bool ok = true;
+        for (kstd::uintptr_t va = area->start; ok && va < area->start + area->size; va += PAGE_SIZE) {
+            ok = commit_page(area, va);
+        }
+        if (ok) {
+            result = reinterpret_cast<void*>(area->start);
+        } else {
+            release_area(area);
+            remove_area(area);
+        }
+    }
+    vm_lock.unlock_irqrestore(daif);
+    return result;
+}
+
+void* vreserve(kstd::size_t size) {
+    kstd::uint64_t daif = vm_lock.lock_irqsave();
+    VmArea* area = create_area(size, true);
+    vm_lock.unlock_irqrestore(daif);
+    return area ? reinterpret_cast<void*>(area->start) : nullptr;
+}
+
+void vfree(void* addr) {
+    if (!addr) return;
+    kstd::uint64_t daif = vm_lock.lock_irqsave();
+    VmArea* area = find_area(reinterpret_cast<kstd::uintptr_t>(addr));
+    if (area && area->start == reinterpret_cast<kstd::uintptr_t>(addr)) {
+        release_area(area);
+        remove_area(area);
+    } else {
+        Kernel::kprintf("vfree: 0x%p is not the start of a vmalloc area.\n", addr);
+    }
+    vm_lock.unlock_irqrestore(daif);
+}
+
+bool vmalloc_handle_fault(kstd::uintptr_t addr) {
+    if (addr < VMALLOC_START || addr >= VMALLOC_END) return false;
+    kstd::uint64_t daif = vm_lock.lock_irqsave();
+    VmArea* area = find_area(addr);
+    kstd::uintptr_t page = addr & ~(PAGE_SIZE - 1);
+    bool handled = false;
+    if (area && area->lazy) {
+        // Mapped already: another CPU faulted on the same page first and committed it
+        handled = MMU::lookup(page) != 0;
+        if (!handled && commit_page(area, page)) {
+            handled = true;
+            ++lazy_faults;
+        }
+    }
+    vm_lock.unlock_irqrestore(daif);
+    return handled;
+}
+
+VmStats vm_stats() {
+    kstd::uint64_t daif = vm_lock.lock_irqsave();
+    VmStats s = {};
+    s.areas = area_count;
+    for (kstd::size_t i = 0; i < area_count; ++i) {
+        s.reserved_bytes += areas[i].size;
+        s.committed_pages += areas[i].committed;
+    }
+    s.lazy_faults = lazy_faults;
+    vm_lock.unlock_irqrestore(daif);
+    return s;
+}
+
+} // namespace Mem
+} // namespace Kernel
@@ -0,0 +1,47 @@
+#ifndef KERNEL_MM_VMALLOC_H
+#define KERNEL_MM_VMALLOC_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uintptr_t
+#include <arch/arm/core/mmu.h> // For KERNEL_VA_BASE
+
+namespace Kernel {
+namespace Mem {
+
+// Kernel virtual memory in the TTBR1 half: contiguous virtual ranges backed by arbitrary
+// physical pages from the page allocator. Every area is followed by an unmapped guard page.
+//
+// vmalloc() commits all pages up front. vreserve() only reserves address space: pages are
+// committed (zeroed) by the data abort handler on first touch, so large sparse tables only
+// pay for the pages they actually use.
+
+constexpr kstd::uintptr_t VMALLOC_START = Arch::Arm::KERNEL_VA_BASE;
+constexpr kstd::uintptr_t VMALLOC_END   = VMALLOC_START + 256ULL * 1024 * 1024 * 1024; // 256GB
+constexpr kstd::size_t    MAX_VM_AREAS  = 64;
+
+struct VmStats {
+    kstd::size_t areas;
+    kstd::size_t reserved_bytes;  // Virtual size of all areas
+    kstd::size_t committed_pages; // Physical pages backing them
+    kstd::size_t lazy_faults;     // Pages committed on first touch
+};
+
+// Zeroed, fully committed memory. nullptr if out of address space or RAM.
+void* vmalloc(kstd::size_t size);
+
+// Address space only; reads and writes commit zero pages on demand.
+void* vreserve(kstd::size_t size);
+
+// Unmap an area from vmalloc/vreserve and return its pages.
+void vfree(void* addr);
+
+// Called from the synchronous exception handler for a translation fault at addr.
+// Returns true if addr lies in a vreserve() area and a page was committed (retry the access).
+bool vmalloc_handle_fault(kstd::uintptr_t addr);
+
+VmStats vm_stats();
+
+} // namespace Mem
+} // namespace Kernel
+
+#endif // KERNEL_MM_VMALLOC_H
@@ -6,6 +6,25 @@
 #include <lib/printf/printf.h> // For Kernel::kprintf
 #include <kstd/cstring.h>   // For kstrcmp, kstrcpy, kstrlen
 #include <kstd/cstddef.h>   // For kstd::size_t
+#include <arch/arm/peripherals/mailbox.h> // For Arch::RaspberryPi::Mailbox (clock command)
+#include <arch/arm/peripherals/uart.h>    // For Arch::RaspberryPi::get_main_uart (baud command)
+#include <arch/arm/peripherals/timer.h>   // For GenericTimer::get_timer_frequency_hz
+#include <kernel/xfer/xfer.h>              // For Xfer::receive_file/send_file (rx/tx commands)
+#include <kernel/mm/page_alloc.h>          // For Mem::page_stats (vmstat command)
+#include <kernel/mm/vmalloc.h>             // For Mem::vreserve/vm_stats (vmstat command)
+#include <kernel/trace/boottime.h>         // For Trace::print_boot_report (boottime command)
+#include <kernel/init/initcall.h>          // For Init::print_report (initcalls command)
+#include <kernel/kexec/kexec.h>            // For Kexec::load/execute (kexec command)
+#include <kernel/interrupt.h>              // For get_interrupt_controller (irqstat command)
+#include <kernel/irq/softirq.h>            // For SoftIrq::run_count (irqstat command)
+#include <kernel/irq/balance.h>            // For IrqBalance (irqbalance/irqaffinity commands)
+#include <kernel/smp.h>                    // For online_cpus (per-CPU columns)
+#include <kernel/trace/latency.h>          // For Trace::run_irq_latency (latency command)
+#include <kernel/trace/irqsoff.h>          // For Trace::print_irqsoff_report (irqsoff command)
+#include <kernel/irqflags.h>               // For irq_save/irq_restore (transfers, baud test)
+#include <arch/arm/core/pmu.h>             // For Pmu counters (perf command)
+#include <kernel/trace/profile.h>          // For Trace::profile_start (perf record/report)
+#include <kernel/trace/ftrace.h>           // For Trace::ftrace_enable/ftrace_save (ftrace command)
 
 // For reboot/shutdown - these are platform specific.
 // We might need to call some Arch specific functions.
@@ -16,6 +35,35 @@ namespace Arch { void arch_reboot(); void arch_shutdown(); }
 namespace Kernel {
 namespace ShellCommands {
 
+// Parse an unsigned decimal number. Returns false on empty input, non-digits or overflow.
+static bool parse_uint(const char* str, kstd::uint32_t& out_value) {
+    if (!str || *str == '\0') return false;
+    kstd::uint64_t value = 0;
+    for (; *str; ++str) {
+        if (*str < '0' || *str > '9') return false;
+        value = value * 10 + static_cast<kstd::uint64_t>(*str - '0');
+        if (value > 0xFFFFFFFFULL) return false;
+    }
+    out_value = static_cast<kstd::uint32_t>(value);
+    return true;
+}
+
+// Parse a CPU list such as "0,2,3" into a mask. Returns false on anything else.
+static bool parse_cpu_list(const char* str, kstd::uint32_t& out_mask) {
+    if (!str || *str == '\0') return false;
+    kstd::uint32_t mask = 0;
+    for (; *str; ++str) {
+        if (*str >= '0' && *str < static_cast<char>('0' + MAX_CPUS) && (str[1] == ',' || str[1] == '\0')) {
+            mask |= 1u << (*str - '0');
+            if (str[1] == ',') ++str;
+        } else {
+            return false;
+        }
+    }
+    out_mask = mask;
+    return true;
+}
+
 // --- Command Handler Implementations ---
 
 int handle_help(const ParsedCommand& command, Shell& shell_instance) {
@@ -190,6 +238,573 @@ int handle_rm(const ParsedCommand& command, Shell& shell_instance) {
     return (res == FS::ErrorCode::OK) ? 0 : 1;
 }
 
+int handle_clock(const ParsedCommand& command, Shell& shell_instance) {
+    using Arch::RaspberryPi::Mailbox;
+    using Arch::RaspberryPi::ClockId;
+
+    if (command.arg_count >= 2) {
+        kstd::uint32_t target_hz = 0;
+        kstd::uint32_t mhz = 0;
+        if (kstd::kstrcmp(command.args[1], "max") == 0) {
+            target_hz = Mailbox::get_max_clock_rate(ClockId::ARM);
+        } else if (kstd::kstrcmp(command.args[1], "min") == 0) {
+            target_hz = Mailbox::get_min_clock_rate(ClockId::ARM);
+        } else if (parse_uint(command.args[1], mhz) && mhz > 0 && mhz <= 4294) {
+            target_hz = mhz * 1000000;
+        } else {
+            shell_instance.get_console().println("Usage: clock [max|min|<MHz>]");
+            return 1;
+        }
+        if (target_hz == 0 || Mailbox::set_clock_rate(ClockId::ARM, target_hz) == 0) {
+            shell_instance.get_console().println("Error: Firmware rejected the clock request.");
+            return 1;
+        }
+    }
+
+    const ClockId clocks[] = { ClockId::ARM, ClockId::CORE, ClockId::UART, ClockId::EMMC2 };
+    Kernel::kprintf("Clock    Current    Min        Max (MHz)\n");
+    for (ClockId clock : clocks) {
+        Kernel::kprintf("%-8s %-10u %-10u %u\n", Mailbox::clock_name(clock),
+                        Mailbox::get_clock_rate(clock) / 1000000,
+                        Mailbox::get_min_clock_rate(clock) / 1000000,
+                        Mailbox::get_max_clock_rate(clock) / 1000000);
+    }
+
+    kstd::uint32_t temp = 0, temp_max = 0;
+    if (Mailbox::get_temperature(temp)) {
+        Mailbox::get_max_temperature(temp_max);
+        Kernel::kprintf("SoC temperature: %u.%u C (limit %u C)\n", temp / 1000, (temp % 1000) / 100, temp_max / 1000);
+    }
+    kstd::uint32_t mem_base = 0, mem_size = 0;
+    if (Mailbox::get_arm_memory(mem_base, mem_size)) {
+        Kernel::kprintf("ARM memory: 0x%x - 0x%x (%u MB)\n", mem_base, mem_base + mem_size, mem_size / (1024 * 1024));
+    }
+    return 0;
+}
+
+int handle_baud(const ParsedCommand& command, Shell& shell_instance) {
+    Arch::RaspberryPi::UART* uart = Arch::RaspberryPi::get_main_uart();
+    Console& con = shell_instance.get_console();
+
+    if (command.arg_count < 2) {
+        Kernel::kprintf("UART0: %u baud (reference clock %u Hz, max %u baud)\n",
+                        uart->get_baud_rate(), uart->get_clock_hz(),
+                        uart->get_clock_hz() / Arch::RaspberryPi::UART_OVERSAMPLING);
+        return 0;
+    }
+
+    if (kstd::kstrcmp(command.args[1], "test") == 0) {
+        // baud test [bytes] [rate]: nothing leaves the TX pin in loopback mode, so the test
+        // may temporarily run at a rate the host terminal is not set to.
+        kstd::uint32_t byte_count = 65536;
+        kstd::uint32_t test_rate = 0;
+        if ((command.arg_count >= 3 && !parse_uint(command.args[2], byte_count)) ||
+            (command.arg_count >= 4 && !parse_uint(command.args[3], test_rate)) || byte_count == 0) {
+            con.println("Usage: baud test [bytes] [rate]");
+            return 1;
+        }
+        unsigned int saved_rate = uart->get_baud_rate();
+
+        // Mask IRQs so the timer tick does not print into the loopback
+        kstd::uint64_t daif = Kernel::irq_save();
+
+        bool switched = true;
+        if (test_rate != 0) {
+            switched = Arch::RaspberryPi::uart_set_baud_global(test_rate);
+        }
+        kstd::uint64_t ticks = 0;
+        kstd::size_t errors = 0;
+        unsigned int measured_rate = uart->get_baud_rate();
+        if (switched) {
+            uart->loopback_test(byte_count, ticks, errors);
+        }
+        if (test_rate != 0) {
+            Arch::RaspberryPi::uart_set_baud_global(saved_rate);
+        }
+        Kernel::irq_restore(daif);
+
+        if (!switched) {
+            Kernel::kprintf("Error: %u baud is not reachable.\n", test_rate);
+            return 1;
+        }
+        kstd::uint64_t freq = Arch::RaspberryPi::GenericTimer::get_timer_frequency_hz();
+        kstd::uint64_t bytes_per_sec = ticks ? (static_cast<kstd::uint64_t>(byte_count) * freq) / ticks : 0;
+        Kernel::kprintf("Loopback @ %u baud: %u bytes in %llu us, %llu bytes/s (line max %u bytes/s), %u errors\n",
+                        measured_rate, byte_count, freq ? (ticks * 1000000) / freq : 0,
+                        bytes_per_sec, measured_rate / 10, static_cast<unsigned int>(errors));
+        return errors == 0 ? 0 : 1;
+    }
+
+    kstd::uint32_t new_rate = 0;
+    if (!parse_uint(command.args[1], new_rate) || new_rate < 300) {
+        con.println("Usage: baud [<rate>|test [bytes] [rate]]");
+        return 1;
+    }
+    Kernel::kprintf("Switching UART0 to %u baud. Reconfigure your terminal.\n", new_rate);
+    if (!Arch::RaspberryPi::uart_set_baud_global(new_rate)) {
+        Kernel::kprintf("Error: %u baud is not reachable (UART clock %u Hz).\n", new_rate, uart->get_clock_hz());
+        return 1;
+    }
+    Kernel::kprintf("UART0 now at %u baud (reference clock %u Hz).\n", uart->get_baud_rate(), uart->get_clock_hz());
+    return 0;
+}
+
+// Print the outcome of a transfer. Runs after IRQs are unmasked again.
+static int report_transfer(const char* verb, const char* filename, Xfer::Result result, const Xfer::Stats& stats) {
+    if (result != Xfer::Result::OK) {
+        Kernel::kprintf("\n%s '%s' failed: %s (%u bytes, %u retransmits, %u CRC errors).\n",
+                        verb, filename, Xfer::result_to_string(result), static_cast<unsigned int>(stats.bytes),
+                        stats.retransmits, stats.crc_errors);
+        return 1;
+    }
+    kstd::uint64_t freq = Arch::RaspberryPi::GenericTimer::get_timer_frequency_hz();
+    kstd::uint64_t ms = freq ? (stats.ticks * 1000) / freq : 0;
+    kstd::uint64_t bytes_per_sec = ms ? (static_cast<kstd::uint64_t>(stats.bytes) * 1000) / ms : 0;
+    Kernel::kprintf("\n%s '%s': %u bytes (%u on the wire) in %llu ms, %llu bytes/s, %u retransmits, %u CRC errors.\n",
+                    verb, filename, static_cast<unsigned int>(stats.bytes), static_cast<unsigned int>(stats.wire_bytes),
+                    ms, bytes_per_sec, stats.retransmits, stats.crc_errors);
+    return 0;
+}
+
+int handle_rx(const ParsedCommand& command, Shell& shell_instance) {
+    if (command.arg_count < 2) {
+        shell_instance.get_console().println("Usage: rx <filename>");
+        return 1;
+    }
+    const char* filename = command.args[1];
+    Filesystem& fs = shell_instance.get_filesystem();
+
+    // Replace an existing file: the RAM FS has no truncate
+    if (fs.file_exists(filename) && fs.delete_file(filename) != FS::ErrorCode::OK) {
+        Kernel::kprintf("Error: Cannot replace file '%s'.\n", filename);
+        return 1;
+    }
+    FS::File* file_obj = nullptr;
+    FS::ErrorCode res = fs.create_file(filename);
+    if (res == FS::ErrorCode::OK) {
+        res = fs.open_file(filename, FS::OpenMode::WRITE, file_obj);
+    }
+    if (res != FS::ErrorCode::OK || !file_obj) {
+        Kernel::kprintf("Error: Cannot create file '%s' (code %d).\n", filename, static_cast<int>(res));
+        return 1;
+    }
+
+    Kernel::kprintf("Ready to receive '%s'. Start the host side now (Ctrl-C cancels).\n", filename);
+
+    // Mask IRQs so the timer tick does not print into the frame stream
+    kstd::uint64_t daif = Kernel::irq_save();
+    Xfer::Stats stats;
+    Xfer::Result result = Xfer::receive_file(*file_obj, stats);
+    Kernel::irq_restore(daif);
+
+    delete file_obj;
+    if (result != Xfer::Result::OK) {
+        fs.delete_file(filename); // Do not leave a partial file behind
+    }
+    return report_transfer("Received", filename, result, stats);
+}
+
+int handle_tx(const ParsedCommand& command, Shell& shell_instance) {
+    bool compress = command.arg_count >= 3 && kstd::kstrcmp(command.args[2], "-z") == 0;
+    if (command.arg_count < 2 || (command.arg_count >= 3 && !compress)) {
+        shell_instance.get_console().println("Usage: tx <filename> [-z]");
+        return 1;
+    }
+    const char* filename = command.args[1];
+    FS::File* file_obj = nullptr;
+    FS::ErrorCode res = shell_instance.get_filesystem().open_file(filename, FS::OpenMode::READ, file_obj);
+    if (res != FS::ErrorCode::OK || !file_obj) {
+        Kernel::kprintf("Error: Cannot open file '%s' (code %d).\n", filename, static_cast<int>(res));
+        return 1;
+    }
+
+    Kernel::kprintf("Sending '%s' (%u bytes%s). Start the host side now (Ctrl-C cancels).\n",
+                    filename, static_cast<unsigned int>(file_obj->get_size()), compress ? ", LZ4" : "");
+
+    kstd::uint64_t daif = Kernel::irq_save();
+    Xfer::Stats stats;
+    Xfer::Result result = Xfer::send_file(*file_obj, compress, stats);
+    Kernel::irq_restore(daif);
+
+    delete file_obj;
+    return report_transfer("Sent", filename, result, stats);
+}
+
+static void print_vm_stats() {
+    Mem::PageStats pages = Mem::page_stats();
+    Mem::VmStats vm = Mem::vm_stats();
+    Kernel::kprintf("Pages:   %u free of %u (4KB)\n", static_cast<unsigned int>(pages.free_pages),
+                    static_cast<unsigned int>(pages.total_pages));
+    Kernel::kprintf("vmalloc: %u areas, %u KB reserved, %u pages committed, %u lazy faults\n",
+                    static_cast<unsigned int>(vm.areas), static_cast<unsigned int>(vm.reserved_bytes / 1024),
+                    static_cast<unsigned int>(vm.committed_pages), static_cast<unsigned int>(vm.lazy_faults));
+}
+
+int handle_vmstat(const ParsedCommand& command, Shell& shell_instance) {
+    if (command.arg_count >= 2 && kstd::kstrcmp(command.args[1], "test") == 0) {
+        // Reserve 64MB, touch a few scattered pages, and check only those got committed
+        constexpr kstd::size_t RESERVE = 64 * 1024 * 1024;
+        kstd::uint8_t* area = static_cast<kstd::uint8_t*>(Mem::vreserve(RESERVE));
+        if (!area) {
+            shell_instance.get_console().println("Error: vreserve failed.");
+            return 1;
+        }
+        Mem::VmStats before = Mem::vm_stats();
+        const kstd::size_t offsets[] = { 0, 12345, RESERVE / 2, RESERVE - 1 };
+        bool ok = true;
+        for (kstd::size_t off : offsets) {
+            ok = ok && area[off] == 0; // First touch is a read: must see a zero page
+            area[off] = static_cast<kstd::uint8_t>(off | 1);
+        }
+        for (kstd::size_t off : offsets) {
+            ok = ok && area[off] == static_cast<kstd::uint8_t>(off | 1);
+        }
+        Mem::VmStats after = Mem::vm_stats();
+        Kernel::kprintf("vreserve(%u MB) at 0x%p: %u pages committed by %u faults, data %s.\n",
+                        static_cast<unsigned int>(RESERVE >> 20), area,
+                        static_cast<unsigned int>(after.committed_pages - before.committed_pages),
+                        static_cast<unsigned int>(after.lazy_faults - before.lazy_faults), ok ? "OK" : "MISMATCH");
+        Mem::vfree(area);
+        print_vm_stats();
+        return ok ? 0 : 1;
+    }
+    print_vm_stats();
+    return 0;
+}
+
+int handle_boottime(const ParsedCommand& command, Shell& shell_instance) {
+    (void)command; (void)shell_instance;
+    Trace::print_boot_report();
+    return 0;
+}
+
+int handle_initcalls(const ParsedCommand& command, Shell& shell_instance) {
+    (void)command; (void)shell_instance;
+    Init::print_report();
+    return 0;
+}
+
+int handle_irqstat(const ParsedCommand& command, Shell& shell_instance) {
+    (void)command; (void)shell_instance;
+    InterruptController* ic = get_interrupt_controller();
+    if (!ic) {
+        Kernel::kprintf("No interrupt controller.\n");
+        return 1;
+    }
+    // One count column per online CPU, like /proc/interrupts
+    kstd::uint32_t online = online_cpus();
+    Kernel::kprintf(" IRQ Prio Affinity ");
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        if (online & (1u << cpu)) Kernel::kprintf("%11s%u", "CPU", cpu);
+    }
+    Kernel::kprintf("\n");
+    for (unsigned int irq = 0; irq < MAX_IRQS; ++irq) {
+        if (!ic->has_handler(irq)) continue;
+        char affinity[16];
+        if (irq < 32) {
+            ksnprintf(affinity, sizeof(affinity), "per-CPU");
+        } else {
+            ksnprintf(affinity, sizeof(affinity), "0x%x%s", ic->affinity(irq), IrqBalance::is_pinned(irq) ? " pin" : "");
+        }
+        Kernel::kprintf("%4u 0x%02x %-8s ", irq, ic->irq_priority(irq), affinity);
+        for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+            if (online & (1u << cpu)) Kernel::kprintf("%12llu", ic->irq_count_cpu(irq, cpu));
+        }
+        Kernel::kprintf("\n");
+    }
+    InterruptStats stats = ic->stats();
+    Kernel::kprintf("Spurious: %llu, unhandled: %llu\n", stats.spurious, stats.unhandled);
+    Kernel::kprintf("Softirq timer: %llu\n", SoftIrq::run_count(SoftIrq::TIMER));
+    return 0;
+}
+
+int handle_irqbalance(const ParsedCommand& command, Shell& shell_instance) {
+    if (command.arg_count >= 2) {
+        const char* action = command.args[1];
+        if (kstd::kstrcmp(action, "on") == 0) {
+            IrqBalance::enable(true);
+        } else if (kstd::kstrcmp(action, "off") == 0) {
+            IrqBalance::enable(false);
+        } else if (kstd::kstrcmp(action, "now") == 0) {
+            Kernel::kprintf("irqbalance: %u IRQs moved.\n", IrqBalance::rebalance());
+        } else {
+            shell_instance.get_console().println("Usage: irqbalance [on|off|now]");
+            return 1;
+        }
+    }
+    Kernel::kprintf("irqbalance: %s, every %llu ms, CPUs online 0x%x.\n", IrqBalance::enabled() ? "on" : "off",
+                    IrqBalance::INTERVAL_MS, online_cpus());
+    return 0;
+}
+
+int handle_irqaffinity(const ParsedCommand& command, Shell& shell_instance) {
+    kstd::uint32_t irq = 0;
+    kstd::uint32_t mask = 0;
+    bool automatic = command.arg_count == 3 && kstd::kstrcmp(command.args[2], "auto") == 0;
+    if (command.arg_count < 2 || command.arg_count > 3 || !parse_uint(command.args[1], irq) ||
+        (command.arg_count == 3 && !automatic && !parse_cpu_list(command.args[2], mask))) {
+        shell_instance.get_console().println("Usage: irqaffinity <irq> [<cpu>[,<cpu>...]|auto]");
+        return 1;
+    }
+    InterruptController* ic = get_interrupt_controller();
+    if (!ic) {
+        Kernel::kprintf("No interrupt controller.\n");
+        return 1;
+    }
+    if (command.arg_count == 3 && !IrqBalance::pin(irq, mask)) {
+        Kernel::kprintf("irqaffinity: IRQ %u cannot be routed to CPUs 0x%x (shared IRQs only, online CPUs only).\n", irq, mask);
+        return 1;
+    }
+    Kernel::kprintf("IRQ %u: CPUs 0x%x%s\n", irq, ic->affinity(irq), IrqBalance::is_pinned(irq) ? ", pinned" : "");
+    return 0;
+}
+
+int handle_latency(const ParsedCommand& command, Shell& shell_instance) {
+    Console& con = shell_instance.get_console();
+    const char* mode = command.arg_count >= 2 ? command.args[1] : "all";
+    kstd::uint32_t samples = Trace::DEFAULT_LATENCY_SAMPLES;
+    bool irq = kstd::kstrcmp(mode, "irq") == 0;
+    bool svc = kstd::kstrcmp(mode, "svc") == 0;
+    bool ipi = kstd::kstrcmp(mode, "ipi") == 0;
+    if (kstd::kstrcmp(mode, "all") == 0) {
+        irq = svc = true;
+        ipi = num_online_cpus() > 1; // Only if the secondary cores are already up
+    }
+    if (!(irq || svc || ipi) || (command.arg_count >= 3 && !parse_uint(command.args[2], samples)) ||
+        samples == 0 || samples > Trace::MAX_LATENCY_SAMPLES) {
+        con.println("Usage: latency [irq|svc|ipi|all] [samples (max 2048)]");
+        return 1;
+    }
+
+    int result = 0;
+    if (irq && !Trace::run_irq_latency(samples)) {
+        Kernel::kprintf("latency: IRQ benchmark failed.\n");
+        result = 1;
+    }
+    if (svc) Trace::run_svc_latency(samples);
+    if (ipi && !Trace::run_ipi_latency(samples)) result = 1;
+    Kernel::kprintf("latency: done\n"); // End marker for tools/qemubench.py
+    return result;
+}
+
+// Events 'perf stat' counts besides cycles, as many as the core has counters for
+static const Arch::Arm::PmuEvent perf_stat_events[] = {
+    Arch::Arm::PmuEvent::INST_RETIRED,
+    Arch::Arm::PmuEvent::L1D_CACHE_REFILL,
+    Arch::Arm::PmuEvent::L2D_CACHE_REFILL,
+    Arch::Arm::PmuEvent::BR_MIS_PRED,
+    Arch::Arm::PmuEvent::STALL_FRONTEND,
+    Arch::Arm::PmuEvent::STALL_BACKEND,
+};
+
+// The command 'perf' or 'ftrace' runs: args[first] onwards. Null (and a message) if there is none.
+static const CommandDefinition* nested_command(const ParsedCommand& command, int first, ParsedCommand& inner) {
+    for (int i = first; i < command.arg_count; ++i) {
+        kstd::kstrcpy(inner.args[inner.arg_count++], command.args[i]);
+    }
+    const CommandDefinition* target = nullptr;
+    for (kstd::size_t i = 0; inner.arg_count > 0 && i < command_table_size; ++i) {
+        if (kstd::kstrcmp(inner.name(), command_table[i].name) == 0) target = &command_table[i];
+    }
+    if (!target || target->handler == handle_perf || target->handler == handle_ftrace) {
+        Kernel::kprintf("%s: unknown command '%s'.\n", command.name(), inner.arg_count > 0 ? inner.name() : "");
+        return nullptr;
+    }
+    return target;
+}
+
+static int perf_stat(const ParsedCommand& command, Shell& shell_instance) {
+    using Arch::Arm::Pmu;
+    ParsedCommand inner;
+    const CommandDefinition* target = nested_command(command, 2, inner);
+    if (!target) return 1;
+
+    constexpr kstd::size_t num_events = sizeof(perf_stat_events) / sizeof(perf_stat_events[0]);
+    int counters[num_events];
+    kstd::uint64_t start[num_events];
+    for (kstd::size_t i = 0; i < num_events; ++i) counters[i] = Pmu::allocate(perf_stat_events[i]);
+    for (kstd::size_t i = 0; i < num_events; ++i) start[i] = Pmu::read(counters[i]);
+    kstd::uint64_t start_ticks = Arch::RaspberryPi::GenericTimer::get_counter();
+    kstd::uint64_t start_cycles = Pmu::cycles();
+
+    int result = target->handler(inner, shell_instance);
+
+    kstd::uint64_t cycles = Pmu::cycles() - start_cycles;
+    kstd::uint64_t ticks = Arch::RaspberryPi::GenericTimer::get_counter() - start_ticks;
+    kstd::uint64_t counts[num_events];
+    for (kstd::size_t i = 0; i < num_events; ++i) counts[i] = Pmu::read(counters[i]) - start[i];
+    for (kstd::size_t i = 0; i < num_events; ++i) {
+        if (counters[i] >= 0) Pmu::release(counters[i]);
+    }
+
+    Kernel::kprintf("\nPerformance counter stats for '%s' (CPU%u):\n", inner.name(), Kernel::cpu_id());
+    Kernel::kprintf("%16llu  cycles\n", cycles);
+    for (kstd::size_t i = 0; i < num_events; ++i) {
+        const char* name = Pmu::event_name(perf_stat_events[i]);
+        if (counters[i] < 0) {
+            Kernel::kprintf("%16s  %-16s\n", Pmu::event_supported(perf_stat_events[i]) ? "<not counted>" : "<not supported>", name);
+        } else if (perf_stat_events[i] == Arch::Arm::PmuEvent::INST_RETIRED && cycles) {
+            kstd::uint64_t ipc100 = counts[i] * 100 / cycles;
+            Kernel::kprintf("%16llu  %-16s # %llu.%02llu per cycle\n", counts[i], name, ipc100 / 100, ipc100 % 100);
+        } else {
+            Kernel::kprintf("%16llu  %-16s\n", counts[i], name);
+        }
+    }
+    kstd::uint64_t freq = Arch::RaspberryPi::GenericTimer::get_timer_frequency_hz();
+    kstd::uint64_t us = freq ? ticks * 1000000 / freq : 0;
+    Kernel::kprintf("%12llu.%03llu ms elapsed\n", us / 1000, us % 1000);
+    return result;
+}
+
+// perf record [-F <hz>|-c <cycles>] <command> [args...]
+static int perf_record(const ParsedCommand& command, Shell& shell_instance) {
+    Trace::ProfileSource source = Trace::ProfileSource::TIMER;
+    kstd::uint32_t rate = Trace::PROFILE_DEFAULT_HZ;
+    int first = 2;
+    if (command.arg_count >= 4 && (kstd::kstrcmp(command.args[2], "-F") == 0 || kstd::kstrcmp(command.args[2], "-c") == 0)) {
+        if (command.args[2][1] == 'c') source = Trace::ProfileSource::CYCLES;
+        if (!parse_uint(command.args[3], rate) || rate == 0) return -1;
+        first = 4;
+    }
+    ParsedCommand inner;
+    const CommandDefinition* target = nested_command(command, first, inner);
+    if (!target) return 1;
+
+    if (!Trace::profile_start(source, rate)) {
+        Kernel::kprintf("perf: cannot start sampling (already running, or the %s is in use).\n",
+                        source == Trace::ProfileSource::TIMER ? "virtual timer" : "PMU");
+        return 1;
+    }
+    int result = target->handler(inner, shell_instance);
+    Trace::profile_stop();
+    Kernel::kprintf("perf: recorded '%s'; 'perf report' shows the profile.\n", inner.name());
+    return result;
+}
+
+int handle_perf(const ParsedCommand& command, Shell& shell_instance) {
+    const char* action = command.arg_count >= 2 ? command.args[1] : "";
+    int result = -1;
+    if (command.arg_count >= 3 && kstd::kstrcmp(action, "stat") == 0) {
+        result = perf_stat(command, shell_instance);
+    } else if (command.arg_count >= 3 && kstd::kstrcmp(action, "record") == 0) {
+        result = perf_record(command, shell_instance);
+    } else if (kstd::kstrcmp(action, "report") == 0) {
+        kstd::uint32_t entries = 20;
+        if (command.arg_count <= 3 && (command.arg_count < 3 || parse_uint(command.args[2], entries))) {
+            Trace::print_profile_report(entries);
+            result = 0;
+        }
+    }
+    if (result < 0) {
+        shell_instance.get_console().println("Usage: perf stat <command> [args...]");
+        shell_instance.get_console().println("       perf record [-F <hz>|-c <cycles>] <command> [args...]");
+        shell_instance.get_console().println("       perf report [entries]");
+        return 1;
+    }
+    return result;
+}
+
+int handle_irqsoff(const ParsedCommand& command, Shell& shell_instance) {
+    if (command.arg_count >= 2) {
+        const char* action = command.args[1];
+        if (kstd::kstrcmp(action, "on") == 0) {
+            Trace::irqsoff_enable(true);
+        } else if (kstd::kstrcmp(action, "off") == 0) {
+            Trace::irqsoff_enable(false);
+        } else if (kstd::kstrcmp(action, "reset") == 0) {
+            Trace::irqsoff_reset();
+        } else {
+            shell_instance.get_console().println("Usage: irqsoff [on|off|reset]");
+            return 1;
+        }
+    }
+    Trace::print_irqsoff_report();
+    return 0;
+}
+
+int handle_ftrace(const ParsedCommand& command, Shell& shell_instance) {
+    const char* action = command.arg_count >= 2 ? command.args[1] : "";
+    if (command.arg_count == 1) {
+        Trace::print_ftrace_status();
+        return 0;
+    }
+    if (command.arg_count == 2 && kstd::kstrcmp(action, "off") == 0) {
+        Trace::ftrace_enable(false);
+        Trace::print_ftrace_status();
+        return 0;
+    }
+    if (command.arg_count == 2 && kstd::kstrcmp(action, "on") == 0) {
+        Trace::ftrace_enable(true);
+        Trace::print_ftrace_status();
+        return 0;
+    }
+    if (command.arg_count >= 3 && kstd::kstrcmp(action, "record") == 0) {
+        ParsedCommand inner;
+        const CommandDefinition* target = nested_command(command, 2, inner);
+        if (!target) return 1;
+        Trace::ftrace_enable(true);
+        int result = target->handler(inner, shell_instance);
+        Trace::ftrace_enable(false);
+        Trace::print_ftrace_status();
+        return result;
+    }
+    if (command.arg_count == 3 && kstd::kstrcmp(action, "save") == 0) {
+        const char* filename = command.args[2];
+        Filesystem& fs = shell_instance.get_filesystem();
+        Trace::ftrace_enable(false);
+        if (fs.file_exists(filename) && fs.delete_file(filename) != FS::ErrorCode::OK) {
+            Kernel::kprintf("Error: Cannot replace file '%s'.\n", filename);
+            return 1;
+        }
+        FS::File* file_obj = nullptr;
+        FS::ErrorCode res = fs.create_file(filename);
+        if (res == FS::ErrorCode::OK) {
+            res = fs.open_file(filename, FS::OpenMode::WRITE, file_obj);
+        }
+        if (res != FS::ErrorCode::OK || !file_obj) {
+            Kernel::kprintf("Error: Cannot create file '%s' (code %d).\n", filename, static_cast<int>(res));
+            return 1;
+        }
+        bool saved = Trace::ftrace_save(*file_obj);
+        delete file_obj;
+        if (!saved) {
+            fs.delete_file(filename);
+            Kernel::kprintf("Error: Cannot write the trace to '%s' (%u bytes).\n", filename,
+                            static_cast<unsigned int>(Trace::ftrace_size()));
+            return 1;
+        }
+        Kernel::kprintf("ftrace: %u bytes written to '%s'; 'tx %s' sends it to the host.\n",
+                        static_cast<unsigned int>(Trace::ftrace_size()), filename, filename);
+        return 0;
+    }
+    shell_instance.get_console().println("Usage: ftrace [on|off]");
+    shell_instance.get_console().println("       ftrace record <command> [args...]");
+    shell_instance.get_console().println("       ftrace save <filename>");
+    return 1;
+}
+
+int handle_kexec(const ParsedCommand& command, Shell& shell_instance) {
+    bool keep = command.arg_count >= 3 && kstd::kstrcmp(command.args[2], "-k") == 0;
+    if (command.arg_count < 2 || (command.arg_count >= 3 && !keep)) {
+        shell_instance.get_console().println("Usage: kexec <image> [-k]");
+        return 1;
+    }
+    const char* filename = command.args[1];
+    FS::File* file_obj = nullptr;
+    FS::ErrorCode res = shell_instance.get_filesystem().open_file(filename, FS::OpenMode::READ, file_obj);
+    if (res != FS::ErrorCode::OK || !file_obj) {
+        Kernel::kprintf("Error: Cannot open file '%s' (code %d).\n", filename, static_cast<int>(res));
+        return 1;
+    }
+    Kexec::Result result = Kexec::load(*file_obj);
+    delete file_obj;
+    if (result != Kexec::Result::OK) {
+        Kernel::kprintf("Error: Cannot load '%s': %s.\n", filename, Kexec::result_string(result));
+        return 1;
+    }
+    Kexec::execute(keep);
+}
+
 
 // --- Command Table Definition ---
 // This table maps command strings to their handler functions and help text.
@@ -203,7 +818,22 @@ const CommandDefinition command_table[] = {
     {"echo",     handle_echo,     "Display a line of text.", "Usage: echo [text ...]"},
     {"clear",    handle_clear,    "Clear the terminal screen.", "Usage: clear"},
     {"reboot",   handle_reboot,   "Reboot the system (simulated).", "Usage: reboot"},
-    {"shutdown", handle_shutdown, "Shut down the system (simulated).", "Usage: shutdown"}
+    {"shutdown", handle_shutdown, "Shut down the system (simulated).", "Usage: shutdown"},
+    {"clock",    handle_clock,    "Show or set the ARM clock rate.", "Usage: clock [max|min|<MHz>]"},
+    {"baud",     handle_baud,     "Show/switch UART baud rate, loopback test.", "Usage: baud [<rate>|test [bytes] [rate]]"},
+    {"rx",       handle_rx,       "Receive a file from the host (kekxfer.py put).", "Usage: rx <filename>"},
+    {"tx",       handle_tx,       "Send a file to the host (kekxfer.py get).", "Usage: tx <filename> [-z]"},
+    {"vmstat",   handle_vmstat,   "Show page allocator and vmalloc usage.", "Usage: vmstat [test]"},
+    {"boottime", handle_boottime, "Show how long each boot phase took.", "Usage: boottime"},
+    {"initcalls", handle_initcalls, "List initcalls with their level, state and timing.", "Usage: initcalls"},
+    {"irqstat",  handle_irqstat,  "Show per-IRQ priorities, affinity, per-CPU counts and spurious/unhandled IRQs.", "Usage: irqstat"},
+    {"irqbalance", handle_irqbalance, "Spread shared IRQs over the CPUs by rate (starts the secondary cores).", "Usage: irqbalance [on|off|now]"},
+    {"irqaffinity", handle_irqaffinity, "Show or pin the CPUs a shared IRQ goes to.", "Usage: irqaffinity <irq> [<cpu>[,<cpu>...]|auto]"},
+    {"latency",  handle_latency,  "Measure IRQ, SVC and IPI latency (histograms).", "Usage: latency [irq|svc|ipi|all] [samples]"},
+    {"irqsoff",  handle_irqsoff,  "Trace the longest IRQs-masked sections.", "Usage: irqsoff [on|off|reset]"},
+    {"kexec",    handle_kexec,    "Warm restart into a kernel image file (-k keeps preserved RAM).", "Usage: kexec <image> [-k]"},
+    {"perf",     handle_perf,     "Count PMU events of a command, or sample and profile it.", "Usage: perf stat|record [-F <hz>|-c <cycles>] <command> [args...] | perf report [entries]"},
+    {"ftrace",   handle_ftrace,   "Trace function entries and exits of instrumented code (FTRACE_DIRS builds).", "Usage: ftrace [on|off] | ftrace record <command> [args...] | ftrace save <filename>"}
     // Add more commands here
 };
 
@@ -58,6 +58,21 @@ int handle_shutdown(const ParsedCommand& command, Shell& shell_instance);
 int handle_echo(const ParsedCommand& command, Shell& shell_instance); // Example new command
 int handle_cat(const ParsedCommand& command, Shell& shell_instance); // Example new command: print file content
 int handle_rm(const ParsedCommand& command, Shell& shell_instance); // Example new command: remove file
+int handle_clock(const ParsedCommand& command, Shell& shell_instance); // Show/set ARM clock via mailbox
+int handle_baud(const ParsedCommand& command, Shell& shell_instance); // Show/switch UART baud rate, loopback test
+int handle_rx(const ParsedCommand& command, Shell& shell_instance); // Receive a file from the host (binary)
+int handle_tx(const ParsedCommand& command, Shell& shell_instance); // Send a file to the host (binary)
+int handle_vmstat(const ParsedCommand& command, Shell& shell_instance); // Page/vmalloc usage, lazy-commit test
+int handle_boottime(const ParsedCommand& command, Shell& shell_instance); // Boot-phase timing report
+int handle_initcalls(const ParsedCommand& command, Shell& shell_instance); // Initcall states and timing
+int handle_irqstat(const ParsedCommand& command, Shell& shell_instance); // Per-IRQ, per-CPU dispatch counts
+int handle_irqbalance(const ParsedCommand& command, Shell& shell_instance); // IRQ load balancing
+int handle_irqaffinity(const ParsedCommand& command, Shell& shell_instance); // Show/pin IRQ affinity
+int handle_latency(const ParsedCommand& command, Shell& shell_instance);  // IRQ/SVC latency benchmark
+int handle_irqsoff(const ParsedCommand& command, Shell& shell_instance);  // IRQs-off tracer
+int handle_kexec(const ParsedCommand& command, Shell& shell_instance); // Warm restart into a new kernel image
+int handle_perf(const ParsedCommand& command, Shell& shell_instance); // PMU counts and sampling profiles of a command
+int handle_ftrace(const ParsedCommand& command, Shell& shell_instance); // Function entry/exit tracing
 
 
 // Array of command definitions
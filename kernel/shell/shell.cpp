@@ -5,6 +5,7 @@
 #include <kernel/editor/editor.h> // For Kernel::Editor, will be implemented in next step
 #include <lib/printf/printf.h>  // For Kernel::kprintf
 #include <kstd/cstring.h>    // For kstrlen, kstrcmp, kstrncpy
+#include <kernel/trace/boottime.h> // For Trace::boot_done (end of boot at the first prompt)
 
 namespace Kernel {
 
@@ -128,10 +129,8 @@ void Shell::execute_command(const ShellCommands::ParsedCommand& command) {
 
 void Shell::run() {
     running = true;
-    if (!filesystem_instance.file_exists("test.txt")) { // Example: ensure FS is usable
-        // filesystem_instance.create_file("welcome.txt");
-    }
 
+    Trace::boot_done();
     while (running) {
         display_prompt();
         read_command();
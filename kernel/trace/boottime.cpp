@@ -0,0 +1,95 @@
+#include "boottime.h"
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter / get_timer_frequency_hz
+#include <lib/printf/printf.h>          // For Kernel::kprintf
+
+// Written by boot.S before .bss is cleared, so it lives in .data
+extern "C" kstd::uint64_t boot_entry_ticks;
+
+namespace Kernel {
+namespace Trace {
+
+using Arch::RaspberryPi::GenericTimer;
+
+static BootPhase phases[MAX_BOOT_PHASES];
+static kstd::size_t phase_count = 0;
+static bool running = false;
+
+static void close_running(kstd::uint64_t now) {
+    if (running) {
+        phases[phase_count - 1].end = now;
+        running = false;
+    }
+}
+
+static void open_phase(const char* name, kstd::uint64_t start, bool interactive) {
+    if (phase_count >= MAX_BOOT_PHASES) return;
+    phases[phase_count].name = name;
+    phases[phase_count].start = start;
+    phases[phase_count].end = start;
+    phases[phase_count].interactive = interactive;
+    ++phase_count;
+    running = true;
+}
+
+void boot_phase(const char* name, bool interactive) {
+    kstd::uint64_t now = GenericTimer::get_counter();
+    if (phase_count == 0 && boot_entry_ticks != 0) {
+        open_phase("entry (boot.S, start.S)", boot_entry_ticks, false);
+    }
+    close_running(now);
+    open_phase(name, now, interactive);
+}
+
+void boot_done() {
+    close_running(GenericTimer::get_counter());
+}
+
+kstd::uint64_t boot_start_ticks() {
+    return boot_entry_ticks;
+}
+
+kstd::size_t boot_phases(const BootPhase** out) {
+    if (out) *out = phases;
+    return phase_count;
+}
+
+// Format ticks as milliseconds with microsecond resolution
+static const char* format_ms(char* buf, kstd::size_t size, kstd::uint64_t ticks, kstd::uint64_t freq) {
+    kstd::uint64_t us = ticks * 1000000 / freq;
+    Kernel::ksnprintf(buf, size, "%llu.%03u", us / 1000, static_cast<unsigned int>(us % 1000));
+    return buf;
+}
+
+void print_boot_report() {
+    kstd::uint64_t freq = GenericTimer::get_timer_frequency_hz();
+    if (freq == 0 || phase_count == 0) {
+        Kernel::kprintf("No boot phases recorded.\n");
+        return;
+    }
+    kstd::uint64_t origin = boot_entry_ticks ? boot_entry_ticks : phases[0].start;
+    kstd::uint64_t boot_ticks = 0;
+    for (kstd::size_t i = 0; i < phase_count; ++i) {
+        if (!phases[i].interactive) boot_ticks += phases[i].end - phases[i].start;
+    }
+
+    char start_buf[24], duration_buf[24];
+    Kernel::kprintf("Firmware (counter reset to _start): %s ms\n", format_ms(start_buf, sizeof(start_buf), origin, freq));
+    Kernel::kprintf("%-26s %12s %14s  Share\n", "Phase", "Start (ms)", "Duration (ms)");
+    for (kstd::size_t i = 0; i < phase_count; ++i) {
+        const BootPhase& p = phases[i];
+        kstd::uint64_t duration = p.end - p.start;
+        Kernel::kprintf("%-26s %12s %14s  ", p.name,
+                        format_ms(start_buf, sizeof(start_buf), p.start - origin, freq),
+                        format_ms(duration_buf, sizeof(duration_buf), duration, freq));
+        if (p.interactive) {
+            Kernel::kprintf("(waiting for input)\n");
+        } else {
+            Kernel::kprintf("%3llu%%\n", boot_ticks ? duration * 100 / boot_ticks : 0);
+        }
+    }
+    Kernel::kprintf("Boot to shell prompt: %s ms (excluding input), counter %llu Hz\n",
+                    format_ms(start_buf, sizeof(start_buf), boot_ticks, freq), freq);
+}
+
+} // namespace Trace
+} // namespace Kernel
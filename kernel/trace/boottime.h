@@ -0,0 +1,42 @@
+#ifndef KERNEL_TRACE_BOOTTIME_H
+#define KERNEL_TRACE_BOOTTIME_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint64_t
+
+namespace Kernel {
+namespace Trace {
+
+// Boot-phase profiler. boot.S stores CNTPCT_EL0 at its first instruction; kernel_main then
+// marks the start of every init phase. Each mark ends the running phase, so the phases tile
+// the whole boot from _start to the first shell prompt. Records live in a static table
+// (usable before the heap and MMU are up) and are reported by the 'boottime' command.
+
+constexpr kstd::size_t MAX_BOOT_PHASES = 24;
+
+struct BootPhase {
+    const char* name;
+    kstd::uint64_t start; // CNTPCT_EL0 ticks
+    kstd::uint64_t end;
+    bool interactive;     // Waits for the user; not counted as boot time
+};
+
+// End the running phase and start 'name'. The first call also records the assembly entry
+// (_start up to here) as a phase of its own.
+void boot_phase(const char* name, bool interactive = false);
+
+// End the running phase. Called right before the first shell prompt.
+void boot_done();
+
+// CNTPCT_EL0 at the first instruction of _start (time spent in the firmware before that).
+kstd::uint64_t boot_start_ticks();
+
+kstd::size_t boot_phases(const BootPhase** phases);
+
+// Table of phases with offsets and durations in milliseconds
+void print_boot_report();
+
+} // namespace Trace
+} // namespace Kernel
+
+#endif // KERNEL_TRACE_BOOTTIME_H
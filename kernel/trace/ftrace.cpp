@@ -0,0 +1,161 @@
+#include "ftrace.h"
+#include <kernel/smp.h>                   // For smp_call_function, online_cpus, cpu_id
+#include <kernel/filesystem/file.h>       // For FS::File (ftrace_save)
+#include <arch/arm/core/pmu.h>            // For Pmu::cycles (anchors)
+#include <arch/arm/peripherals/timer.h>   // For GenericTimer::get_counter / get_timer_frequency_hz
+#include <lib/printf/printf.h>            // For Kernel::kprintf
+
+namespace Kernel {
+namespace Trace {
+
+using Arch::Arm::Pmu;
+using Arch::RaspberryPi::GenericTimer;
+
+static_assert((FTRACE_RING_SIZE & (FTRACE_RING_SIZE - 1)) == 0, "FTRACE_RING_SIZE must be a power of two");
+
+struct CpuTrace {
+    FtraceEvent ring[FTRACE_RING_SIZE];
+    kstd::uint64_t head; // Events ever claimed; slot head % FTRACE_RING_SIZE is next
+    kstd::uint64_t start_cycles;
+    kstd::uint64_t start_ticks;
+    kstd::uint64_t stop_cycles;
+    kstd::uint64_t stop_ticks;
+};
+
+static CpuTrace cpu_trace[MAX_CPUS];
+static volatile bool tracing = false;
+static kstd::uint32_t traced_cpus = 0; // Anchored at the last enable
+
+// The hooks run on every call of instrumented code and must not be instrumented themselves
+#define FTRACE_HOOK __attribute__((no_instrument_function))
+
+FTRACE_HOOK static inline void record(void* function, kstd::uint64_t exit) {
+    if (!tracing) return;
+    CpuTrace& cpu = cpu_trace[cpu_id()];
+    // Only this CPU writes its ring; the atomic add keeps an IRQ that lands here off our slot
+    kstd::uint64_t slot = __atomic_fetch_add(&cpu.head, 1, __ATOMIC_RELAXED) & (FTRACE_RING_SIZE - 1);
+    kstd::uint64_t cycles;
+    asm volatile("mrs %0, pmccntr_el0" : "=r"(cycles)); // No ISB: too costly on every call
+    cpu.ring[slot].cycles = cycles;
+    cpu.ring[slot].function = reinterpret_cast<kstd::uintptr_t>(function) | exit;
+}
+
+// Run on each online CPU through smp_call_function
+static void start_on_cpu(void* arg) {
+    (void)arg;
+    CpuTrace& cpu = cpu_trace[cpu_id()];
+    cpu.head = 0;
+    cpu.start_ticks = GenericTimer::get_counter();
+    cpu.start_cycles = Pmu::cycles();
+    cpu.stop_cycles = cpu.start_cycles;
+    cpu.stop_ticks = cpu.start_ticks;
+}
+
+static void stop_on_cpu(void* arg) {
+    (void)arg;
+    CpuTrace& cpu = cpu_trace[cpu_id()];
+    cpu.stop_ticks = GenericTimer::get_counter();
+    cpu.stop_cycles = Pmu::cycles();
+}
+
+static kstd::uint32_t event_count(const CpuTrace& cpu) {
+    return static_cast<kstd::uint32_t>(cpu.head < FTRACE_RING_SIZE ? cpu.head : FTRACE_RING_SIZE);
+}
+
+void ftrace_enable(bool enable) {
+    if (enable == tracing) return;
+    kstd::uint32_t online = online_cpus();
+    if (enable) {
+        // Anchor while still off, so no CPU records before its ring is cleared
+        traced_cpus = 0;
+        for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+            if ((online & (1u << cpu)) && smp_call_function(cpu, start_on_cpu, nullptr, true)) {
+                traced_cpus |= 1u << cpu;
+            }
+        }
+        tracing = true;
+        asm volatile("dsb ish" ::: "memory");
+        return;
+    }
+    tracing = false;
+    asm volatile("dsb ish" ::: "memory");
+    // Waits for each CPU, so every record it made is visible here afterwards
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        if (traced_cpus & (1u << cpu)) smp_call_function(cpu, stop_on_cpu, nullptr, true);
+    }
+}
+
+bool ftrace_enabled() {
+    return tracing;
+}
+
+kstd::size_t ftrace_size() {
+    kstd::size_t size = sizeof(FtraceFileHeader) + MAX_CPUS * sizeof(FtraceCpuHeader);
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        if (traced_cpus & (1u << cpu)) size += event_count(cpu_trace[cpu]) * sizeof(FtraceEvent);
+    }
+    return size;
+}
+
+static bool write_all(FS::File& file, const void* data, kstd::size_t size) {
+    kstd::size_t written = 0;
+    return file.write(data, size, written) == FS::ErrorCode::OK && written == size;
+}
+
+bool ftrace_save(FS::File& file) {
+    if (tracing) return false;
+    file.reserve(ftrace_size()); // One allocation up front; write() grows the file otherwise
+
+    FtraceFileHeader header = { FTRACE_MAGIC, FTRACE_VERSION, MAX_CPUS, GenericTimer::get_timer_frequency_hz() };
+    if (!write_all(file, &header, sizeof(header))) return false;
+    for (unsigned int i = 0; i < MAX_CPUS; ++i) {
+        const CpuTrace& cpu = cpu_trace[i];
+        kstd::uint32_t count = event_count(cpu);
+        FtraceCpuHeader cpu_header = {
+            cpu.start_cycles, cpu.start_ticks, cpu.stop_cycles, cpu.stop_ticks,
+            count, static_cast<kstd::uint32_t>(cpu.head - count),
+        };
+        if (!(traced_cpus & (1u << i))) cpu_header = FtraceCpuHeader{};
+        if (!write_all(file, &cpu_header, sizeof(cpu_header))) return false;
+    }
+    for (unsigned int i = 0; i < MAX_CPUS; ++i) {
+        const CpuTrace& cpu = cpu_trace[i];
+        if (!(traced_cpus & (1u << i))) continue;
+        kstd::uint32_t count = event_count(cpu);
+        // Oldest first: after a wrap the oldest event sits at head, the ring is written in two parts
+        kstd::size_t first = static_cast<kstd::size_t>(cpu.head - count) & (FTRACE_RING_SIZE - 1);
+        kstd::size_t part = count < FTRACE_RING_SIZE - first ? count : FTRACE_RING_SIZE - first;
+        if (!write_all(file, &cpu.ring[first], part * sizeof(FtraceEvent))) return false;
+        if (count > part && !write_all(file, &cpu.ring[0], (count - part) * sizeof(FtraceEvent))) return false;
+    }
+    return true;
+}
+
+void print_ftrace_status() {
+    kprintf("ftrace: %s, %u events per CPU\n", tracing ? "on" : "off", static_cast<unsigned int>(FTRACE_RING_SIZE));
+    kstd::uint64_t total = 0;
+    for (unsigned int i = 0; i < MAX_CPUS; ++i) {
+        if (!(traced_cpus & (1u << i))) continue;
+        const CpuTrace& cpu = cpu_trace[i];
+        kstd::uint32_t count = event_count(cpu);
+        kprintf("  CPU%u: %8u events, %8llu lost\n", i, count, cpu.head - count);
+        total += cpu.head;
+    }
+    if (traced_cpus && total == 0) {
+        kprintf("  Nothing recorded: build with FTRACE_DIRS to instrument code (see Makefile).\n");
+    }
+}
+
+} // namespace Trace
+} // namespace Kernel
+
+// Called by -finstrument-functions code on function entry and exit
+extern "C" FTRACE_HOOK void __cyg_profile_func_enter(void* this_fn, void* call_site) {
+    (void)call_site;
+    Kernel::Trace::record(this_fn, 0);
+}
+
+extern "C" FTRACE_HOOK void __cyg_profile_func_exit(void* this_fn, void* call_site) {
+    (void)call_site;
+    Kernel::Trace::record(this_fn, Kernel::Trace::FTRACE_EXIT);
+}
@@ -0,0 +1,76 @@
+#ifndef KERNEL_TRACE_FTRACE_H
+#define KERNEL_TRACE_FTRACE_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint64_t
+
+namespace Kernel {
+namespace FS { class File; }
+
+namespace Trace {
+
+// Function-entry tracer ('ftrace' command). Code built with -finstrument-functions (opt-in,
+// per directory: make FTRACE_DIRS="kernel/filesystem kernel/shell") calls the
+// __cyg_profile_func_enter/exit hooks here on every function entry and exit. While enabled,
+// each call is recorded with the CPU's cycle counter (PMCCNTR_EL0) into a ring of
+// FTRACE_RING_SIZE events per CPU. Only the CPU itself writes its ring; a slot is claimed with
+// one atomic add, so an IRQ handler interrupting a record takes the next slot. When a ring is
+// full the oldest events are overwritten and counted as lost.
+//
+// Enabling and disabling take an anchor on every online CPU, the cycle counter together with
+// CNTPCT_EL0, so the host can put all CPUs on one timeline (tools/ftrace2json.py). Cycles
+// stop in WFI: only time a CPU spent running converts exactly.
+//
+// ftrace_save() writes the binary trace to a file; the host fetches it with 'tx' and
+// tools/kekxfer.py. Little endian:
+//   FtraceFileHeader
+//   FtraceCpuHeader, MAX_CPUS times
+//   FtraceEvent, event_count times for CPU 0, then for CPU 1, ..., each CPU's oldest first
+
+constexpr kstd::size_t   FTRACE_RING_SIZE = 8192; // Events per CPU, a power of two
+constexpr kstd::uint32_t FTRACE_MAGIC     = 0x5254464B; // "KFTR"
+constexpr kstd::uint16_t FTRACE_VERSION   = 1;
+constexpr kstd::uint64_t FTRACE_EXIT      = 1; // Set in FtraceEvent::function for an exit
+
+struct FtraceFileHeader {
+    kstd::uint32_t magic;
+    kstd::uint16_t version;
+    kstd::uint16_t num_cpus;
+    kstd::uint64_t timer_hz; // CNTFRQ_EL0
+};
+
+struct FtraceCpuHeader {
+    kstd::uint64_t start_cycles; // Anchors: cycle counter and CNTPCT_EL0 read together
+    kstd::uint64_t start_ticks;
+    kstd::uint64_t stop_cycles;
+    kstd::uint64_t stop_ticks;
+    kstd::uint32_t event_count;
+    kstd::uint32_t lost; // Overwritten because the ring was full
+};
+
+struct FtraceEvent {
+    kstd::uint64_t cycles;
+    kstd::uint64_t function; // Address of the function, | FTRACE_EXIT on its exit
+};
+
+static_assert(sizeof(FtraceFileHeader) == 16, "FtraceFileHeader is part of the file format");
+static_assert(sizeof(FtraceCpuHeader) == 40, "FtraceCpuHeader is part of the file format");
+static_assert(sizeof(FtraceEvent) == 16, "FtraceEvent is part of the file format");
+
+// Enabling discards the previous trace
+void ftrace_enable(bool enable);
+bool ftrace_enabled();
+
+// Bytes ftrace_save() writes for the current trace
+kstd::size_t ftrace_size();
+
+// Write the trace to 'file' (opened for writing). Not while enabled.
+bool ftrace_save(FS::File& file);
+
+// Per-CPU event counts, and a hint if nothing was recorded
+void print_ftrace_status();
+
+} // namespace Trace
+} // namespace Kernel
+
+#endif // KERNEL_TRACE_FTRACE_H
@@ -0,0 +1,162 @@
+#include "irqsoff.h"
+#include <kernel/irqflags.h>            // For irqsoff_begin/end declarations, DAIF_I
+#include <kernel/smp.h>                 // For MAX_CPUS, cpu_id
+#include <kernel/spinlock.h>            // For Spinlock (path table shared by all cores)
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter / get_timer_frequency_hz
+#include <lib/printf/printf.h>          // For Kernel::kprintf
+
+namespace Kernel {
+namespace Trace {
+
+using Arch::RaspberryPi::GenericTimer;
+
+volatile bool irqsoff_tracing = false;
+
+// Each CPU's open section, if its IRQs are masked. Only touched by that CPU with IRQs masked
+// (enable/reset close them all).
+struct Section {
+    bool open;
+    kstd::uint64_t start;
+    kstd::uintptr_t pc;
+};
+static Section sections[MAX_CPUS];
+
+// Guarded by paths_lock
+static IrqsOffPath paths[MAX_IRQSOFF_PATHS];
+static kstd::uint64_t section_count = 0;
+static kstd::uint64_t dropped = 0; // Sections of paths that did not make the table
+static Spinlock paths_lock;
+
+// The tracer's own critical sections must not be traced
+static inline kstd::uint64_t raw_irq_save() {
+    kstd::uint64_t daif;
+    asm volatile("mrs %0, daif" : "=r"(daif));
+    asm volatile("msr daifset, #2" ::: "memory");
+    return daif;
+}
+
+static inline void raw_irq_restore(kstd::uint64_t daif) {
+    asm volatile("msr daif, %0" : : "r"(daif) : "memory");
+}
+
+// Called with IRQs masked and paths_lock held
+static void record(kstd::uintptr_t start_pc, kstd::uintptr_t end_pc, kstd::uint64_t ticks) {
+    section_count++;
+    // A new path takes a free slot, or evicts the one with the shortest worst case
+    IrqsOffPath* victim = nullptr;
+    for (IrqsOffPath& path : paths) {
+        if (!path.count) {
+            if (!victim || victim->count) victim = &path;
+        } else if (path.start_pc == start_pc && path.end_pc == end_pc) {
+            path.count++;
+            path.total_ticks += ticks;
+            if (ticks > path.max_ticks) path.max_ticks = ticks;
+            return;
+        } else if (!victim || (victim->count && path.max_ticks < victim->max_ticks)) {
+            victim = &path;
+        }
+    }
+    if (victim->count) {
+        if (ticks <= victim->max_ticks) {
+            dropped++;
+            return;
+        }
+        dropped += victim->count;
+    }
+    *victim = { start_pc, end_pc, 1, ticks, ticks };
+}
+
+void irqsoff_begin(kstd::uintptr_t pc) {
+    irqsoff_begin_at(GenericTimer::get_counter(), pc);
+}
+
+void irqsoff_begin_at(kstd::uint64_t entry_ticks, kstd::uintptr_t pc) {
+    Section& section = sections[cpu_id()];
+    if (section.open) return; // Already inside a masked section
+    section.open = true;
+    section.start = entry_ticks;
+    section.pc = pc;
+}
+
+void irqsoff_end(kstd::uintptr_t pc) {
+    Section& section = sections[cpu_id()];
+    if (!section.open) return;
+    kstd::uint64_t ticks = GenericTimer::get_counter() - section.start;
+    section.open = false;
+    paths_lock.lock(); // IRQs are still masked here
+    record(section.pc, pc, ticks);
+    paths_lock.unlock();
+}
+
+static void close_sections() {
+    for (Section& section : sections) section.open = false;
+}
+
+void irqsoff_enable(bool enable) {
+    kstd::uint64_t daif = raw_irq_save();
+    irqsoff_tracing = enable;
+    close_sections(); // Only sections that start from here on are complete
+    raw_irq_restore(daif);
+}
+
+bool irqsoff_enabled() {
+    return irqsoff_tracing;
+}
+
+void irqsoff_reset() {
+    kstd::uint64_t daif = raw_irq_save();
+    paths_lock.lock();
+    for (IrqsOffPath& path : paths) path = { 0, 0, 0, 0, 0 };
+    section_count = 0;
+    dropped = 0;
+    close_sections();
+    paths_lock.unlock();
+    raw_irq_restore(daif);
+}
+
+kstd::size_t irqsoff_paths(IrqsOffPath* out, kstd::size_t max) {
+    kstd::size_t count = 0;
+    kstd::uint64_t daif = raw_irq_save();
+    paths_lock.lock();
+    for (const IrqsOffPath& path : paths) {
+        if (path.count && count < max) out[count++] = path;
+    }
+    paths_lock.unlock();
+    raw_irq_restore(daif);
+
+    // Longest worst case first (insertion sort, at most MAX_IRQSOFF_PATHS entries)
+    for (kstd::size_t i = 1; i < count; ++i) {
+        IrqsOffPath path = out[i];
+        kstd::size_t j = i;
+        for (; j > 0 && out[j - 1].max_ticks < path.max_ticks; --j) out[j] = out[j - 1];
+        out[j] = path;
+    }
+    return count;
+}
+
+static kstd::uint64_t ticks_to_ns(kstd::uint64_t ticks, kstd::uint64_t freq) {
+    return ticks * 1000000000ull / freq;
+}
+
+void print_irqsoff_report() {
+    kstd::uint64_t freq = GenericTimer::get_timer_frequency_hz();
+    IrqsOffPath sorted[MAX_IRQSOFF_PATHS];
+    kstd::size_t count = irqsoff_paths(sorted, MAX_IRQSOFF_PATHS);
+
+    Kernel::kprintf("irqsoff: tracing %s, %llu sections, %llu outside the table.\n",
+                    irqsoff_tracing ? "on" : "off", section_count, dropped);
+    if (count == 0 || freq == 0) return;
+
+    Kernel::kprintf("%12s %12s %10s  %-18s %-18s\n", "Max (us)", "Avg (us)", "Count", "Masked at", "Unmasked at");
+    for (kstd::size_t i = 0; i < count; ++i) {
+        const IrqsOffPath& p = sorted[i];
+        kstd::uint64_t max_ns = ticks_to_ns(p.max_ticks, freq);
+        kstd::uint64_t avg_ns = ticks_to_ns(p.total_ticks / p.count, freq);
+        Kernel::kprintf("%8llu.%03llu %8llu.%03llu %10llu  0x%016llx 0x%016llx\n",
+                        max_ns / 1000, max_ns % 1000, avg_ns / 1000, avg_ns % 1000, p.count,
+                        static_cast<kstd::uint64_t>(p.start_pc), static_cast<kstd::uint64_t>(p.end_pc));
+    }
+}
+
+} // namespace Trace
+} // namespace Kernel
@@ -0,0 +1,44 @@
+#ifndef KERNEL_TRACE_IRQSOFF_H
+#define KERNEL_TRACE_IRQSOFF_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint64_t, kstd::uintptr_t
+
+namespace Kernel {
+namespace Trace {
+
+// IRQs-off tracer ('irqsoff' command). While enabled, every stretch of code that runs with
+// IRQs masked is timed (CNTPCT_EL0) from the instruction that masked them to the one that
+// unmasks them: the irq_save/irq_restore/irq_disable/irq_enable helpers (kernel/irqflags.h)
+// and exception handlers, which count from their vector entry.
+//
+// Sections are grouped by their (start PC, end PC) pair; the MAX_IRQSOFF_PATHS pairs with
+// the longest worst case are kept. PCs resolve against build/kernel8.list or with addr2line.
+
+constexpr kstd::size_t MAX_IRQSOFF_PATHS = 16;
+
+struct IrqsOffPath {
+    kstd::uintptr_t start_pc;
+    kstd::uintptr_t end_pc;
+    kstd::uint64_t count;
+    kstd::uint64_t max_ticks;
+    kstd::uint64_t total_ticks;
+};
+
+void irqsoff_enable(bool enable);
+bool irqsoff_enabled();
+void irqsoff_reset();
+
+// Exception entry: IRQs were masked by the CPU at 'entry_ticks' (from the trap frame)
+void irqsoff_begin_at(kstd::uint64_t entry_ticks, kstd::uintptr_t pc);
+
+// Recorded paths, longest first. Returns the number written to 'out'.
+kstd::size_t irqsoff_paths(IrqsOffPath* out, kstd::size_t max);
+
+// Longest sections first, with counts and averages in microseconds
+void print_irqsoff_report();
+
+} // namespace Trace
+} // namespace Kernel
+
+#endif // KERNEL_TRACE_IRQSOFF_H
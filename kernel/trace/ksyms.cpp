@@ -0,0 +1,50 @@
+#include "ksyms.h"
+
+namespace Kernel {
+namespace Trace {
+
+// Layout written by tools/gensyms.py
+struct KernelSymbol {
+    kstd::uint64_t addr;
+    kstd::uint32_t size;
+    kstd::uint32_t name; // Offset into ksyms_names
+};
+static_assert(sizeof(KernelSymbol) == 16, "KernelSymbol must match tools/gensyms.py");
+
+extern "C" const kstd::uint64_t ksyms_count;
+extern "C" const KernelSymbol ksyms_table[];
+extern "C" const char ksyms_names[];
+
+int ksym_find(kstd::uintptr_t addr) {
+    // Last symbol starting at or below addr
+    kstd::uint64_t low = 0;
+    kstd::uint64_t high = ksyms_count;
+    while (low < high) {
+        kstd::uint64_t mid = low + (high - low) / 2;
+        if (ksyms_table[mid].addr <= addr) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) return -1;
+    const KernelSymbol& symbol = ksyms_table[low - 1];
+    return addr - symbol.addr < symbol.size ? static_cast<int>(low - 1) : -1;
+}
+
+const char* ksym_name(int index) {
+    if (index < 0 || static_cast<kstd::uint64_t>(index) >= ksyms_count) return "[unknown]";
+    return &ksyms_names[ksyms_table[index].name];
+}
+
+kstd::uintptr_t ksym_addr(int index) {
+    if (index < 0 || static_cast<kstd::uint64_t>(index) >= ksyms_count) return 0;
+    return ksyms_table[index].addr;
+}
+
+unsigned int ksym_count() {
+    return static_cast<unsigned int>(ksyms_count);
+}
+
+} // namespace Trace
+} // namespace Kernel
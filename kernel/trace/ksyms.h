@@ -0,0 +1,22 @@
+#ifndef KERNEL_TRACE_KSYMS_H
+#define KERNEL_TRACE_KSYMS_H
+
+#include <kstd/cstdint.h>
+
+namespace Kernel {
+namespace Trace {
+
+// Symbol table of the kernel's own functions, sorted by address. tools/gensyms.py generates it
+// from a first link of the image and the Makefile links it into the second one (.rodata, after
+// all code, so no function moves). C++ names are demangled without their parameter list.
+
+// Index of the function containing addr, or -1
+int ksym_find(kstd::uintptr_t addr);
+const char* ksym_name(int index);  // "[unknown]" for -1
+kstd::uintptr_t ksym_addr(int index);
+unsigned int ksym_count();
+
+} // namespace Trace
+} // namespace Kernel
+
+#endif // KERNEL_TRACE_KSYMS_H
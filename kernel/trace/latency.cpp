@@ -0,0 +1,217 @@
+#include "latency.h"
+#include <kernel/interrupt.h>           // For get_interrupt_controller, irq_entry_ticks, IRQ_PRIORITY_HIGH
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter / get_timer_frequency_hz
+#include <kernel/smp.h>                 // For smp_call_function, online_cpus
+#include <lib/printf/printf.h>          // For Kernel::kprintf
+
+namespace Kernel {
+namespace Trace {
+
+using Arch::RaspberryPi::GenericTimer;
+
+constexpr unsigned int VIRTUAL_TIMER_IRQ = 27;   // PPI: CNTV, EL1 virtual timer
+constexpr kstd::uint64_t CNTV_CTL_ENABLE = 1;
+constexpr kstd::uint64_t CNTV_CTL_IMASK  = 2;
+constexpr unsigned int MIN_DELAY_US      = 20;   // Deadline distance, varied so samples do not
+constexpr unsigned int MAX_DELAY_US      = 200;  // lock onto the tick or the UART
+constexpr unsigned int HISTOGRAM_BUCKETS = 32;   // log2(ns)
+constexpr unsigned int HISTOGRAM_WIDTH   = 40;
+
+// Samples in counter ticks, one row per series of the running benchmark
+static kstd::uint32_t series[3][MAX_LATENCY_SAMPLES];
+
+static volatile bool sample_taken = false;
+static volatile kstd::uint64_t sample_vector = 0;
+static volatile kstd::uint64_t sample_handler = 0;
+
+static inline kstd::uint64_t virtual_counter() {
+    kstd::uint64_t cntvct;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(cntvct) : : "memory");
+    return cntvct;
+}
+
+static inline void virtual_timer_control(kstd::uint64_t ctl) {
+    asm volatile("msr cntv_ctl_el0, %0; isb" : : "r"(ctl) : "memory");
+}
+
+static void latency_timer_irq(unsigned int irq_num, void* context) {
+    (void)irq_num; (void)context;
+    sample_handler = GenericTimer::get_counter();
+    sample_vector = Kernel::irq_entry_ticks();
+    virtual_timer_control(CNTV_CTL_IMASK); // Level-triggered: drop the line before the EOI
+    sample_taken = true;
+}
+
+static void latency_ipi_call(void* arg) {
+    (void)arg;
+    sample_handler = GenericTimer::get_counter();
+    sample_vector = Kernel::irq_entry_ticks(); // The target's own entry time
+}
+
+static inline kstd::uint64_t svc_probe() {
+    register kstd::uint64_t x0 asm("x0");
+    asm volatile("svc %1" : "=r"(x0) : "i"(SVC_LATENCY_PROBE) : "memory");
+    return x0;
+}
+
+static kstd::uint32_t ticks_since(kstd::uint64_t stamp, kstd::uint64_t origin) {
+    // The physical/virtual offset is read one tick apart: clamp instead of wrapping
+    return stamp > origin ? static_cast<kstd::uint32_t>(stamp - origin) : 0;
+}
+
+static kstd::uint64_t ticks_to_ns(kstd::uint64_t ticks, kstd::uint64_t freq) {
+    return ticks * 1000000000ull / freq;
+}
+
+static void sort(kstd::uint32_t* values, kstd::size_t count) {
+    // Shell sort (Ciura gaps): no recursion, no allocation, fast enough for a few thousand
+    static const kstd::size_t gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+    for (kstd::size_t gap : gaps) {
+        for (kstd::size_t i = gap; i < count; ++i) {
+            kstd::uint32_t value = values[i];
+            kstd::size_t j = i;
+            for (; j >= gap && values[j - gap] > value; j -= gap) {
+                values[j] = values[j - gap];
+            }
+            values[j] = value;
+        }
+    }
+}
+
+static void report(const char* name, kstd::uint32_t* ticks, kstd::size_t count, kstd::uint64_t freq) {
+    sort(ticks, count);
+    Kernel::kprintf("%-16s min %8llu  p50 %8llu  p99 %8llu  max %8llu ns\n", name,
+                    ticks_to_ns(ticks[0], freq), ticks_to_ns(ticks[(count - 1) * 50 / 100], freq),
+                    ticks_to_ns(ticks[(count - 1) * 99 / 100], freq), ticks_to_ns(ticks[count - 1], freq));
+
+    kstd::uint32_t buckets[HISTOGRAM_BUCKETS] = {};
+    kstd::uint32_t largest = 0;
+    for (kstd::size_t i = 0; i < count; ++i) {
+        kstd::uint64_t ns = ticks_to_ns(ticks[i], freq);
+        unsigned int bucket = ns ? 63 - static_cast<unsigned int>(__builtin_clzll(ns)) : 0;
+        if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+        if (++buckets[bucket] > largest) largest = buckets[bucket];
+    }
+    for (unsigned int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        if (!buckets[b]) continue;
+        char bar[HISTOGRAM_WIDTH + 1];
+        unsigned int width = (buckets[b] * HISTOGRAM_WIDTH + largest - 1) / largest;
+        for (unsigned int i = 0; i < width; ++i) bar[i] = '#';
+        bar[width] = '\0';
+        Kernel::kprintf("  %10llu+ ns %6u %s\n", 1ull << b, buckets[b], bar);
+    }
+}
+
+static kstd::size_t clamp_samples(kstd::size_t samples) {
+    if (samples == 0) return DEFAULT_LATENCY_SAMPLES;
+    return samples > MAX_LATENCY_SAMPLES ? MAX_LATENCY_SAMPLES : samples;
+}
+
+bool run_irq_latency(kstd::size_t samples) {
+    samples = clamp_samples(samples);
+    InterruptController* ic = get_interrupt_controller();
+    kstd::uint64_t freq = GenericTimer::get_timer_frequency_hz();
+    if (!ic || freq == 0) return false;
+
+    virtual_timer_control(CNTV_CTL_IMASK);
+    if (!ic->register_handler(VIRTUAL_TIMER_IRQ, latency_timer_irq, nullptr, IRQ_PRIORITY_HIGH)) {
+        return false;
+    }
+    ic->enable_irq(VIRTUAL_TIMER_IRQ);
+
+    // Deadlines are set on the virtual counter and measured on the physical one
+    kstd::uint64_t physical = GenericTimer::get_counter();
+    kstd::uint64_t offset = physical - virtual_counter();
+    kstd::uint64_t timeout = freq / 10;
+    kstd::uint32_t rng = static_cast<kstd::uint32_t>(physical) | 1;
+
+    Kernel::kprintf("IRQ latency: %u samples, counter %llu Hz (%llu ns per tick)\n",
+                    static_cast<unsigned int>(samples), freq, ticks_to_ns(1, freq));
+    bool ok = true;
+    for (kstd::size_t i = 0; i < samples; ++i) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; // xorshift32
+        kstd::uint64_t delay_us = MIN_DELAY_US + rng % (MAX_DELAY_US - MIN_DELAY_US + 1);
+
+        sample_taken = false;
+        kstd::uint64_t deadline = virtual_counter() + delay_us * freq / 1000000;
+        asm volatile("msr cntv_cval_el0, %0" : : "r"(deadline) : "memory");
+        virtual_timer_control(CNTV_CTL_ENABLE);
+
+        kstd::uint64_t start = GenericTimer::get_counter();
+        while (!sample_taken) {
+            if (GenericTimer::get_counter() - start > timeout) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) break;
+
+        deadline += offset;
+        series[0][i] = ticks_since(sample_vector, deadline);
+        series[1][i] = ticks_since(sample_handler, deadline);
+        series[2][i] = ticks_since(ic->irq_eoi_ticks(VIRTUAL_TIMER_IRQ), deadline);
+    }
+
+    virtual_timer_control(CNTV_CTL_IMASK);
+    ic->disable_irq(VIRTUAL_TIMER_IRQ);
+    ic->unregister_handler(VIRTUAL_TIMER_IRQ);
+    if (!ok) {
+        Kernel::kprintf("IRQ latency: timer IRQ %u did not arrive.\n", VIRTUAL_TIMER_IRQ);
+        return false;
+    }
+
+    report("irq vector", series[0], samples, freq);
+    report("irq handler", series[1], samples, freq);
+    report("irq eoi", series[2], samples, freq);
+    return true;
+}
+
+void run_svc_latency(kstd::size_t samples) {
+    samples = clamp_samples(samples);
+    kstd::uint64_t freq = GenericTimer::get_timer_frequency_hz();
+    if (freq == 0) return;
+
+    Kernel::kprintf("SVC latency: %u samples\n", static_cast<unsigned int>(samples));
+    for (kstd::size_t i = 0; i < samples; ++i) {
+        kstd::uint64_t start = GenericTimer::get_counter();
+        kstd::uint64_t entry = svc_probe();
+        kstd::uint64_t end = GenericTimer::get_counter();
+        series[0][i] = ticks_since(entry, start);
+        series[1][i] = ticks_since(end, start);
+    }
+
+    report("svc vector", series[0], samples, freq);
+    report("svc round trip", series[1], samples, freq);
+}
+
+bool run_ipi_latency(kstd::size_t samples) {
+    samples = clamp_samples(samples);
+    kstd::uint64_t freq = GenericTimer::get_timer_frequency_hz();
+    kstd::uint32_t others = online_cpus() & ~(1u << cpu_id());
+    if (freq == 0 || !others) {
+        Kernel::kprintf("IPI latency: no other CPU online ('irqbalance on' starts them).\n");
+        return false;
+    }
+    unsigned int target = static_cast<unsigned int>(__builtin_ctz(others));
+
+    Kernel::kprintf("IPI latency: %u samples, CPU%u -> CPU%u\n", static_cast<unsigned int>(samples), cpu_id(), target);
+    for (kstd::size_t i = 0; i < samples; ++i) {
+        kstd::uint64_t start = GenericTimer::get_counter();
+        if (!smp_call_function(target, latency_ipi_call, nullptr, true)) {
+            Kernel::kprintf("IPI latency: call to CPU%u failed.\n", target);
+            return false;
+        }
+        kstd::uint64_t end = GenericTimer::get_counter();
+        series[0][i] = ticks_since(sample_vector, start);
+        series[1][i] = ticks_since(sample_handler, start);
+        series[2][i] = ticks_since(end, start);
+    }
+
+    report("ipi vector", series[0], samples, freq);
+    report("ipi function", series[1], samples, freq);
+    report("ipi round trip", series[2], samples, freq);
+    return true;
+}
+
+} // namespace Trace
+} // namespace Kernel
@@ -0,0 +1,43 @@
+#ifndef KERNEL_TRACE_LATENCY_H
+#define KERNEL_TRACE_LATENCY_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint16_t
+
+namespace Kernel {
+namespace Trace {
+
+// Interrupt and exception latency benchmark ('latency' command, 'make bench' under QEMU).
+//
+// IRQ: the EL1 virtual timer (CNTV, PPI 27; the physical one drives the system tick) is armed
+// with an absolute deadline in CNTV_CVAL_EL0, a pseudo-random 20-200us ahead. Each sample
+// records, relative to that deadline: the exception vector (CNTPCT_EL0 saved by
+// handle_irq_spx), the first line of the handler, and the end of interrupt (stamped by the
+// GIC dispatch loop). The thread waits for each sample with IRQs unmasked.
+//
+// SVC: 'svc #SVC_LATENCY_PROBE' from thread context; c_sync_handler returns the vector entry
+// time in x0. Each sample records entry and the full round trip.
+//
+// IPI: a synchronous smp_call_function to the first online secondary core. Each sample
+// records, relative to the call: the target's exception vector, the called function, and the
+// caller seeing it done (the round trip).
+//
+// Every series is reported as min / p50 / p99 / max and a log2 histogram, in nanoseconds.
+
+constexpr kstd::uint16_t SVC_LATENCY_PROBE = 0x4C7; // SVC immediate c_sync_handler answers
+constexpr kstd::size_t   MAX_LATENCY_SAMPLES = 2048;
+constexpr kstd::size_t   DEFAULT_LATENCY_SAMPLES = 1000;
+
+// Run the IRQ benchmark. Returns false if the timer IRQ could not be claimed or a sample
+// timed out.
+bool run_irq_latency(kstd::size_t samples);
+
+void run_svc_latency(kstd::size_t samples);
+
+// Returns false if no secondary core is online or a call failed.
+bool run_ipi_latency(kstd::size_t samples);
+
+} // namespace Trace
+} // namespace Kernel
+
+#endif // KERNEL_TRACE_LATENCY_H
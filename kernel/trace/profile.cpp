@@ -0,0 +1,289 @@
+#include "profile.h"
+#include "ksyms.h"                      // For ksym_find/ksym_name
+#include <kernel/interrupt.h>           // For get_interrupt_controller, irq_interrupted_context
+#include <kernel/smp.h>                 // For smp_call_function, online_cpus, cpu_id
+#include <arch/arm/core/pmu.h>          // For Pmu::allocate_sampling (CYCLES)
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_timer_frequency_hz
+#include <lib/printf/printf.h>          // For Kernel::kprintf
+
+extern "C" char BSS_START[];       // Secondary core stacks
+extern "C" char BSS_END[];
+extern "C" char BOOT_STACK_TOP[];  // CPU 0
+extern "C" char BOOT_STACK_SIZE[];
+
+namespace Kernel {
+namespace Trace {
+
+using Arch::Arm::Pmu;
+using Arch::Arm::PmuEvent;
+
+constexpr unsigned int PROFILE_TIMER_IRQ = 27; // PPI: CNTV, EL1 virtual timer
+constexpr kstd::uint64_t CNTV_CTL_ENABLE = 1;
+constexpr kstd::uint64_t CNTV_CTL_IMASK  = 2;
+constexpr unsigned int MAX_REPORT_SYMBOLS = 512;
+constexpr unsigned int MAX_REPORT_CHAINS  = 256;
+
+struct Sample {
+    kstd::uint64_t pc;
+    kstd::uint64_t callers[PROFILE_MAX_DEPTH]; // Call sites, innermost first
+    kstd::uint32_t depth;
+};
+
+struct CpuProfile {
+    Sample samples[PROFILE_MAX_SAMPLES];
+    kstd::uint32_t count;
+    kstd::uint32_t dropped;
+    int pmu_counter; // CYCLES
+};
+
+static CpuProfile cpu_profile[MAX_CPUS];
+static kstd::uint32_t sampled_cpus = 0;
+static ProfileSource active_source = ProfileSource::TIMER;
+static kstd::uint32_t active_rate = 0;
+static kstd::uint64_t timer_interval = 0;
+static bool running = false;
+
+static bool on_stack(kstd::uintptr_t fp) {
+    kstd::uintptr_t boot_top = reinterpret_cast<kstd::uintptr_t>(BOOT_STACK_TOP);
+    kstd::uintptr_t boot_bottom = boot_top - reinterpret_cast<kstd::uintptr_t>(BOOT_STACK_SIZE);
+    if (fp >= boot_bottom && fp + 16 <= boot_top) return true;
+    return fp >= reinterpret_cast<kstd::uintptr_t>(BSS_START) && fp + 16 <= reinterpret_cast<kstd::uintptr_t>(BSS_END);
+}
+
+static void take_sample() {
+    InterruptedContext context;
+    if (!irq_interrupted_context(context)) return;
+    CpuProfile& cpu = cpu_profile[cpu_id()];
+    if (cpu.count >= PROFILE_MAX_SAMPLES) {
+        cpu.dropped++;
+        return;
+    }
+    Sample& sample = cpu.samples[cpu.count];
+    sample.pc = context.pc;
+    sample.depth = 0;
+    // Frame record: [fp] caller's fp, [fp + 8] return address. Callers' records sit higher up
+    // the same stack, so anything not strictly increasing ends the walk.
+    kstd::uintptr_t fp = context.fp;
+    kstd::uintptr_t previous = 0;
+    while (sample.depth < PROFILE_MAX_DEPTH && fp > previous && !(fp & 7) && on_stack(fp)) {
+        const kstd::uint64_t* record = reinterpret_cast<const kstd::uint64_t*>(fp);
+        if (record[1] < 4) break;
+        sample.callers[sample.depth++] = record[1] - 4; // The BL, not the instruction after it
+        previous = fp;
+        fp = record[0];
+    }
+    cpu.count++;
+}
+
+static void timer_sample_irq(unsigned int irq_num, void* context) {
+    (void)irq_num; (void)context;
+    take_sample();
+    asm volatile("msr cntv_tval_el0, %0" : : "r"(timer_interval) : "memory"); // Re-arm, drops the level
+}
+
+static void cycles_sample(void* context) {
+    (void)context;
+    take_sample();
+}
+
+// Run on each sampled CPU through smp_call_function
+static void start_on_cpu(void* arg) {
+    (void)arg;
+    CpuProfile& cpu = cpu_profile[cpu_id()];
+    cpu.pmu_counter = -1;
+    if (active_source == ProfileSource::CYCLES) {
+        cpu.pmu_counter = Pmu::allocate_sampling(PmuEvent::CPU_CYCLES, active_rate, cycles_sample, nullptr);
+        return;
+    }
+    get_interrupt_controller()->enable_irq(PROFILE_TIMER_IRQ); // Banked: this CPU's copy
+    asm volatile("msr cntv_tval_el0, %0" : : "r"(timer_interval));
+    asm volatile("msr cntv_ctl_el0, %0; isb" : : "r"(CNTV_CTL_ENABLE) : "memory");
+}
+
+static void stop_on_cpu(void* arg) {
+    (void)arg;
+    CpuProfile& cpu = cpu_profile[cpu_id()];
+    if (active_source == ProfileSource::CYCLES) {
+        Pmu::release(cpu.pmu_counter);
+        cpu.pmu_counter = -1;
+        return;
+    }
+    asm volatile("msr cntv_ctl_el0, %0; isb" : : "r"(CNTV_CTL_IMASK) : "memory");
+    get_interrupt_controller()->disable_irq(PROFILE_TIMER_IRQ);
+}
+
+bool profile_start(ProfileSource source, kstd::uint32_t rate) {
+    InterruptController* ic = get_interrupt_controller();
+    if (running || !ic || rate == 0) return false;
+    if (source == ProfileSource::TIMER) {
+        kstd::uint64_t freq = Arch::RaspberryPi::GenericTimer::get_timer_frequency_hz();
+        timer_interval = freq / rate;
+        if (timer_interval == 0) return false;
+        // High priority: samples inside other IRQ handlers too (on CPU 0, where the priority
+        // is set; banked PPI priorities of running secondaries stay at the default)
+        if (!ic->register_handler(PROFILE_TIMER_IRQ, timer_sample_irq, nullptr, IRQ_PRIORITY_HIGH)) return false;
+    }
+    active_source = source;
+    active_rate = rate;
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        cpu_profile[cpu].count = 0;
+        cpu_profile[cpu].dropped = 0;
+    }
+
+    running = true;
+    sampled_cpus = 0;
+    kstd::uint32_t online = online_cpus();
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        if ((online & (1u << cpu)) && smp_call_function(cpu, start_on_cpu, nullptr, true)) {
+            sampled_cpus |= 1u << cpu;
+        }
+    }
+    return true;
+}
+
+void profile_stop() {
+    if (!running) return;
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        if (sampled_cpus & (1u << cpu)) smp_call_function(cpu, stop_on_cpu, nullptr, true);
+    }
+    if (active_source == ProfileSource::TIMER) get_interrupt_controller()->unregister_handler(PROFILE_TIMER_IRQ);
+    running = false;
+}
+
+bool profiling() {
+    return running;
+}
+
+// --- Report ---
+
+struct SymbolCount {
+    int symbol;
+    kstd::uint32_t self;
+    kstd::uint32_t total;
+};
+
+struct ChainCount {
+    int symbols[PROFILE_MAX_DEPTH + 1];
+    kstd::uint32_t depth;
+    kstd::uint32_t count;
+};
+
+static SymbolCount report_symbols[MAX_REPORT_SYMBOLS];
+static ChainCount report_chains[MAX_REPORT_CHAINS];
+
+static SymbolCount* symbol_count(int symbol, unsigned int& used) {
+    for (unsigned int i = 0; i < used; ++i) {
+        if (report_symbols[i].symbol == symbol) return &report_symbols[i];
+    }
+    if (used == MAX_REPORT_SYMBOLS) return nullptr;
+    report_symbols[used] = { symbol, 0, 0 };
+    return &report_symbols[used++];
+}
+
+static ChainCount* chain_count(const int* symbols, kstd::uint32_t depth, unsigned int& used) {
+    for (unsigned int i = 0; i < used; ++i) {
+        ChainCount& chain = report_chains[i];
+        if (chain.depth != depth) continue;
+        kstd::uint32_t j = 0;
+        while (j < depth && chain.symbols[j] == symbols[j]) ++j;
+        if (j == depth) return &chain;
+    }
+    if (used == MAX_REPORT_CHAINS) return nullptr;
+    ChainCount& chain = report_chains[used++];
+    for (kstd::uint32_t j = 0; j < depth; ++j) chain.symbols[j] = symbols[j];
+    chain.depth = depth;
+    chain.count = 0;
+    return &chain;
+}
+
+static void print_share(kstd::uint32_t count, kstd::uint32_t total) {
+    kstd::uint64_t permille = static_cast<kstd::uint64_t>(count) * 1000 / total;
+    Kernel::kprintf("%4llu.%llu%%", permille / 10, permille % 10);
+}
+
+void print_profile_report(unsigned int max_entries) {
+    if (running) {
+        Kernel::kprintf("perf: still recording.\n");
+        return;
+    }
+    kstd::uint32_t total = 0;
+    kstd::uint32_t dropped = 0;
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        total += cpu_profile[cpu].count;
+        dropped += cpu_profile[cpu].dropped;
+    }
+    Kernel::kprintf("Samples: %u (", total);
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        if (sampled_cpus & (1u << cpu)) Kernel::kprintf(" CPU%u %u", cpu, cpu_profile[cpu].count);
+    }
+    Kernel::kprintf(" ), %u dropped, %s %u%s, %u symbols\n", dropped,
+                    active_source == ProfileSource::TIMER ? "timer" : "every", active_rate,
+                    active_source == ProfileSource::TIMER ? " Hz" : " cycles", ksym_count());
+    if (total == 0) return;
+
+    unsigned int symbols_used = 0;
+    unsigned int chains_used = 0;
+    kstd::uint32_t lost = 0; // Samples whose function or chain did not fit the tables
+    for (unsigned int cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        for (kstd::uint32_t i = 0; i < cpu_profile[cpu].count; ++i) {
+            const Sample& sample = cpu_profile[cpu].samples[i];
+            int chain[PROFILE_MAX_DEPTH + 1];
+            chain[0] = ksym_find(sample.pc);
+            for (kstd::uint32_t d = 0; d < sample.depth; ++d) chain[d + 1] = ksym_find(sample.callers[d]);
+            kstd::uint32_t depth = sample.depth + 1;
+
+            SymbolCount* self = symbol_count(chain[0], symbols_used);
+            if (self) self->self++;
+            // Total: once per function on the chain, however often recursion repeats it
+            for (kstd::uint32_t d = 0; d < depth; ++d) {
+                kstd::uint32_t seen = 0;
+                while (seen < d && chain[seen] != chain[d]) ++seen;
+                if (seen < d) continue;
+                SymbolCount* entry = symbol_count(chain[d], symbols_used);
+                if (entry) entry->total++;
+            }
+            ChainCount* entry = chain_count(chain, depth, chains_used);
+            if (entry) entry->count++;
+            if (!self || !entry) lost++;
+        }
+    }
+
+    // Flat profile, by self samples (insertion sort: a few hundred entries at most)
+    for (unsigned int i = 1; i < symbols_used; ++i) {
+        SymbolCount entry = report_symbols[i];
+        unsigned int j = i;
+        for (; j > 0 && report_symbols[j - 1].self < entry.self; --j) report_symbols[j] = report_symbols[j - 1];
+        report_symbols[j] = entry;
+    }
+    Kernel::kprintf("\n%7s %7s %8s  %s\n", "Self", "Total", "Samples", "Function");
+    for (unsigned int i = 0; i < symbols_used && i < max_entries; ++i) {
+        const SymbolCount& entry = report_symbols[i];
+        if (entry.self == 0) break;
+        print_share(entry.self, total);
+        Kernel::kprintf(" ");
+        print_share(entry.total, total);
+        Kernel::kprintf(" %8u  %s\n", entry.self, ksym_name(entry.symbol));
+    }
+
+    // Call graph: the hottest distinct chains, innermost function first
+    for (unsigned int i = 1; i < chains_used; ++i) {
+        ChainCount entry = report_chains[i];
+        unsigned int j = i;
+        for (; j > 0 && report_chains[j - 1].count < entry.count; --j) report_chains[j] = report_chains[j - 1];
+        report_chains[j] = entry;
+    }
+    Kernel::kprintf("\nCall chains:\n");
+    for (unsigned int i = 0; i < chains_used && i < max_entries; ++i) {
+        const ChainCount& chain = report_chains[i];
+        print_share(chain.count, total);
+        Kernel::kprintf("  %s\n", ksym_name(chain.symbols[0]));
+        for (kstd::uint32_t d = 1; d < chain.depth; ++d) {
+            for (kstd::uint32_t indent = 0; indent < 6 + 3 * d; ++indent) Kernel::kprintf(" ");
+            Kernel::kprintf("<- %s\n", ksym_name(chain.symbols[d]));
+        }
+    }
+    if (lost) Kernel::kprintf("%u samples did not fit the report tables.\n", lost);
+}
+
+} // namespace Trace
+} // namespace Kernel
@@ -0,0 +1,44 @@
+#ifndef KERNEL_TRACE_PROFILE_H
+#define KERNEL_TRACE_PROFILE_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint32_t
+
+namespace Kernel {
+namespace Trace {
+
+// Sampling profiler ('perf record', 'perf report'). While it runs, an interrupt on every online
+// CPU records where that CPU was: the interrupted PC and up to PROFILE_MAX_DEPTH callers from
+// its frame record chain (x29; the kernel is built with frame pointers). Samples go to a
+// buffer per CPU, written only by that CPU's sampling interrupt.
+//
+// TIMER samples at a fixed rate with the EL1 virtual timer (CNTV, PPI 27), so it cannot run
+// together with the IRQ latency benchmark. CYCLES samples every 'period' CPU cycles with a
+// PMU counter overflow; cycles stop in WFI, so idle cores take no samples.
+//
+// The report symbolizes against the kernel symbol table (ksyms.h): a flat profile with self
+// and total (self plus callees) share per function, then the hottest call chains.
+
+enum class ProfileSource {
+    TIMER,
+    CYCLES,
+};
+
+constexpr kstd::uint32_t PROFILE_DEFAULT_HZ     = 1000;
+constexpr kstd::uint32_t PROFILE_DEFAULT_PERIOD = 1000000; // Cycles per sample
+constexpr unsigned int   PROFILE_MAX_DEPTH      = 6;
+constexpr kstd::size_t   PROFILE_MAX_SAMPLES    = 4096;    // Per CPU; later samples are dropped
+
+// rate: samples per second for TIMER, cycles per sample for CYCLES. Discards the previous
+// samples. Fails if already running or the sampling interrupt cannot be claimed.
+bool profile_start(ProfileSource source, kstd::uint32_t rate);
+void profile_stop();
+bool profiling();
+
+// Up to max_entries functions and as many call chains
+void print_profile_report(unsigned int max_entries);
+
+} // namespace Trace
+} // namespace Kernel
+
+#endif // KERNEL_TRACE_PROFILE_H
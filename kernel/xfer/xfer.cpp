@@ -0,0 +1,436 @@
+#include "xfer.h"
+#include <arch/arm/peripherals/uart.h>  // For Arch::RaspberryPi::get_main_uart
+#include <arch/arm/peripherals/timer.h> // For GenericTimer::get_counter
+#include <lib/crc32/crc32.h>
+#include <lib/lz4/lz4.h>
+#include <kstd/cstring.h> // For kmemset, kmemcpy
+
+namespace Kernel {
+namespace Xfer {
+
+namespace {
+
+using Arch::RaspberryPi::GenericTimer;
+
+constexpr kstd::uint32_t HANDSHAKE_TIMEOUT_MS = 60000; // Time the user has to start the host side
+constexpr kstd::uint32_t HELLO_INTERVAL_MS    = 500;
+constexpr kstd::uint32_t MIN_RETRANSMIT_MS    = 1000;
+constexpr kstd::uint32_t MAX_RETRIES          = 10;   // Consecutive timeouts before giving up
+constexpr kstd::uint32_t LINGER_MS            = 300;  // Answer late duplicates before returning to the shell
+constexpr kstd::uint8_t  CTRL_C               = 0x03;
+
+// Software RX ring. The PL011 FIFO only holds 32 bytes, so while we transmit a frame
+// the incoming ACKs (or, on the receiving side, DATA frames) are moved here byte by byte.
+constexpr kstd::size_t RX_RING_SIZE = 4096; // Power of two
+kstd::uint8_t rx_ring[RX_RING_SIZE];
+kstd::size_t rx_head;
+kstd::size_t rx_tail;
+Arch::RaspberryPi::UART* link_uart;
+kstd::uint64_t ticks_per_ms;
+
+// Frames kept for retransmission by the sender, indexed by seq % WINDOW.
+kstd::uint8_t window_slots[WINDOW][MAX_FRAME_SIZE];
+kstd::size_t slot_size[WINDOW];
+
+// Scratch block for LZ4 (de)compression
+kstd::uint8_t block_buffer[BLOCK_SIZE];
+LZ4::CompressWorkspace lz4_workspace;
+
+
+inline void put_u16(kstd::uint8_t* p, kstd::uint16_t v) {
+    p[0] = static_cast<kstd::uint8_t>(v);
+    p[1] = static_cast<kstd::uint8_t>(v >> 8);
+}
+
+inline void put_u32(kstd::uint8_t* p, kstd::uint32_t v) {
+    put_u16(p, static_cast<kstd::uint16_t>(v));
+    put_u16(p + 2, static_cast<kstd::uint16_t>(v >> 16));
+}
+
+inline kstd::uint16_t get_u16(const kstd::uint8_t* p) {
+    return static_cast<kstd::uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline kstd::uint32_t get_u32(const kstd::uint8_t* p) {
+    return get_u16(p) | (static_cast<kstd::uint32_t>(get_u16(p + 2)) << 16);
+}
+
+inline kstd::uint64_t now() {
+    return GenericTimer::get_counter();
+}
+
+
+void link_open() {
+    link_uart = Arch::RaspberryPi::get_main_uart();
+    rx_head = rx_tail = 0;
+    ticks_per_ms = GenericTimer::get_timer_frequency_hz() / 1000;
+    if (ticks_per_ms == 0) ticks_per_ms = 1;
+}
+
+void link_poll() {
+    kstd::uint8_t byte;
+    while (((rx_head + 1) & (RX_RING_SIZE - 1)) != rx_tail && link_uart->try_read_byte(byte)) {
+        rx_ring[rx_head] = byte;
+        rx_head = (rx_head + 1) & (RX_RING_SIZE - 1);
+    }
+}
+
+bool link_get_byte(kstd::uint8_t& out_byte) {
+    link_poll();
+    if (rx_head == rx_tail) return false;
+    out_byte = rx_ring[rx_tail];
+    rx_tail = (rx_tail + 1) & (RX_RING_SIZE - 1);
+    return true;
+}
+
+void link_put(const kstd::uint8_t* data, kstd::size_t length) {
+    for (kstd::size_t i = 0; i < length; ++i) {
+        link_poll(); // Keep the RX FIFO from overflowing while we wait for TX space
+        link_uart->write_byte(data[i]);
+    }
+}
+
+
+// Reassembles frames from the byte stream. Resynchronizes on the magic after garbage
+// (shell echo, line noise) and drops frames with a bad CRC.
+struct FrameParser {
+    kstd::uint8_t buf[MAX_FRAME_SIZE];
+    kstd::size_t pos;
+    kstd::size_t frame_size;
+
+    void reset() { pos = 0; frame_size = 0; }
+    bool idle() const { return pos == 0; }
+
+    // Returns true when buf holds a complete frame with a valid CRC.
+    bool feed(kstd::uint8_t byte, kstd::uint32_t& crc_errors) {
+        if (pos == 0 && byte != static_cast<kstd::uint8_t>(FRAME_MAGIC & 0xFF)) return false;
+        if (pos == 1 && byte != static_cast<kstd::uint8_t>(FRAME_MAGIC >> 8)) {
+            pos = (byte == static_cast<kstd::uint8_t>(FRAME_MAGIC & 0xFF)) ? 1 : 0;
+            return false;
+        }
+        buf[pos++] = byte;
+
+        if (pos == FRAME_HEADER_SIZE) {
+            kstd::size_t length = get_u16(buf + 8);
+            if (length > MAX_PAYLOAD) {
+                pos = 0; // Not a frame of ours
+                return false;
+            }
+            frame_size = FRAME_HEADER_SIZE + length + FRAME_CRC_SIZE;
+        }
+        if (pos < FRAME_HEADER_SIZE || pos < frame_size) return false;
+
+        pos = 0;
+        kstd::uint32_t crc = CRC32::update(0, buf, frame_size - FRAME_CRC_SIZE);
+        if (crc != get_u32(buf + frame_size - FRAME_CRC_SIZE)) {
+            crc_errors++;
+            return false;
+        }
+        return true;
+    }
+
+    FrameType type() const { return static_cast<FrameType>(buf[2]); }
+    kstd::uint8_t flags() const { return buf[3]; }
+    kstd::uint32_t seq() const { return get_u32(buf + 4); }
+    kstd::uint16_t length() const { return get_u16(buf + 8); }
+    kstd::uint16_t raw_length() const { return get_u16(buf + 10); }
+    const kstd::uint8_t* payload() const { return buf + FRAME_HEADER_SIZE; }
+};
+
+FrameParser parser;
+
+
+// Fill in header and CRC around a payload already placed at frame + FRAME_HEADER_SIZE.
+// Returns the total frame size.
+kstd::size_t finish_frame(kstd::uint8_t* frame, FrameType type, kstd::uint8_t flags, kstd::uint32_t seq,
+                          kstd::size_t length, kstd::size_t raw_length) {
+    put_u16(frame, FRAME_MAGIC);
+    frame[2] = static_cast<kstd::uint8_t>(type);
+    frame[3] = flags;
+    put_u32(frame + 4, seq);
+    put_u16(frame + 8, static_cast<kstd::uint16_t>(length));
+    put_u16(frame + 10, static_cast<kstd::uint16_t>(raw_length));
+    kstd::size_t size = FRAME_HEADER_SIZE + length;
+    put_u32(frame + size, CRC32::update(0, frame, size));
+    return size + FRAME_CRC_SIZE;
+}
+
+void send_frame(FrameType type, kstd::uint32_t seq, const kstd::uint8_t* payload, kstd::size_t length) {
+    kstd::uint8_t frame[FRAME_HEADER_SIZE + 16 + FRAME_CRC_SIZE]; // Control frames only
+    if (length > 16) return;
+    if (length) kstd::kmemcpy(frame + FRAME_HEADER_SIZE, payload, length);
+    link_put(frame, finish_frame(frame, type, 0, seq, length, length));
+}
+
+void send_control(FrameType type, kstd::uint32_t seq) {
+    send_frame(type, seq, nullptr, 0);
+}
+
+
+enum class Poll { FRAME, TIMEOUT, CANCEL };
+
+// Feed received bytes to the parser until a frame is complete or the deadline passes.
+// A deadline of 0 only drains what has already arrived.
+Poll wait_frame(kstd::uint64_t deadline, Stats& stats, bool allow_cancel) {
+    while (true) {
+        kstd::uint8_t byte;
+        if (link_get_byte(byte)) {
+            if (allow_cancel && byte == CTRL_C && parser.idle()) return Poll::CANCEL;
+            if (parser.feed(byte, stats.crc_errors)) return Poll::FRAME;
+            continue;
+        }
+        if (now() >= deadline) return Poll::TIMEOUT;
+    }
+}
+
+// After the last frame: stay on the line briefly, re-ACKing duplicates of the final frame
+// (our ACK may have been lost), so no stray protocol bytes end up in the shell.
+void linger(bool reack, kstd::uint32_t ack_seq, Stats& stats) {
+    kstd::uint64_t deadline = now() + LINGER_MS * ticks_per_ms;
+    while (wait_frame(deadline, stats, false) == Poll::FRAME) {
+        if (reack && parser.type() != FrameType::ACK) send_control(FrameType::ACK, ack_seq);
+    }
+}
+
+// Enough time for a full window to cross the wire at the current baud rate, at least MIN_RETRANSMIT_MS.
+kstd::uint64_t retransmit_ticks() {
+    unsigned int baud = link_uart->get_baud_rate();
+    kstd::uint64_t window_ms = baud ? (3ULL * WINDOW * MAX_FRAME_SIZE * 10 * 1000) / baud : 0;
+    if (window_ms < MIN_RETRANSMIT_MS) window_ms = MIN_RETRANSMIT_MS;
+    return window_ms * ticks_per_ms;
+}
+
+} // anonymous namespace
+
+
+Result receive_file(FS::File& file, Stats& stats) {
+    kstd::kmemset(&stats, 0, sizeof(stats));
+    link_open();
+    parser.reset();
+
+    // 1. Announce ourselves until the sender answers with FILE_INFO
+    kstd::uint8_t hello[4] = { PROTOCOL_VERSION, static_cast<kstd::uint8_t>(WINDOW), FLAG_LZ4, 0 };
+    kstd::uint64_t handshake_deadline = now() + HANDSHAKE_TIMEOUT_MS * ticks_per_ms;
+    kstd::uint32_t file_size = 0;
+    while (true) {
+        send_frame(FrameType::HELLO, 0, hello, sizeof(hello));
+        Poll p = wait_frame(now() + HELLO_INTERVAL_MS * ticks_per_ms, stats, true);
+        if (p == Poll::CANCEL) return Result::ABORTED;
+        if (p == Poll::FRAME) {
+            if (parser.type() == FrameType::ABORT) return Result::ABORTED;
+            if (parser.type() == FrameType::FILE_INFO && parser.seq() == 0 && parser.length() >= 4) {
+                file_size = get_u32(parser.payload());
+                break;
+            }
+        }
+        if (now() >= handshake_deadline) return Result::TIMEOUT;
+    }
+
+    kstd::uint64_t start = now();
+    if (file.reserve(file_size) != FS::ErrorCode::OK) {
+        send_control(FrameType::ABORT, 0);
+        return Result::FS_ERROR;
+    }
+
+    // 2. Accept frames strictly in order; everything else is answered with ACK/NAK
+    kstd::uint32_t expected = 1;
+    kstd::uint32_t nak_sent_for = 0; // 0: no NAK outstanding (seq 0 is never NAKed)
+    kstd::uint32_t file_crc = 0;
+    kstd::uint32_t idle_timeouts = 0;
+    kstd::uint64_t timeout_ticks = retransmit_ticks();
+    send_control(FrameType::ACK, expected);
+
+    while (true) {
+        Poll p = wait_frame(now() + timeout_ticks, stats, false);
+        if (p != Poll::FRAME) {
+            if (++idle_timeouts > MAX_RETRIES) return Result::TIMEOUT;
+            send_control(FrameType::ACK, expected); // Our last ACK may have been lost
+            continue;
+        }
+        idle_timeouts = 0;
+
+        FrameType type = parser.type();
+        if (type == FrameType::ABORT) return Result::ABORTED;
+        if (type == FrameType::FILE_INFO) {
+            send_control(FrameType::ACK, expected);
+            continue;
+        }
+        if (type != FrameType::DATA && type != FrameType::END) continue;
+
+        kstd::uint32_t seq = parser.seq();
+        if (seq < expected) {
+            send_control(FrameType::ACK, expected); // Duplicate after a go-back
+            continue;
+        }
+        if (seq > expected) {
+            if (nak_sent_for != expected) {
+                send_control(FrameType::NAK, expected);
+                nak_sent_for = expected;
+            }
+            continue;
+        }
+
+        if (type == FrameType::END) {
+            stats.ticks = now() - start;
+            if (parser.length() < 8 || get_u32(parser.payload()) != stats.bytes ||
+                get_u32(parser.payload() + 4) != file_crc) {
+                send_control(FrameType::ABORT, seq);
+                return Result::CRC_MISMATCH;
+            }
+            expected++;
+            send_control(FrameType::ACK, expected);
+            linger(true, expected, stats);
+            return Result::OK;
+        }
+
+        // DATA
+        kstd::size_t raw_length = parser.raw_length();
+        const kstd::uint8_t* data = parser.payload();
+        if (raw_length > BLOCK_SIZE) {
+            send_control(FrameType::ABORT, seq);
+            return Result::PROTOCOL_ERROR;
+        }
+        if (parser.flags() & FLAG_LZ4) {
+            int n = LZ4::decompress(parser.payload(), parser.length(), block_buffer, sizeof(block_buffer));
+            if (n < 0 || static_cast<kstd::size_t>(n) != raw_length) {
+                send_control(FrameType::ABORT, seq);
+                return Result::PROTOCOL_ERROR;
+            }
+            data = block_buffer;
+        } else if (parser.length() != raw_length) {
+            send_control(FrameType::ABORT, seq);
+            return Result::PROTOCOL_ERROR;
+        }
+
+        kstd::size_t written = 0;
+        if (file.write(data, raw_length, written) != FS::ErrorCode::OK || written != raw_length) {
+            send_control(FrameType::ABORT, seq);
+            return Result::FS_ERROR;
+        }
+        file_crc = CRC32::update(file_crc, data, raw_length);
+        stats.bytes += raw_length;
+        stats.wire_bytes += FRAME_HEADER_SIZE + parser.length() + FRAME_CRC_SIZE;
+        stats.frames++;
+
+        expected++;
+        send_control(FrameType::ACK, expected);
+    }
+}
+
+
+Result send_file(FS::File& file, bool compress, Stats& stats) {
+    kstd::kmemset(&stats, 0, sizeof(stats));
+    link_open();
+    parser.reset();
+
+    // 1. Wait for the receiver's HELLO
+    kstd::uint64_t handshake_deadline = now() + HANDSHAKE_TIMEOUT_MS * ticks_per_ms;
+    while (true) {
+        Poll p = wait_frame(handshake_deadline, stats, true);
+        if (p == Poll::CANCEL) return Result::ABORTED;
+        if (p == Poll::TIMEOUT) return Result::TIMEOUT;
+        if (parser.type() == FrameType::ABORT) return Result::ABORTED;
+        if (parser.type() == FrameType::HELLO) {
+            if (parser.length() < 3 || !(parser.payload()[2] & FLAG_LZ4)) compress = false;
+            break;
+        }
+    }
+
+    // 2. Go-back-N over FILE_INFO (seq 0), DATA (1..N) and END (N+1)
+    kstd::size_t file_size = file.get_size();
+    kstd::uint32_t end_seq = static_cast<kstd::uint32_t>((file_size + BLOCK_SIZE - 1) / BLOCK_SIZE) + 1;
+    kstd::uint32_t base = 0;  // Oldest unacknowledged frame
+    kstd::uint32_t next = 0;  // Next frame to put on the wire
+    kstd::uint32_t built = 0; // Frames [base, built) are held in window_slots
+    kstd::uint32_t last_nak = ~0u;
+    kstd::uint32_t file_crc = 0;
+    kstd::uint32_t retries = 0;
+    kstd::uint64_t timeout_ticks = retransmit_ticks();
+    kstd::uint64_t start = now();
+    kstd::uint64_t last_progress = start;
+
+    while (base <= end_seq) {
+        bool window_open = next <= end_seq && next < base + WINDOW;
+        if (window_open) {
+            kstd::uint8_t* frame = window_slots[next % WINDOW];
+            if (next == built) {
+                kstd::uint8_t* payload = frame + FRAME_HEADER_SIZE;
+                if (next == 0) {
+                    put_u32(payload, static_cast<kstd::uint32_t>(file_size));
+                    slot_size[next % WINDOW] = finish_frame(frame, FrameType::FILE_INFO, 0, next, 4, 4);
+                } else if (next == end_seq) {
+                    put_u32(payload, static_cast<kstd::uint32_t>(file_size));
+                    put_u32(payload + 4, file_crc);
+                    slot_size[next % WINDOW] = finish_frame(frame, FrameType::END, 0, next, 8, 8);
+                } else {
+                    kstd::size_t n = 0;
+                    if (file.read(block_buffer, BLOCK_SIZE, n) != FS::ErrorCode::OK || n == 0) {
+                        send_control(FrameType::ABORT, next);
+                        return Result::FS_ERROR;
+                    }
+                    file_crc = CRC32::update(file_crc, block_buffer, n);
+                    int packed = compress ? LZ4::compress(block_buffer, n, payload, MAX_PAYLOAD, lz4_workspace) : -1;
+                    if (packed > 0 && static_cast<kstd::size_t>(packed) < n) {
+                        slot_size[next % WINDOW] = finish_frame(frame, FrameType::DATA, FLAG_LZ4, next, packed, n);
+                    } else {
+                        kstd::kmemcpy(payload, block_buffer, n);
+                        slot_size[next % WINDOW] = finish_frame(frame, FrameType::DATA, 0, next, n, n);
+                    }
+                    stats.bytes += n;
+                    stats.wire_bytes += slot_size[next % WINDOW];
+                    stats.frames++;
+                }
+                built++;
+            } else {
+                stats.retransmits++;
+            }
+            link_put(frame, slot_size[next % WINDOW]);
+            next++;
+        }
+
+        // Drain replies; only block once the window is full
+        Poll p = wait_frame(window_open ? 0 : last_progress + timeout_ticks, stats, false);
+        if (p == Poll::FRAME) {
+            FrameType type = parser.type();
+            kstd::uint32_t seq = parser.seq();
+            if (type == FrameType::ABORT) return Result::ABORTED;
+            if (type == FrameType::ACK && seq > base && seq <= built) {
+                base = seq;
+                if (next < base) next = base;
+                last_progress = now();
+                last_nak = ~0u;
+                retries = 0;
+            } else if (type == FrameType::NAK && seq >= base && seq < next && seq != last_nak) {
+                next = seq; // Rewind once per gap
+                last_nak = seq;
+            }
+        } else if (p == Poll::TIMEOUT && !window_open) {
+            if (++retries > MAX_RETRIES) {
+                send_control(FrameType::ABORT, base);
+                return Result::TIMEOUT;
+            }
+            next = base; // Go back N
+            last_progress = now();
+        }
+    }
+
+    stats.ticks = now() - start;
+    linger(false, 0, stats);
+    return Result::OK;
+}
+
+
+const char* result_to_string(Result result) {
+    switch (result) {
+        case Result::OK:             return "OK";
+        case Result::TIMEOUT:        return "timeout";
+        case Result::ABORTED:        return "aborted";
+        case Result::FS_ERROR:       return "filesystem error";
+        case Result::PROTOCOL_ERROR: return "protocol error";
+        case Result::CRC_MISMATCH:   return "CRC mismatch";
+    }
+    return "?";
+}
+
+} // namespace Xfer
+} // namespace Kernel
@@ -0,0 +1,77 @@
+#ifndef KERNEL_XFER_XFER_H
+#define KERNEL_XFER_XFER_H
+
+#include <kernel/filesystem/file.h> // For FS::File
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uintXX_t
+
+namespace Kernel {
+namespace Xfer {
+
+// Binary file transfer over the console UART ("KX" protocol), used by the rx/tx shell commands
+// and by tools/kekxfer.py on the host.
+//
+// Every frame is
+//   magic "KX" (u16 0x584B) | type u8 | flags u8 | seq u32 | length u16 | raw_length u16 |
+//   payload[length] | crc32 u32 over header + payload
+// with all fields little-endian. DATA payloads carry up to BLOCK_SIZE bytes of file content,
+// LZ4 block-compressed when FLAG_LZ4 is set (raw_length is then the decompressed size).
+//
+// The sender numbers FILE_INFO as seq 0, DATA as 1..N and END as N+1 and keeps up to WINDOW
+// frames in flight (go-back-N). The receiver answers with cumulative ACKs carrying the next
+// sequence number it expects, and a single NAK per gap so the sender rewinds without waiting
+// for its timeout. The receiver opens the session by sending HELLO until FILE_INFO arrives.
+
+constexpr kstd::uint16_t FRAME_MAGIC       = 0x584B; // "KX" on the wire
+constexpr kstd::size_t   FRAME_HEADER_SIZE = 12;
+constexpr kstd::size_t   FRAME_CRC_SIZE    = 4;
+constexpr kstd::size_t   BLOCK_SIZE        = 1024;   // Raw file bytes per DATA frame
+constexpr kstd::size_t   MAX_PAYLOAD       = 1088;   // >= LZ4::compress_bound(BLOCK_SIZE)
+constexpr kstd::size_t   MAX_FRAME_SIZE    = FRAME_HEADER_SIZE + MAX_PAYLOAD + FRAME_CRC_SIZE;
+constexpr kstd::uint32_t WINDOW            = 8;      // Frames in flight
+constexpr kstd::uint8_t  PROTOCOL_VERSION  = 1;
+
+enum class FrameType : kstd::uint8_t {
+    HELLO     = 1, // Receiver -> sender: ready. Payload: version u8, window u8, flags u16
+    FILE_INFO = 2, // Payload: file size u32
+    DATA      = 3, // Payload: file content
+    ACK       = 4, // seq = next expected sequence number
+    NAK       = 5, // seq = sequence number to resend from
+    END       = 6, // Payload: file size u32, file crc32 u32
+    ABORT     = 7  // Either side gives up
+};
+
+constexpr kstd::uint8_t FLAG_LZ4 = 0x01; // DATA payload is LZ4 compressed / HELLO: LZ4 supported
+
+enum class Result {
+    OK = 0,
+    TIMEOUT,
+    ABORTED,        // Peer sent ABORT or the user pressed Ctrl-C during the handshake
+    FS_ERROR,
+    PROTOCOL_ERROR,
+    CRC_MISMATCH    // Whole-file CRC in END did not match the received data
+};
+
+struct Stats {
+    kstd::size_t bytes;        // File bytes transferred
+    kstd::size_t wire_bytes;   // Bytes of DATA frames on the wire (shows the LZ4 gain)
+    kstd::uint32_t frames;
+    kstd::uint32_t retransmits;
+    kstd::uint32_t crc_errors; // Frames dropped because of a bad frame CRC
+    kstd::uint64_t ticks;      // Generic timer ticks from handshake to END
+};
+
+// Receive a file from the host into 'file' (opened for writing, expected to be empty).
+// Blocks until the transfer ends. IRQs should be masked by the caller so nothing else
+// writes to the UART while frames are on the wire.
+Result receive_file(FS::File& file, Stats& stats);
+
+// Send 'file' (opened for reading) to the host. compress: LZ4 DATA frames if the host supports it.
+Result send_file(FS::File& file, bool compress, Stats& stats);
+
+const char* result_to_string(Result result);
+
+} // namespace Xfer
+} // namespace Kernel
+
+#endif // KERNEL_XFER_XFER_H
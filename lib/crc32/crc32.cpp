@@ -0,0 +1,37 @@
+#include "crc32.h"
+
+namespace Kernel {
+namespace CRC32 {
+
+// Byte-wise lookup table, generated at compile time.
+struct Table {
+    kstd::uint32_t entries[256];
+
+    constexpr Table() : entries() {
+        for (kstd::uint32_t i = 0; i < 256; ++i) {
+            kstd::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+static constexpr Table crc_table;
+
+kstd::uint32_t step(kstd::uint32_t state, kstd::uint8_t byte) {
+    return crc_table.entries[(state ^ byte) & 0xFF] ^ (state >> 8);
+}
+
+kstd::uint32_t update(kstd::uint32_t crc, const void* data, kstd::size_t length) {
+    const kstd::uint8_t* bytes = static_cast<const kstd::uint8_t*>(data);
+    kstd::uint32_t state = crc ^ 0xFFFFFFFFu;
+    for (kstd::size_t i = 0; i < length; ++i) {
+        state = crc_table.entries[(state ^ bytes[i]) & 0xFF] ^ (state >> 8);
+    }
+    return state ^ 0xFFFFFFFFu;
+}
+
+} // namespace CRC32
+} // namespace Kernel
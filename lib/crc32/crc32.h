@@ -0,0 +1,24 @@
+#ifndef LIB_CRC32_H
+#define LIB_CRC32_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint32_t
+
+namespace Kernel {
+namespace CRC32 {
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320), same as zlib's crc32().
+// Start with crc = 0 and feed the previous result back in to checksum data in pieces:
+//   crc = update(0, a, len_a); crc = update(crc, b, len_b);
+kstd::uint32_t update(kstd::uint32_t crc, const void* data, kstd::size_t length);
+
+// Single-byte step, for checksumming data as it streams in.
+// The running value is kept in its internal (inverted) form; use begin()/finish() around it.
+inline kstd::uint32_t begin() { return 0xFFFFFFFFu; }
+kstd::uint32_t step(kstd::uint32_t state, kstd::uint8_t byte);
+inline kstd::uint32_t finish(kstd::uint32_t state) { return state ^ 0xFFFFFFFFu; }
+
+} // namespace CRC32
+} // namespace Kernel
+
+#endif // LIB_CRC32_H
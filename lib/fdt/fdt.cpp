@@ -0,0 +1,136 @@
+#include "fdt.h"
+#include <kstd/cstring.h> // For kstrcmp, kstrncmp, kstrlen
+
+namespace Kernel {
+namespace FDT {
+
+// Structure block tokens
+constexpr kstd::uint32_t TOKEN_BEGIN_NODE = 1;
+constexpr kstd::uint32_t TOKEN_END_NODE   = 2;
+constexpr kstd::uint32_t TOKEN_PROP       = 3;
+constexpr kstd::uint32_t TOKEN_NOP        = 4;
+constexpr kstd::uint32_t TOKEN_END        = 9;
+
+struct Header {
+    kstd::uint32_t magic;
+    kstd::uint32_t totalsize;
+    kstd::uint32_t off_dt_struct;
+    kstd::uint32_t off_dt_strings;
+    kstd::uint32_t off_mem_rsvmap;
+    kstd::uint32_t version;
+    kstd::uint32_t last_comp_version;
+    kstd::uint32_t boot_cpuid_phys;
+    kstd::uint32_t size_dt_strings;
+    kstd::uint32_t size_dt_struct;
+};
+
+static inline kstd::uint32_t be32(const void* p) {
+    const kstd::uint8_t* b = static_cast<const kstd::uint8_t*>(p);
+    return (static_cast<kstd::uint32_t>(b[0]) << 24) | (static_cast<kstd::uint32_t>(b[1]) << 16) |
+           (static_cast<kstd::uint32_t>(b[2]) << 8) | b[3];
+}
+
+// Read a value of 'cells' 32-bit cells (1 or 2)
+static kstd::uint64_t read_cells(const kstd::uint8_t* p, kstd::uint32_t cells) {
+    kstd::uint64_t value = 0;
+    for (kstd::uint32_t i = 0; i < cells; ++i) {
+        value = (value << 32) | be32(p + i * 4);
+    }
+    return value;
+}
+
+static inline kstd::size_t align4(kstd::size_t n) {
+    return (n + 3) & ~static_cast<kstd::size_t>(3);
+}
+
+bool is_valid(const void* blob) {
+    if (!blob) return false;
+    const Header* h = static_cast<const Header*>(blob);
+    if (be32(&h->magic) != MAGIC || be32(&h->last_comp_version) > 17 || be32(&h->version) < 16) {
+        return false;
+    }
+    kstd::uint32_t total = be32(&h->totalsize);
+    return be32(&h->off_dt_struct) + be32(&h->size_dt_struct) <= total &&
+           be32(&h->off_dt_strings) + be32(&h->size_dt_strings) <= total;
+}
+
+kstd::size_t total_size(const void* blob) {
+    return is_valid(blob) ? be32(&static_cast<const Header*>(blob)->totalsize) : 0;
+}
+
+static bool is_memory_node(const char* name) {
+    return kstd::kstrcmp(name, "memory") == 0 || kstd::kstrncmp(name, "memory@", 7) == 0;
+}
+
+kstd::size_t memory_regions(const void* blob, MemoryRegion* regions, kstd::size_t max_regions) {
+    if (!is_valid(blob)) return 0;
+    const Header* h = static_cast<const Header*>(blob);
+    const kstd::uint8_t* base = static_cast<const kstd::uint8_t*>(blob);
+    const kstd::uint8_t* p = base + be32(&h->off_dt_struct);
+    const kstd::uint8_t* end = p + be32(&h->size_dt_struct);
+    const char* strings = reinterpret_cast<const char*>(base + be32(&h->off_dt_strings));
+    kstd::uint32_t strings_size = be32(&h->size_dt_strings);
+
+    // Defaults from the device tree specification
+    kstd::uint32_t address_cells = 2;
+    kstd::uint32_t size_cells = 1;
+    int depth = 0;
+    bool in_memory_node = false;
+    kstd::size_t count = 0;
+
+    while (p + 4 <= end) {
+        kstd::uint32_t token = be32(p);
+        p += 4;
+        switch (token) {
+            case TOKEN_BEGIN_NODE: {
+                const char* name = reinterpret_cast<const char*>(p);
+                p += align4(kstd::kstrlen(name) + 1);
+                ++depth;
+                // depth 1 is the root node, its children are at depth 2
+                in_memory_node = (depth == 2 && is_memory_node(name));
+                break;
+            }
+            case TOKEN_END_NODE:
+                --depth;
+                in_memory_node = false;
+                break;
+            case TOKEN_PROP: {
+                if (p + 8 > end) return count;
+                kstd::uint32_t len = be32(p);
+                kstd::uint32_t nameoff = be32(p + 4);
+                const kstd::uint8_t* value = p + 8;
+                p = value + align4(len);
+                if (p > end || nameoff >= strings_size) return count;
+                const char* prop = strings + nameoff;
+
+                if (depth == 1 && len == 4) {
+                    // Properties precede subnodes, so these are known before /memory is reached
+                    if (kstd::kstrcmp(prop, "#address-cells") == 0) address_cells = be32(value);
+                    else if (kstd::kstrcmp(prop, "#size-cells") == 0) size_cells = be32(value);
+                } else if (in_memory_node && kstd::kstrcmp(prop, "reg") == 0) {
+                    if (address_cells < 1 || address_cells > 2 || size_cells < 1 || size_cells > 2) {
+                        return count;
+                    }
+                    kstd::size_t entry_len = (address_cells + size_cells) * 4;
+                    for (kstd::size_t off = 0; off + entry_len <= len && count < max_regions; off += entry_len) {
+                        kstd::uint64_t region_size = read_cells(value + off + address_cells * 4, size_cells);
+                        if (region_size == 0) continue;
+                        regions[count].base = read_cells(value + off, address_cells);
+                        regions[count].size = region_size;
+                        ++count;
+                    }
+                }
+                break;
+            }
+            case TOKEN_NOP:
+                break;
+            case TOKEN_END:
+            default:
+                return count;
+        }
+    }
+    return count;
+}
+
+} // namespace FDT
+} // namespace Kernel
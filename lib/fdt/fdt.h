@@ -0,0 +1,34 @@
+#ifndef LIB_FDT_H
+#define LIB_FDT_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint32_t
+
+namespace Kernel {
+namespace FDT {
+
+// Minimal reader for the flattened device tree (DTB) the firmware passes in x0.
+// All values in the blob are big-endian; only what the kernel needs at boot is decoded.
+
+constexpr kstd::uint32_t MAGIC = 0xD00DFEED;
+
+struct MemoryRegion {
+    kstd::uint64_t base;
+    kstd::uint64_t size;
+};
+
+// True if blob points to a device tree header we understand (magic and version 16 or later).
+bool is_valid(const void* blob);
+
+// Size of the whole blob in bytes (header 'totalsize'), 0 if invalid.
+kstd::size_t total_size(const void* blob);
+
+// Collect the 'reg' ranges of the memory nodes (children of / named "memory" or "memory@...").
+// Uses the root #address-cells / #size-cells. Zero-sized ranges are skipped.
+// Returns the number of regions written, at most max_regions.
+kstd::size_t memory_regions(const void* blob, MemoryRegion* regions, kstd::size_t max_regions);
+
+} // namespace FDT
+} // namespace Kernel
+
+#endif // LIB_FDT_H
@@ -0,0 +1,167 @@
+#include "lz4.h"
+#include <kstd/cstring.h> // For kmemcpy
+
+namespace Kernel {
+namespace LZ4 {
+
+// Format constants (see lz4_Block_format.md in the LZ4 sources)
+constexpr kstd::size_t MIN_MATCH     = 4;  // Shortest encodable match
+constexpr kstd::size_t LAST_LITERALS = 5;  // The last 5 bytes are always literals
+constexpr kstd::size_t MF_LIMIT      = 12; // The last match must start at least 12 bytes before the end
+constexpr kstd::size_t MAX_OFFSET    = 65535;
+
+constexpr unsigned int HASH_LOG = 12;
+static_assert(sizeof(CompressWorkspace::table) == sizeof(kstd::uint16_t) << HASH_LOG, "CompressWorkspace must match HASH_LOG");
+constexpr kstd::uint16_t HASH_EMPTY = 0xFFFF;
+
+// Byte-wise load so the codec never relies on unaligned access being enabled.
+static inline kstd::uint32_t read32(const kstd::uint8_t* p) {
+    return static_cast<kstd::uint32_t>(p[0]) | (static_cast<kstd::uint32_t>(p[1]) << 8) |
+           (static_cast<kstd::uint32_t>(p[2]) << 16) | (static_cast<kstd::uint32_t>(p[3]) << 24);
+}
+
+static inline kstd::uint32_t hash32(kstd::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// Append one sequence (literals followed by an optional match) to the output.
+// match_length == 0 emits a literals-only sequence (the final one).
+static bool emit_sequence(kstd::uint8_t*& op, kstd::uint8_t* oend,
+                          const kstd::uint8_t* literals, kstd::size_t literal_length,
+                          kstd::size_t offset, kstd::size_t match_length) {
+    kstd::size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    // Token + worst-case length bytes + literals + offset
+    kstd::size_t needed = 1 + literal_length / 255 + 1 + literal_length + 2 + match_code / 255 + 1;
+    if (needed > static_cast<kstd::size_t>(oend - op)) return false;
+
+    kstd::uint8_t* token = op++;
+    kstd::uint8_t token_val = 0;
+
+    if (literal_length >= 15) {
+        token_val = 15 << 4;
+        kstd::size_t rest = literal_length - 15;
+        while (rest >= 255) { *op++ = 255; rest -= 255; }
+        *op++ = static_cast<kstd::uint8_t>(rest);
+    } else {
+        token_val = static_cast<kstd::uint8_t>(literal_length << 4);
+    }
+    kstd::kmemcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if (match_length) {
+        *op++ = static_cast<kstd::uint8_t>(offset & 0xFF);
+        *op++ = static_cast<kstd::uint8_t>(offset >> 8);
+        if (match_code >= 15) {
+            token_val |= 15;
+            kstd::size_t rest = match_code - 15;
+            while (rest >= 255) { *op++ = 255; rest -= 255; }
+            *op++ = static_cast<kstd::uint8_t>(rest);
+        } else {
+            token_val |= static_cast<kstd::uint8_t>(match_code);
+        }
+    }
+    *token = token_val;
+    return true;
+}
+
+int compress(const void* src, kstd::size_t src_size, void* dst, kstd::size_t dst_capacity,
+             CompressWorkspace& workspace) {
+    if (src_size > MAX_COMPRESS_INPUT) return -1;
+
+    const kstd::uint8_t* in = static_cast<const kstd::uint8_t*>(src);
+    kstd::uint8_t* op = static_cast<kstd::uint8_t*>(dst);
+    kstd::uint8_t* oend = op + dst_capacity;
+
+    kstd::uint16_t* table = workspace.table;
+    for (kstd::size_t i = 0; i < (1u << HASH_LOG); ++i) table[i] = HASH_EMPTY;
+
+    kstd::size_t anchor = 0;
+    kstd::size_t ip = 0;
+    if (src_size > MF_LIMIT) {
+        kstd::size_t match_start_limit = src_size - MF_LIMIT;
+        kstd::size_t match_end_limit = src_size - LAST_LITERALS;
+        while (ip < match_start_limit) {
+            kstd::uint32_t sequence = read32(in + ip);
+            kstd::uint32_t h = hash32(sequence);
+            kstd::size_t ref = table[h];
+            table[h] = static_cast<kstd::uint16_t>(ip);
+
+            if (ref == HASH_EMPTY || ip - ref > MAX_OFFSET || read32(in + ref) != sequence) {
+                ip++;
+                continue;
+            }
+
+            kstd::size_t match_length = MIN_MATCH;
+            while (ip + match_length < match_end_limit && in[ref + match_length] == in[ip + match_length]) {
+                match_length++;
+            }
+            if (!emit_sequence(op, oend, in + anchor, ip - anchor, ip - ref, match_length)) return -1;
+            ip += match_length;
+            anchor = ip;
+        }
+    }
+
+    if (!emit_sequence(op, oend, in + anchor, src_size - anchor, 0, 0)) return -1;
+    return static_cast<int>(op - static_cast<kstd::uint8_t*>(dst));
+}
+
+int decompress(const void* src, kstd::size_t src_size, void* dst, kstd::size_t dst_capacity) {
+    const kstd::uint8_t* ip = static_cast<const kstd::uint8_t*>(src);
+    const kstd::uint8_t* iend = ip + src_size;
+    kstd::uint8_t* out = static_cast<kstd::uint8_t*>(dst);
+    kstd::uint8_t* op = out;
+    kstd::uint8_t* oend = out + dst_capacity;
+
+    while (ip < iend) {
+        kstd::uint8_t token = *ip++;
+
+        // Literals
+        kstd::size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            kstd::uint8_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                literal_length += b;
+            } while (b == 255);
+        }
+        if (literal_length > static_cast<kstd::size_t>(iend - ip) ||
+            literal_length > static_cast<kstd::size_t>(oend - op)) {
+            return -1;
+        }
+        kstd::kmemcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip >= iend) break; // The last sequence has no match part
+
+        // Match
+        if (iend - ip < 2) return -1;
+        kstd::size_t offset = static_cast<kstd::size_t>(ip[0]) | (static_cast<kstd::size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<kstd::size_t>(op - out)) return -1;
+
+        kstd::size_t match_length = token & 0x0F;
+        if (match_length == 15) {
+            kstd::uint8_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += MIN_MATCH;
+        if (match_length > static_cast<kstd::size_t>(oend - op)) return -1;
+
+        // Byte-by-byte on purpose: matches may overlap their own output (offset < length).
+        const kstd::uint8_t* match = op - offset;
+        for (kstd::size_t i = 0; i < match_length; ++i) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+    return static_cast<int>(op - out);
+}
+
+} // namespace LZ4
+} // namespace Kernel
@@ -0,0 +1,41 @@
+#ifndef LIB_LZ4_H
+#define LIB_LZ4_H
+
+#include <kstd/cstddef.h> // For kstd::size_t
+#include <kstd/cstdint.h> // For kstd::uint8_t
+
+namespace Kernel {
+namespace LZ4 {
+
+// Minimal LZ4 *block* format codec (no frame header, no checksums).
+// The format is the one produced by LZ4_compress_default() / lz4.block.compress(store_size=False),
+// so host tools can use any standard LZ4 library.
+
+// Largest input compress() accepts (match offsets are 16-bit and the hash table stores 16-bit positions).
+constexpr kstd::size_t MAX_COMPRESS_INPUT = 65535;
+
+// Worst-case compressed size for an input of 'size' bytes (incompressible data).
+constexpr kstd::size_t compress_bound(kstd::size_t size) {
+    return size + (size / 255) + 16;
+}
+
+// Match finder state for compress(): 8KB, too large for the small kernel stacks, so the caller
+// provides it (one per concurrent user). Needs no initialization.
+struct CompressWorkspace {
+    kstd::uint16_t table[1u << 12]; // Last position of each 4-byte sequence hash
+};
+
+// Compress src into dst. Greedy single-probe matcher: fast and small rather than strong.
+// Returns the compressed size, or -1 if it does not fit in dst_capacity or src_size is too large.
+int compress(const void* src, kstd::size_t src_size, void* dst, kstd::size_t dst_capacity,
+             CompressWorkspace& workspace);
+
+// Decompress a block. Every read and write is bounds-checked, so malformed input from the
+// wire cannot overrun dst.
+// Returns the decompressed size, or -1 if the block is malformed or does not fit in dst_capacity.
+int decompress(const void* src, kstd::size_t src_size, void* dst, kstd::size_t dst_capacity);
+
+} // namespace LZ4
+} // namespace Kernel
+
+#endif // LIB_LZ4_H
@@ -38,26 +38,55 @@ static void ksnprintf_output_char_func(char c, void* context) {
 }
 
 
+// Field formatting parsed from a conversion specification: %[-0][width][l|ll|z|h|hh]conv
+struct FieldSpec {
+    int width;
+    bool left_align; // '-' flag
+    bool zero_pad;   // '0' flag (numbers only, ignored with '-')
+    int long_count;  // Number of 'l' (or 'z') modifiers: >0 means a 64-bit argument on AArch64
+};
+
+// Emit 'len' chars of 'str' padded to spec.width. Returns the number of characters produced.
+static int emit_field(void (*output_char_func)(char, void*), void* output_context,
+                      kstd::size_t& current_chars_count, kstd::size_t buffer_limit,
+                      const char* str, int len, const FieldSpec& spec, bool numeric) {
+    int pad = spec.width > len ? spec.width - len : 0;
+    char pad_char = (numeric && spec.zero_pad && !spec.left_align) ? '0' : ' ';
+    int emitted = 0;
+    auto put = [&](char c) {
+        if (buffer_limit == 0 || current_chars_count < buffer_limit) {
+            output_char_func(c, output_context);
+            current_chars_count++;
+        }
+        emitted++;
+    };
+    // A zero-padded negative number keeps its sign in front of the zeros
+    if (pad_char == '0' && len > 0 && str[0] == '-') {
+        put('-');
+        ++str;
+        --len;
+    }
+    if (!spec.left_align) {
+        for (int i = 0; i < pad; ++i) put(pad_char);
+    }
+    for (int i = 0; i < len; ++i) put(str[i]);
+    if (spec.left_align) {
+        for (int i = 0; i < pad; ++i) put(' ');
+    }
+    return emitted;
+}
+
 // Helper to print an integer (decimal, hex, binary)
 // Returns number of characters printed.
 static int print_integer(void (*output_char_func)(char, void*), void* output_context,
                          kstd::size_t& current_chars_count, kstd::size_t buffer_limit,
-                         long long val, int base, bool uppercase_hex, bool is_signed) {
+                         unsigned long long u_val, bool negative, int base, bool uppercase_hex,
+                         const FieldSpec& spec) {
 
-    char buffer[65]; // Max for 64-bit binary + null terminator
-    int buf_idx = 64;
+    char buffer[66]; // Max for 64-bit binary + sign + null terminator
+    int buf_idx = 65;
     buffer[buf_idx--] = '\0';
 
-    unsigned long long u_val;
-    bool negative = false;
-
-    if (is_signed && val < 0) {
-        negative = true;
-        u_val = static_cast<unsigned long long>(-val);
-    } else {
-        u_val = static_cast<unsigned long long>(val);
-    }
-
     if (u_val == 0) {
         buffer[buf_idx--] = '0';
     } else {
@@ -76,18 +105,10 @@ static int print_integer(void (*output_char_func)(char, void*), void* output_con
         buffer[buf_idx--] = '-';
     }
 
-    int chars_printed_this_num = 0;
-    for (int i = buf_idx + 1; buffer[i] != '\0'; ++i) {
-        if (buffer_limit == 0 || current_chars_count < buffer_limit) {
-            output_char_func(buffer[i], output_context);
-            current_chars_count++; // This is for ksnprintf's internal buffer tracking
-        }
-        chars_printed_this_num++; // This is for the return value of kvprintf_core
-    }
-    return chars_printed_this_num;
+    return emit_field(output_char_func, output_context, current_chars_count, buffer_limit,
+                      &buffer[buf_idx + 1], 64 - buf_idx, spec, true);
 }
 
-
 int kvprintf_core(void (*output_char_func)(char, void*), void* output_context,
                   kstd::size_t buffer_limit, // 0 for unlimited (kprintf), >0 for ksnprintf (actual buffer size - 1)
                   const char* format, __builtin_va_list args) {
@@ -111,8 +132,21 @@ int kvprintf_core(void (*output_char_func)(char, void*), void* output_context,
         // We encountered a '%'
         p++; // Move past '%'
 
-        // TODO: Add support for length modifiers (l, ll, h, hh, z, j, t) if needed.
-        // For now, assume default sizes (int for d/i/u/x/X/b, char* for s, void* for p)
+        // Flags, width and length modifier
+        FieldSpec spec = { 0, false, false, 0 };
+        for (;; ++p) {
+            if (*p == '-') spec.left_align = true;
+            else if (*p == '0') spec.zero_pad = true;
+            else break;
+        }
+        while (*p >= '0' && *p <= '9') {
+            spec.width = spec.width * 10 + (*p - '0');
+            ++p;
+        }
+        while (*p == 'l' || *p == 'z' || *p == 'h') {
+            if (*p != 'h') spec.long_count++; // h/hh arguments arrive promoted to int anyway
+            ++p;
+        }
 
         switch (*p) {
             case '\0': // Format string ends with '%'
@@ -133,45 +167,41 @@ int kvprintf_core(void (*output_char_func)(char, void*), void* output_context,
 
             case 'c': {
                 char c_val = (char)__builtin_va_arg(args, int); // char promotes to int
-                if (buffer_limit == 0 || chars_written_to_buffer < buffer_limit) {
-                    output_char_func(c_val, output_context);
-                    chars_written_to_buffer++;
-                }
-                total_chars_emitted++;
+                total_chars_emitted += emit_field(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
+                                                  &c_val, 1, spec, false);
                 break;
             }
 
             case 's': {
                 const char* s_val = __builtin_va_arg(args, const char*);
                 if (!s_val) s_val = "(null)";
-                while (*s_val) {
-                    if (buffer_limit == 0 || chars_written_to_buffer < buffer_limit) {
-                        output_char_func(*s_val, output_context);
-                        chars_written_to_buffer++;
-                    }
-                    total_chars_emitted++;
-                    s_val++;
-                }
+                total_chars_emitted += emit_field(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
+                                                  s_val, static_cast<int>(kstd::kstrlen(s_val)), spec, false);
                 break;
             }
 
             case 'd':
             case 'i': {
-                int val = __builtin_va_arg(args, int);
-                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit, val, 10, false, true);
+                long long val = spec.long_count > 0 ? __builtin_va_arg(args, long long) : __builtin_va_arg(args, int);
+                unsigned long long magnitude = val < 0 ? 0ULL - static_cast<unsigned long long>(val)
+                                                       : static_cast<unsigned long long>(val);
+                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
+                                                     magnitude, val < 0, 10, false, spec);
                 break;
             }
 
             case 'u': {
-                unsigned int val = __builtin_va_arg(args, unsigned int);
-                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit, val, 10, false, false);
+                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
+                                                     (spec.long_count > 0 ? __builtin_va_arg(args, unsigned long long)
+                                                                          : __builtin_va_arg(args, unsigned int)), false, 10, false, spec);
                 break;
             }
 
             case 'x':
             case 'X': {
-                unsigned int val = __builtin_va_arg(args, unsigned int);
-                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit, val, 16, (*p == 'X'), false);
+                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
+                                                     (spec.long_count > 0 ? __builtin_va_arg(args, unsigned long long)
+                                                                          : __builtin_va_arg(args, unsigned int)), false, 16, (*p == 'X'), spec);
                 break;
             }
 
@@ -185,13 +215,14 @@ int kvprintf_core(void (*output_char_func)(char, void*), void* output_context,
 
                 // Treat pointer as unsigned long long for printing its value
                 total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
-                                       reinterpret_cast<kstd::uintptr_t>(ptr_val), 16, true, false); // Uppercase hex often standard for pointers
+                                       reinterpret_cast<kstd::uintptr_t>(ptr_val), false, 16, true, spec); // Uppercase hex often standard for pointers
                 break;
             }
 
             case 'b': { // Binary
-                unsigned int val = __builtin_va_arg(args, unsigned int);
-                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit, val, 2, false, false);
+                total_chars_emitted += print_integer(output_char_func, output_context, chars_written_to_buffer, buffer_limit,
+                                                     (spec.long_count > 0 ? __builtin_va_arg(args, unsigned long long)
+                                                                          : __builtin_va_arg(args, unsigned int)), false, 2, false, spec);
                 break;
             }
 
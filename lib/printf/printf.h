@@ -30,8 +30,9 @@ namespace Kernel {
 // %p - pointer (void*) (prints as hex)
 // %b - binary unsigned int
 // %% - literal '%'
-// Length modifiers (l, ll) are not supported in this minimal version.
-// Width and precision are not supported.
+// Flags '-' (left-align) and '0' (zero-pad), a field width, and the length modifiers
+// l, ll, z (64-bit argument) and h, hh (accepted, no effect) are supported.
+// Precision is not supported.
 void kprintf(const char* format, ...);
 
 // A version of ksnprintf that writes to a character buffer.
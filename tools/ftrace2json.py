@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Convert a KEKOS function trace (kernel/trace/ftrace.h) to Chrome trace JSON.
+
+    make FTRACE_DIRS="kernel/filesystem kernel/shell"      # instrumented kernel
+    (kernel shell) ftrace record cat readme.txt
+    (kernel shell) ftrace save trace.bin
+    kekxfer.py /dev/ttyUSB0 get trace.bin --lz4
+    ftrace2json.py trace.bin --elf build/kernel8.elf -o trace.json
+
+Open the JSON in Perfetto (ui.perfetto.dev) or chrome://tracing: one track per CPU, a slice
+per call. Function addresses are named from the ELF with nm; without --elf they stay hex.
+
+Timestamps are cycles. Each CPU's cycle counter was read together with the system counter
+(CNTPCT_EL0) when tracing started, which puts all CPUs on one timeline; cycles convert at the
+clock rate the busiest CPU ran at between start and stop (cores idle in WFI do not count
+cycles), or at --cpu-mhz.
+"""
+
+import argparse
+import json
+import struct
+import subprocess
+import sys
+
+MAGIC = 0x5254464B  # "KFTR"
+VERSION = 1
+FILE_HEADER = struct.Struct("<IHHQ")
+CPU_HEADER = struct.Struct("<QQQQII")
+EVENT = struct.Struct("<QQ")
+EXIT = 1
+
+
+def load(data):
+    """(timer_hz, [cpu dict with anchors, lost and events as (cycles, function, is_exit)])."""
+    magic, version, num_cpus, timer_hz = FILE_HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        sys.exit("ftrace2json: not a function trace (bad magic)")
+    if version != VERSION:
+        sys.exit(f"ftrace2json: trace version {version}, expected {VERSION}")
+    offset = FILE_HEADER.size
+    cpus = []
+    for cpu in range(num_cpus):
+        start_cycles, start_ticks, stop_cycles, stop_ticks, count, lost = CPU_HEADER.unpack_from(data, offset)
+        offset += CPU_HEADER.size
+        cpus.append({"cpu": cpu, "start_cycles": start_cycles, "start_ticks": start_ticks,
+                     "stop_cycles": stop_cycles, "stop_ticks": stop_ticks, "count": count, "lost": lost})
+    for cpu in cpus:
+        events = []
+        for _ in range(cpu["count"]):
+            cycles, function = EVENT.unpack_from(data, offset)
+            offset += EVENT.size
+            events.append((cycles, function & ~EXIT, bool(function & EXIT)))
+        cpu["events"] = events
+    if offset != len(data):
+        sys.exit(f"ftrace2json: {len(data) - offset} bytes after the last event; truncated or corrupt trace")
+    return timer_hz, [cpu for cpu in cpus if cpu["start_ticks"]]
+
+
+def symbols(elf, nm):
+    """{address: name} of the functions in elf."""
+    out = subprocess.run([nm, "-n", "-C", "--defined-only", elf], check=True,
+                         capture_output=True, text=True).stdout
+    names = {}
+    for line in out.splitlines():
+        parts = line.split(" ", 2)
+        if len(parts) == 3 and parts[1] in ("T", "t", "W"):
+            names.setdefault(int(parts[0], 16), parts[2])
+    return names
+
+
+def cpu_hz(cpus, timer_hz):
+    rates = [(c["stop_cycles"] - c["start_cycles"]) * timer_hz / (c["stop_ticks"] - c["start_ticks"])
+             for c in cpus if c["stop_ticks"] > c["start_ticks"]]
+    return max(rates) if rates else 0
+
+
+def convert(timer_hz, cpus, hz, names):
+    origin = min(c["start_ticks"] for c in cpus)
+    trace = []
+    for c in cpus:
+        base_us = (c["start_ticks"] - origin) * 1e6 / timer_hz
+
+        def ts(cycles, c=c, base_us=base_us):
+            return base_us + (cycles - c["start_cycles"]) * 1e6 / hz
+
+        trace.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": c["cpu"],
+                      "args": {"name": f"CPU{c['cpu']}"}})
+        stack = []
+        for cycles, function, is_exit in c["events"]:
+            if is_exit:
+                # Entries overwritten in the ring leave exits without one
+                if not stack or stack[-1] != function:
+                    continue
+                stack.pop()
+            else:
+                stack.append(function)
+            trace.append({"name": names.get(function, f"0x{function:x}"), "ph": "E" if is_exit else "B",
+                          "pid": 0, "tid": c["cpu"], "ts": ts(cycles)})
+        # Calls still running when tracing stopped end there
+        while stack:
+            function = stack.pop()
+            trace.append({"name": names.get(function, f"0x{function:x}"), "ph": "E",
+                          "pid": 0, "tid": c["cpu"], "ts": ts(c["stop_cycles"])})
+    return {"traceEvents": trace, "displayTimeUnit": "ns"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Convert a KEKOS function trace to Chrome trace JSON")
+    ap.add_argument("trace", help="binary trace written by 'ftrace save'")
+    ap.add_argument("-o", "--output", default="-", help="JSON file to write (default: stdout)")
+    ap.add_argument("--elf", help="kernel ELF to name functions with (build/kernel8.elf)")
+    ap.add_argument("--nm", default="aarch64-elf-nm", help="nm to read --elf with")
+    ap.add_argument("--cpu-mhz", type=float, help="CPU clock rate instead of the measured one")
+    args = ap.parse_args()
+
+    with open(args.trace, "rb") as f:
+        timer_hz, cpus = load(f.read())
+    if not cpus:
+        sys.exit("ftrace2json: no CPU was traced")
+    hz = args.cpu_mhz * 1e6 if args.cpu_mhz else cpu_hz(cpus, timer_hz)
+    if hz <= 0:
+        sys.exit("ftrace2json: cannot tell the CPU clock rate; pass --cpu-mhz")
+    names = symbols(args.elf, args.nm) if args.elf else {}
+
+    for c in cpus:
+        print(f"CPU{c['cpu']}: {c['count']} events, {c['lost']} lost", file=sys.stderr)
+    print(f"{hz / 1e6:.0f} MHz", file=sys.stderr)
+
+    result = convert(timer_hz, cpus, hz, names)
+    if args.output == "-":
+        json.dump(result, sys.stdout)
+        sys.stdout.write("\n")
+    else:
+        with open(args.output, "w") as f:
+            json.dump(result, f)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Generate the kernel symbol table (kernel/trace/ksyms.h) from nm output (make).
+
+    aarch64-elf-nm -n -S -C --defined-only build/kernel8.pass1.elf | gensyms.py -o build/ksyms.S
+
+Writes an assembly file with every function of the image, sorted by address: ksyms_count,
+then ksyms_table (address, size, name offset; 16 bytes each), then the names. Demangled names
+lose their parameter list. With empty input the table is empty (the first link).
+
+    ... | gensyms.py --check build/ksyms.S
+
+fails if the functions of the final image are not where the table says, i.e. if linking the
+table in moved code.
+"""
+
+import argparse
+import sys
+
+TEXT_TYPES = {"T", "t", "W"}
+
+
+def strip_parameters(name):
+    """'ns::f<int>(char, int) const' -> 'ns::f<int>'; '(anonymous namespace)::g()' keeps its prefix."""
+    if not name.endswith(")") and not name.endswith(") const"):
+        return name
+    end = name.rfind(")")
+    depth = 0
+    for i in range(end, -1, -1):
+        if name[i] == ")":
+            depth += 1
+        elif name[i] == "(":
+            depth -= 1
+            if depth == 0:
+                return name[:i] if i > 0 else name
+    return name
+
+
+def parse(lines):
+    """(address, size or None, name) of each function symbol, sorted by address."""
+    symbols = []
+    for line in lines:
+        parts = line.rstrip("\n").split(" ")
+        if len(parts) < 3:
+            continue
+        if len(parts[1]) == 1:
+            size, kind, name = None, parts[1], " ".join(parts[2:])
+        else:
+            if len(parts) < 4:
+                continue
+            size, kind, name = int(parts[1], 16), parts[2], " ".join(parts[3:])
+        if kind not in TEXT_TYPES or name.startswith("$") or name.startswith(".L"):
+            continue
+        symbols.append((int(parts[0], 16), size, strip_parameters(name)))
+    symbols.sort(key=lambda s: s[0])
+
+    # Labels without a size (assembly) run up to the next symbol
+    table = []
+    for i, (addr, size, name) in enumerate(symbols):
+        if i + 1 < len(symbols) and symbols[i + 1][0] == addr and size is None:
+            continue  # Alias of the next symbol, which may have a size
+        if size is None:
+            size = symbols[i + 1][0] - addr if i + 1 < len(symbols) else 4
+        table.append((addr, size, name))
+    return table
+
+
+def generate(table):
+    names = bytearray()
+    out = [
+        "/* Generated by tools/gensyms.py - do not edit */",
+        '    .section .rodata.ksyms, "a"',
+        "    .balign 8",
+        "    .global ksyms_count",
+        "ksyms_count:",
+        f"    .quad {len(table)}",
+        "    .global ksyms_table",
+        "ksyms_table:",
+    ]
+    for addr, size, name in table:
+        out.append(f"    .quad 0x{addr:x}")
+        out.append(f"    .word 0x{size:x}, {len(names)}")
+        names += name.encode("ascii", "replace") + b"\0"
+    out.append("    .global ksyms_names")
+    out.append("ksyms_names:")
+    for i in range(0, len(names), 32):
+        out.append("    .byte " + ", ".join(str(b) for b in names[i:i + 32]))
+    out.append("    .byte 0")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Generate the kernel symbol table from nm output")
+    group = ap.add_mutually_exclusive_group(required=True)
+    group.add_argument("-o", "--output", help="assembly file to write")
+    group.add_argument("--check", metavar="FILE", help="fail if FILE does not match the input")
+    args = ap.parse_args()
+
+    text = generate(parse(sys.stdin))
+    if args.check:
+        with open(args.check) as f:
+            if f.read() != text:
+                sys.exit(f"gensyms: functions moved after linking {args.check}; relink")
+        return
+    with open(args.output, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,410 @@
+#!/usr/bin/env python3
+"""Host side of the KEKOS binary file transfer ("KX" protocol, see kernel/xfer/xfer.h).
+
+    kekxfer.py /dev/ttyUSB0 put input.bin [remote_name] [--lz4] [--speed 3000000]
+    kekxfer.py /dev/ttyUSB0 get remote_name [output.bin] [--lz4] [--speed 3000000]
+
+The script types the rx/tx command into the kernel shell itself. With --speed it first
+switches the kernel UART (shell command 'baud') and the host port to a faster rate and
+switches both back afterwards.
+
+Needs pyserial. LZ4 is implemented here in pure Python (block format), so no lz4 module
+is required.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+import zlib
+
+try:
+    import serial
+except ImportError:  # pragma: no cover
+    serial = None
+
+FRAME_MAGIC = 0x584B
+HEADER = struct.Struct("<HBBIHH")
+BLOCK_SIZE = 1024
+MAX_PAYLOAD = 1088
+WINDOW = 8
+FLAG_LZ4 = 0x01
+
+HELLO, FILE_INFO, DATA, ACK, NAK, END, ABORT = range(1, 8)
+
+HANDSHAKE_TIMEOUT = 10.0
+HELLO_INTERVAL = 0.5
+MAX_RETRIES = 10
+
+
+class TransferError(Exception):
+    pass
+
+
+# --- LZ4 block format --------------------------------------------------------
+
+def lz4_compress(src):
+    """Greedy LZ4 block compressor (same scheme as lib/lz4 in the kernel)."""
+    n = len(src)
+    out = bytearray()
+    anchor = 0
+    pos = 0
+    table = {}
+    match_limit = n - 12  # Last match must start 12 bytes before the end
+    while pos < match_limit:
+        seq = src[pos:pos + 4]
+        cand = table.get(seq)
+        table[seq] = pos
+        if cand is None or pos - cand > 0xFFFF:
+            pos += 1
+            continue
+        length = 4
+        end_limit = n - 5  # Last 5 bytes are always literals
+        while pos + length < end_limit and src[cand + length] == src[pos + length]:
+            length += 1
+        _emit_sequence(out, src[anchor:pos], pos - cand, length)
+        pos += length
+        anchor = pos
+    _emit_sequence(out, src[anchor:], 0, 0)
+    return bytes(out)
+
+
+def _emit_length(out, value):
+    while value >= 255:
+        out.append(255)
+        value -= 255
+    out.append(value)
+
+
+def _emit_sequence(out, literals, offset, match_length):
+    lit = len(literals)
+    token_lit = min(lit, 15)
+    token_match = 0 if match_length == 0 else min(match_length - 4, 15)
+    out.append((token_lit << 4) | token_match)
+    if lit >= 15:
+        _emit_length(out, lit - 15)
+    out += literals
+    if match_length:
+        out += struct.pack("<H", offset)
+        if match_length - 4 >= 15:
+            _emit_length(out, match_length - 4 - 15)
+
+
+def lz4_decompress(src, max_size):
+    out = bytearray()
+    i = 0
+    n = len(src)
+    while i < n:
+        token = src[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = src[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += src[i:i + lit]
+        i += lit
+        if i >= n:
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        if offset == 0 or offset > len(out):
+            raise TransferError("malformed LZ4 block")
+        length = (token & 15) + 4
+        if (token & 15) == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        start = len(out) - offset
+        for k in range(length):  # Overlapping copies are byte by byte
+            out.append(out[start + k])
+        if len(out) > max_size:
+            raise TransferError("LZ4 block too large")
+    return bytes(out)
+
+
+# --- Framing -----------------------------------------------------------------
+
+def make_frame(ftype, seq, payload=b"", flags=0, raw_length=None):
+    if raw_length is None:
+        raw_length = len(payload)
+    body = HEADER.pack(FRAME_MAGIC, ftype, flags, seq, len(payload), raw_length) + payload
+    return body + struct.pack("<I", zlib.crc32(body) & 0xFFFFFFFF)
+
+
+class Link:
+    """Frame reader on top of a pyserial port. Resyncs on the magic like the kernel parser."""
+
+    def __init__(self, port):
+        self.port = port
+        self.buf = bytearray()
+        self.crc_errors = 0
+
+    def send(self, frame):
+        self.port.write(frame)
+
+    def recv(self, timeout):
+        """Return (type, flags, seq, payload, raw_length) or None on timeout."""
+        deadline = time.monotonic() + timeout
+        while True:
+            frame = self._parse()
+            if frame:
+                return frame
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.port.timeout = min(remaining, 0.05)
+            waiting = getattr(self.port, "in_waiting", 0)
+            chunk = self.port.read(max(1, waiting))
+            if chunk:
+                self.buf += chunk
+
+    def _parse(self):
+        while True:
+            start = self.buf.find(b"KX")
+            if start < 0:
+                del self.buf[:-1]  # Keep a trailing 'K'
+                return None
+            del self.buf[:start]
+            if len(self.buf) < HEADER.size:
+                return None
+            _, ftype, flags, seq, length, raw_length = HEADER.unpack_from(self.buf)
+            if length > MAX_PAYLOAD:
+                del self.buf[:2]
+                continue
+            size = HEADER.size + length + 4
+            if len(self.buf) < size:
+                return None
+            body = bytes(self.buf[:size - 4])
+            (crc,) = struct.unpack_from("<I", self.buf, size - 4)
+            if zlib.crc32(body) & 0xFFFFFFFF != crc:
+                self.crc_errors += 1
+                del self.buf[:2]
+                continue
+            del self.buf[:size]
+            return ftype, flags, seq, body[HEADER.size:], raw_length
+
+
+# --- Sender / receiver -------------------------------------------------------
+
+def send_data(link, data, compress, retransmit_timeout):
+    """Go-back-N sender. Waits for the kernel's HELLO first."""
+    deadline = time.monotonic() + HANDSHAKE_TIMEOUT
+    while True:
+        frame = link.recv(deadline - time.monotonic())
+        if frame is None:
+            raise TransferError("no HELLO from the kernel (is the shell at the prompt?)")
+        if frame[0] == ABORT:
+            raise TransferError("kernel aborted")
+        if frame[0] == HELLO:
+            if len(frame[3]) < 3 or not frame[3][2] & FLAG_LZ4:
+                compress = False
+            break
+
+    blocks = [data[i:i + BLOCK_SIZE] for i in range(0, len(data), BLOCK_SIZE)]
+    end_seq = len(blocks) + 1
+    frames = {}
+    wire = 0
+
+    def build(seq):
+        nonlocal wire
+        if seq == 0:
+            return make_frame(FILE_INFO, 0, struct.pack("<I", len(data)))
+        if seq == end_seq:
+            return make_frame(END, seq, struct.pack("<II", len(data), zlib.crc32(data) & 0xFFFFFFFF))
+        raw = blocks[seq - 1]
+        packed = lz4_compress(raw) if compress else None
+        if packed is not None and len(packed) < len(raw):
+            frame = make_frame(DATA, seq, packed, FLAG_LZ4, len(raw))
+        else:
+            frame = make_frame(DATA, seq, raw)
+        wire += len(frame)
+        return frame
+
+    base = nxt = built = 0
+    retries = retransmits = 0
+    last_nak = None
+    last_progress = time.monotonic()
+    while base <= end_seq:
+        window_open = nxt <= end_seq and nxt < base + WINDOW
+        if window_open:
+            if nxt == built:
+                frames[nxt] = build(nxt)
+                built += 1
+            else:
+                retransmits += 1
+            link.send(frames[nxt])
+            nxt += 1
+        timeout = 0 if window_open else max(0.0, last_progress + retransmit_timeout - time.monotonic())
+        frame = link.recv(timeout)
+        if frame is not None:
+            ftype, _, seq, _, _ = frame
+            if ftype == ABORT:
+                raise TransferError("kernel aborted (filesystem full?)")
+            if ftype == ACK and base < seq <= built:
+                for s in range(base, seq):
+                    del frames[s]  # Only frames from base on can be resent
+                base = seq
+                nxt = max(nxt, base)
+                last_progress = time.monotonic()
+                last_nak = None
+                retries = 0
+            elif ftype == NAK and base <= seq < nxt and seq != last_nak:
+                nxt = seq
+                last_nak = seq
+        elif not window_open:
+            retries += 1
+            if retries > MAX_RETRIES:
+                link.send(make_frame(ABORT, base))
+                raise TransferError("timeout waiting for ACK")
+            nxt = base
+            last_progress = time.monotonic()
+    return wire, retransmits
+
+
+def receive_data(link, retransmit_timeout):
+    """Receiver: sends HELLO until FILE_INFO, then ACKs frames in order."""
+    deadline = time.monotonic() + HANDSHAKE_TIMEOUT
+    while True:
+        link.send(make_frame(HELLO, 0, bytes([1, WINDOW, FLAG_LZ4, 0])))
+        frame = link.recv(HELLO_INTERVAL)
+        if frame is not None:
+            if frame[0] == ABORT:
+                raise TransferError("kernel aborted")
+            if frame[0] == FILE_INFO and frame[2] == 0:
+                (size,) = struct.unpack_from("<I", frame[3])
+                break
+        if time.monotonic() > deadline:
+            raise TransferError("no FILE_INFO from the kernel")
+
+    out = bytearray()
+    expected = 1
+    nak_sent_for = 0
+    idle = 0
+    wire = 0
+    link.send(make_frame(ACK, expected))
+    while True:
+        frame = link.recv(retransmit_timeout)
+        if frame is None:
+            idle += 1
+            if idle > MAX_RETRIES:
+                raise TransferError("timeout waiting for data")
+            link.send(make_frame(ACK, expected))
+            continue
+        idle = 0
+        ftype, flags, seq, payload, raw_length = frame
+        if ftype == ABORT:
+            raise TransferError("kernel aborted")
+        if ftype == FILE_INFO:
+            link.send(make_frame(ACK, expected))
+            continue
+        if ftype not in (DATA, END):
+            continue
+        if seq < expected:
+            link.send(make_frame(ACK, expected))
+            continue
+        if seq > expected:
+            if nak_sent_for != expected:
+                link.send(make_frame(NAK, expected))
+                nak_sent_for = expected
+            continue
+        if ftype == END:
+            file_size, file_crc = struct.unpack_from("<II", payload)
+            if file_size != len(out) or file_crc != zlib.crc32(out) & 0xFFFFFFFF or size != len(out):
+                link.send(make_frame(ABORT, seq))
+                raise TransferError("file CRC mismatch")
+            expected += 1
+            link.send(make_frame(ACK, expected))
+            return bytes(out), wire
+        block = lz4_decompress(payload, BLOCK_SIZE) if flags & FLAG_LZ4 else payload
+        if len(block) != raw_length:
+            link.send(make_frame(ABORT, seq))
+            raise TransferError("bad DATA frame")
+        out += block
+        wire += HEADER.size + len(payload) + 4
+        expected += 1
+        link.send(make_frame(ACK, expected))
+
+
+# --- Shell interaction -------------------------------------------------------
+
+def shell_command(port, line, settle=0.2):
+    port.write(line.encode("ascii") + b"\r")
+    port.flush()
+    time.sleep(settle)
+
+
+def set_speed(port, speed):
+    shell_command(port, "baud %d" % speed)
+    port.flush()
+    time.sleep(0.1)  # Let the kernel finish printing at the old rate before it switches
+    port.baudrate = speed
+    time.sleep(0.1)
+    port.reset_input_buffer()
+
+
+def retransmit_timeout_for(baud):
+    return max(1.0, 3 * WINDOW * (HEADER.size + MAX_PAYLOAD + 4) * 10 / baud)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port", help="serial device, e.g. /dev/ttyUSB0")
+    ap.add_argument("command", choices=["put", "get"])
+    ap.add_argument("source")
+    ap.add_argument("dest", nargs="?")
+    ap.add_argument("--baud", type=int, default=115200, help="current console baud rate")
+    ap.add_argument("--speed", type=int, help="switch both sides to this baud rate for the transfer")
+    ap.add_argument("--lz4", action="store_true", help="LZ4-compress DATA frames")
+    args = ap.parse_args()
+
+    if serial is None:
+        sys.exit("kekxfer.py needs pyserial (pip install pyserial)")
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    link = Link(port)
+    shell_command(port, "")
+    port.reset_input_buffer()
+    if args.speed:
+        set_speed(port, args.speed)
+    rto = retransmit_timeout_for(port.baudrate)
+
+    start = time.monotonic()
+    try:
+        if args.command == "put":
+            with open(args.source, "rb") as f:
+                data = f.read()
+            remote = args.dest or os.path.basename(args.source)
+            shell_command(port, "rx %s" % remote, settle=0)
+            wire, retransmits = send_data(link, data, args.lz4, rto)
+            size = len(data)
+        else:
+            local = args.dest or args.source
+            shell_command(port, "tx %s%s" % (args.source, " -z" if args.lz4 else ""), settle=0)
+            data, wire = receive_data(link, rto)
+            retransmits = 0
+            with open(local, "wb") as f:
+                f.write(data)
+            size = len(data)
+    except TransferError as e:
+        sys.exit("transfer failed: %s" % e)
+    finally:
+        if args.speed:
+            time.sleep(0.5)  # Kernel lingers briefly and prints its summary
+            set_speed(port, args.baud)
+
+    elapsed = time.monotonic() - start
+    print("%s %s: %d bytes (%d on the wire) in %.2f s, %.0f bytes/s, %d retransmits, %d CRC errors"
+          % (args.command, args.source, size, wire, elapsed, size / elapsed if elapsed else 0,
+             retransmits, link.crc_errors))
+
+
+if __name__ == "__main__":
+    main()
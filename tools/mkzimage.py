@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Build the compressed kernel image (make zimage).
+
+    mkzimage.py --stub build/zboot.bin --kernel build/kernel8.img --entry 0x80800 -o build/kernel8-lz4.img
+
+Appends kernel8.img as one LZ4 block to the decompression stub (arch/arm/boot/zboot.S) and
+fills in the stub's header. The result replaces kernel8.img on the SD card: the firmware loads
+it at 0x80000, the stub unpacks the kernel to the same address and jumps to --entry (_start).
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from kekxfer import lz4_compress, lz4_decompress  # noqa: E402  (same LZ4 block format)
+
+MAGIC = 0x48345A4B  # "KZ4H"
+# magic, payload_offset, compressed_size, decompressed_size, total_size, reloc_limit,
+# load_address, entry
+HEADER = struct.Struct("<IIIIIIQQ")
+ALIGN = 16
+
+
+def align_up(value, alignment):
+    return (value + alignment - 1) & ~(alignment - 1)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Build a self-decompressing kernel image")
+    ap.add_argument("--stub", required=True, help="raw binary of arch/arm/boot/zboot.S")
+    ap.add_argument("--kernel", required=True, help="raw kernel image (kernel8.img)")
+    ap.add_argument("--entry", required=True, type=lambda s: int(s, 0), help="address of _start")
+    ap.add_argument("-o", "--output", required=True)
+    args = ap.parse_args()
+
+    with open(args.stub, "rb") as f:
+        stub = bytearray(f.read())
+    with open(args.kernel, "rb") as f:
+        kernel = f.read()
+
+    header_offset = stub.find(struct.pack("<I", MAGIC))
+    if header_offset < 0 or header_offset % 8:
+        sys.exit("mkzimage: no zboot header in %s" % args.stub)
+    _, _, _, _, _, reloc_limit, load_address, _ = HEADER.unpack_from(stub, header_offset)
+
+    if load_address + len(kernel) > reloc_limit:
+        sys.exit("mkzimage: kernel (%d bytes at 0x%x) overlaps the stub's relocation area at 0x%x"
+                 % (len(kernel), load_address, reloc_limit))
+
+    packed = lz4_compress(kernel)
+    if lz4_decompress(packed, len(kernel)) != kernel:
+        sys.exit("mkzimage: LZ4 round trip failed")
+
+    payload_start = align_up(len(stub), ALIGN)
+    total_size = align_up(payload_start + len(packed), ALIGN)
+    if load_address + total_size > reloc_limit:
+        sys.exit("mkzimage: compressed image too large for the relocation area")
+
+    HEADER.pack_into(stub, header_offset, MAGIC, payload_start - header_offset, len(packed),
+                     len(kernel), total_size, reloc_limit, load_address, args.entry)
+    image = bytes(stub) + bytes(payload_start - len(stub)) + packed
+    image += bytes(total_size - len(image))
+
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print("  ZIMAGE %s: %d -> %d bytes (%.1f%%)" % (args.output, len(kernel), len(image),
+                                                  100.0 * len(image) / max(len(kernel), 1)))
+
+
+if __name__ == "__main__":
+    main()
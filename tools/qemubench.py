@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Run a shell command in the kernel under QEMU and print its output (make bench).
+
+    qemubench.py --command "latency all 1000" -- qemu-system-aarch64 -M raspi4b ... -serial stdio
+
+Starts QEMU with the given arguments, waits for the shell prompt on the serial console
+(QEMU's stdio), types the command, prints everything up to the command's end marker and
+stops QEMU. Exits non-zero if the prompt or the marker does not show up in time.
+"""
+
+import argparse
+import os
+import select
+import subprocess
+import sys
+import time
+
+PROMPT = b"KekOS C++ > "
+END_MARKER = b"latency: done"
+
+
+def read_until(proc, marker, timeout, echo):
+    """Read QEMU's stdout until 'marker' appears. Returns everything read, or None on timeout."""
+    data = b""
+    deadline = time.monotonic() + timeout
+    fd = proc.stdout.fileno()
+    while marker not in data:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0 or proc.poll() is not None:
+            return None
+        ready, _, _ = select.select([fd], [], [], remaining)
+        if not ready:
+            continue
+        chunk = os.read(fd, 4096)
+        if not chunk:
+            return None
+        data += chunk
+        if echo:
+            sys.stdout.write(chunk.decode("utf-8", "replace"))
+            sys.stdout.flush()
+    return data
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Run a kernel shell command under QEMU")
+    ap.add_argument("--command", default="latency", help="shell command to run")
+    ap.add_argument("--marker", default=END_MARKER.decode(), help="output line that ends the command")
+    ap.add_argument("--boot-timeout", type=float, default=60.0)
+    ap.add_argument("--timeout", type=float, default=300.0, help="for the command itself")
+    ap.add_argument("qemu", nargs=argparse.REMAINDER, help="QEMU command line (after --)")
+    args = ap.parse_args()
+
+    qemu = args.qemu[1:] if args.qemu[:1] == ["--"] else args.qemu
+    if not qemu:
+        sys.exit("qemubench: no QEMU command line given")
+
+    proc = subprocess.Popen(qemu, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    try:
+        if read_until(proc, PROMPT, args.boot_timeout, echo=False) is None:
+            sys.exit("qemubench: no shell prompt within %.0f s" % args.boot_timeout)
+        proc.stdin.write(args.command.encode() + b"\r")
+        proc.stdin.flush()
+        if read_until(proc, args.marker.encode(), args.timeout, echo=True) is None:
+            sys.exit("\nqemubench: '%s' did not finish within %.0f s" % (args.command, args.timeout))
+        sys.stdout.write("\n")
+    finally:
+        proc.kill()
+        proc.wait()
+
+
+if __name__ == "__main__":
+    main()